@@ -4,16 +4,18 @@
 // https://github.com/phalpern/CppCon2017Code/blob/master/test_resource.cpp
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <exception>
 #include <iostream>
 #include <memory_resource>
-#include <vector>
+#include <unordered_map>
 
 namespace boltdb {
 
 // MemoryResourceTracker keeps track of the memory allocation and deallocation.
-// The main purpose is to detect memory leaks.
+// The main purpose is to detect memory leaks. The byte counters can be read
+// from any thread while memory is being allocated, e.g. by a metrics exporter.
 class MemoryResourceTracker : public std::pmr::memory_resource {
  public:
   MemoryResourceTracker() = default;
@@ -24,18 +26,24 @@ class MemoryResourceTracker : public std::pmr::memory_resource {
          {}
 
   // Get the total number of bytes that have been allocated.
-  [[nodiscard]] std::size_t bytes_allocated() const { return bytes_allocated_; }
+  [[nodiscard]] std::size_t bytes_allocated() const {
+    return bytes_allocated_.load(std::memory_order_relaxed);
+  }
 
   // Get the total number of bytes that have been deallocated.
   [[nodiscard]] std::size_t bytes_deallocated() const {
-    return bytes_allocated_ - bytes_outstanding_;
+    return bytes_allocated() - bytes_outstanding();
   }
 
   // Get the number of bytes that haven't been deallocated.
-  [[nodiscard]] std::size_t bytes_outstanding() const { return bytes_outstanding_; }
+  [[nodiscard]] std::size_t bytes_outstanding() const {
+    return bytes_outstanding_.load(std::memory_order_relaxed);
+  }
 
   // Get the highest number of allocated bytes.
-  [[nodiscard]] std::size_t bytes_highwater() const { return bytes_highwater_; }
+  [[nodiscard]] std::size_t bytes_highwater() const {
+    return bytes_highwater_.load(std::memory_order_relaxed);
+  }
 
   std::ostream& dump(std::ostream& os) const {
     os << "[bytes allocated]:" << bytes_allocated() << '\n';
@@ -49,10 +57,15 @@ class MemoryResourceTracker : public std::pmr::memory_resource {
   void* do_allocate(std::size_t nbytes, std::size_t alignment) override {
     void* p = upstream_->allocate(nbytes, alignment);
 
-    blocks_.push_back(Block{p, nbytes, alignment});
-    bytes_allocated_ += nbytes;
-    bytes_outstanding_ += nbytes;
-    bytes_highwater_ = std::max(bytes_highwater_, bytes_outstanding_);
+    blocks_.emplace(p, Block{nbytes, alignment});
+    bytes_allocated_.fetch_add(nbytes, std::memory_order_relaxed);
+    std::size_t outstanding =
+        bytes_outstanding_.fetch_add(nbytes, std::memory_order_relaxed) +
+        nbytes;
+
+    if (outstanding > bytes_highwater_.load(std::memory_order_relaxed)) {
+      bytes_highwater_.store(outstanding, std::memory_order_relaxed);
+    }
 
     return p;
   }
@@ -62,23 +75,24 @@ class MemoryResourceTracker : public std::pmr::memory_resource {
     // Check that deallocation args exactly match allocation args.
     // arguments. Note that, this check may not be necessary when this tracker
     // is used solely for internal purposes.
-    auto i = std::find_if(blocks_.begin(), blocks_.end(),
-                          [p](Block& block) { return block.ptr == p; });
+    // Blocks are indexed by address so that the lookup doesn't get slower as
+    // the number of outstanding blocks grows.
+    auto i = blocks_.find(p);
     if (i == blocks_.end()) {
       throw std::invalid_argument("do_deallocate: Invalid pointer.");
     }
 
-    if (i->nbytes != nbytes) {
+    if (i->second.nbytes != nbytes) {
       throw std::invalid_argument("do_deallocate: Size mismatch.");
     }
 
-    if (i->alignment != alignment) {
+    if (i->second.alignment != alignment) {
       throw std::invalid_argument("do_deallocate: Alignment mismatch.");
     }
 
-    upstream_->deallocate(p, i->nbytes, i->alignment);
+    upstream_->deallocate(p, i->second.nbytes, i->second.alignment);
     blocks_.erase(i);
-    bytes_outstanding_ -= nbytes;
+    bytes_outstanding_.fetch_sub(nbytes, std::memory_order_relaxed);
   }
 
   [[nodiscard]] bool do_is_equal(
@@ -88,16 +102,15 @@ class MemoryResourceTracker : public std::pmr::memory_resource {
 
  private:
   struct Block {
-    void* ptr;
     std::size_t nbytes;
     std::size_t alignment;
   };
 
   std::pmr::memory_resource* upstream_{std::pmr::get_default_resource()};
-  std::pmr::vector<Block> blocks_;
-  std::size_t bytes_allocated_{0};
-  std::size_t bytes_outstanding_{0};
-  std::size_t bytes_highwater_{0};
+  std::pmr::unordered_map<void*, Block> blocks_;
+  std::atomic<std::size_t> bytes_allocated_{0};
+  std::atomic<std::size_t> bytes_outstanding_{0};
+  std::atomic<std::size_t> bytes_highwater_{0};
 };
 
 }  // namespace boltdb
@@ -1,12 +1,20 @@
 #ifndef BOLTDB_CPP_DB_BUCKET_HPP_
 #define BOLTDB_CPP_DB_BUCKET_HPP_
 
+#include <algorithm>
 #include <map>
 #include <memory>
+#include <memory_resource>
+#include <span>
 #include <string>
+#include <vector>
 
+#include "boltdb/db/bucket_meta.hpp"
+#include "boltdb/page/page.hpp"
 #include "boltdb/transaction/txn.hpp"
 #include "boltdb/util/common.hpp"
+#include "boltdb/util/page_map.hpp"
+#include "boltdb/util/status.hpp"
 #include "boltdb/util/types.hpp"
 
 namespace boltdb {
@@ -14,18 +22,9 @@ namespace boltdb {
 class Cursor;
 class Page;
 class Node;
+struct SpilledNode;
 class Txn;
 
-// Represents the on-file representation of a bucket.
-// This is stored as the "value" of a bucket key. If the bucket is small enough,
-// then its root page can be stored inline in the value, after the bucket
-// header. In the case of inline buckets, the "root" will be 0.
-struct BucketMeta {
- public:
-  PageID root;   // Page id of the bucket's root-level page
-  u64 sequence;  // Monotonically incrementing, used by NextSequence()
-};
-
 // Bucket represents a collection of key/value pairs inside the database.
 class Bucket {
  public:
@@ -43,17 +42,46 @@ class Bucket {
   // This value can be changed by setting Bucket.FillPercent.
   static constexpr const f32 kDefaultFillPercent = 0.5;
 
+  // DefaultMergePercent is the fill below which a node is merged with a
+  // sibling when the transaction commits.
+  static constexpr const f64 kDefaultMergePercent = 0.25;
+
+  // Number of consecutive inserts at the right edge of the bucket after which
+  // the bucket is considered append-only.
+  static constexpr const int kAppendRunLength = 32;
+
   // Construct a bucket associated with a transaction.
   Bucket(Txn* txn);
 
+  // Construct a bucket rooted at the given page, such as the root bucket of
+  // the database.
+  Bucket(Txn* txn, const BucketMeta& bucket_meta);
+
+  // Construct a nested bucket from its value in the parent bucket: the
+  // bucket meta, followed by the page of an inline bucket.
+  Bucket(Txn* txn, std::span<const Byte> value);
+
+  // Release all the nodes created by the bucket.
+  ~Bucket();
+
+  DISALLOW_COPY_AND_ASSIGN(Bucket);
+
   // Get the transaction of the bucket.
   const Txn* txn() const { return txn_; }
   Txn* txn() { return txn_; }
 
   // Find the node based on the specified page id.
   // Return true if this page has been cached otherwise false.
+  // Nodes are only materialized to be modified, so this throws a
+  // DBException in a read-only transaction.
   bool node(PageID pgid, Node* parent, Node*& out_node);
 
+  // Drop the node of `pgid` from the node cache, once its page was freed.
+  void remove_node(PageID pgid) { node_cache_.erase(pgid); }
+
+  // Create a node which lives as long as the bucket.
+  Node* make_node(PageID pgid, Node* parent);
+
   // Return the root of the bucket.
   PageID root() const { return bucket_meta_.root; }
 
@@ -67,17 +95,69 @@ class Bucket {
 
   f64 fill_percent() const { return fill_percent_; }
 
+  // Get and set the fill below which nodes emptied by deletes are merged with
+  // a sibling when the transaction commits, as a fraction of the page size.
+  // Nodes with fewer than min_keys() keys are always merged.
+  f64 merge_percent() const { return merge_percent_; }
+  void set_merge_percent(f64 merge_percent) { merge_percent_ = std::clamp(merge_percent, 0.0, kMaxFillPercent); }
+
+  // Merge the underfilled nodes of the bucket and of its nested buckets.
+  // The time spent is added to the stats of the transaction.
+  void rebalance();
+
+  // Write the materialized nodes of the bucket and of its nested buckets to
+  // dirty pages, and store the new roots of the nested buckets in this one.
+  // Pages are assigned to the nodes of every bucket before any node is
+  // encoded, see Node::spill(). The time spent is added to the stats of the
+  // transaction. Return an error if the pages cannot be allocated.
+  Status spill();
+
+  // Return true if the latest inserts all landed after the last key of the
+  // bucket, such as timestamp keys. Nodes of an append-only bucket split full,
+  // since the pages left behind won't get any more keys.
+  bool append_mode() const { return append_run_ >= kAppendRunLength; }
+
+  // Record an insert of a new key, which did or didn't land at the right edge.
+  void record_insert(bool at_right_edge) { append_run_ = at_right_edge ? append_run_ + 1 : 0; }
+
   // Get in-memory node, if it exists.
   // Otherwise returns the underlying page.
-  std::pair<Page*, Node*> page_node(PageID pgid);
+  std::pair<Page, Node*> page_node(PageID pgid);
+
+  // Get the value of `key`. The value has a null data pointer if the key
+  // doesn't exist or holds a nested bucket. It's only valid for the life of
+  // the transaction.
+  std::span<const Byte> get(std::span<const Byte> key);
+
+  // Get the nested bucket stored under `name`, or nullptr if there's none.
+  // Nested buckets are opened once per transaction and allocated from the
+  // transaction arena. The cache is searched by the bytes of the name, so
+  // looking up an opened bucket again doesn't allocate.
+  Bucket* bucket(std::span<const Byte> name);
 
  private:
+  // Rebalance the nodes of this bucket and its nested buckets, untimed.
+  void rebalance_nodes();
+
+  // Assign dirty pages to the nodes of this bucket and its nested buckets,
+  // and collect the nodes to write.
+  Status spill_nodes(std::vector<SpilledNode>& spilled);
+
+  // Materialize the nodes from the root down to the leaf that holds `key`.
+  Node* leaf_node(std::span<const Byte> key);
+
+  // Find the value stored under `key`, looking at materialized nodes before
+  // pages. Return false if the key doesn't exist.
+  bool lookup(std::span<const Byte> key, u32& out_flags, std::span<const Byte>& out_value);
+
   BucketMeta bucket_meta_{};
   Txn* txn_;  // The associated transaction
-  std::map<std::string, Bucket*> sub_buckets_cache_;  // Subbucket cache
-  Page* page_{};                                      // Inline page reference
+  std::pmr::map<std::pmr::string, Bucket*, std::less<>> sub_buckets_cache_;  // Subbucket cache, in the txn arena
+  Page inline_page_;                                                          // Inline page, a view of the value
+  Page* page_{};                                                              // Inline page reference
   Node* root_node_{};                   // Materialized node for the root page
-  std::map<PageID, Node*> node_cache_;  // Node cache
+  PageMap<Node*> node_cache_;           // Node cache
+  std::vector<std::unique_ptr<Node>> nodes_;  // Owns all the nodes above
 
   // Sets the threshold for filling nodes when they split. By default,
   // the bucket will fill to 50% but it can be useful to increase this
@@ -85,7 +165,13 @@ class Bucket {
   //
   // This is non-persisted across transactions so it must be set in every
   // transaction.
-  f64 fill_percent_;
+  f64 fill_percent_{kDefaultFillPercent};
+
+  // Fill below which nodes are merged, non-persisted like fill_percent_.
+  f64 merge_percent_{kDefaultMergePercent};
+
+  // Number of consecutive inserts at the right edge.
+  int append_run_{};
 };
 
 }  // namespace boltdb
@@ -1,6 +1,8 @@
 #ifndef BOLTDB_CPP_DB_BUCKET_META_HPP_
 #define BOLTDB_CPP_DB_BUCKET_META_HPP_
 
+#include "boltdb/util/types.hpp"
+
 namespace boltdb {
 
 // Represents the on-file representation of a bucket.
@@ -0,0 +1,103 @@
+#ifndef BOLTDB_CPP_DB_BULK_LOADER_HPP_
+#define BOLTDB_CPP_DB_BULK_LOADER_HPP_
+
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "boltdb/db/bucket_meta.hpp"
+#include "boltdb/db/page_writer.hpp"
+#include "boltdb/page/page.hpp"
+#include "boltdb/util/common.hpp"
+#include "boltdb/util/status.hpp"
+#include "boltdb/util/types.hpp"
+
+namespace boltdb {
+
+class Txn;
+
+// BulkLoader builds a B+tree bottom-up from key/value pairs added in sorted
+// order.
+//
+// Unlike inserting keys one at a time, no node is ever split: leaves are
+// filled up to the fill percent and written as soon as they are full, and the
+// first key of every written page is added to the level above it, which is
+// filled and written the same way. Only one page per level is held in memory,
+// and pages get consecutive ids so the whole tree is written sequentially.
+class BulkLoader {
+ public:
+  // Pages are packed full by default. Lower the fill percent to leave room
+  // for later inserts.
+  static constexpr const f64 kDefaultFillPercent = 1.0;
+
+  // Construct a loader that appends the tree to the database of a writable
+  // transaction, after its high water mark. The pages are written to the
+  // data file as the tree is built and become part of the database when the
+  // transaction commits. The transaction can allocate pages, and other
+  // loaders can write to it, while the tree is being built: the tree then
+  // continues after the pages they took.
+  explicit BulkLoader(Txn* txn, f64 fill_percent = kDefaultFillPercent);
+
+  // Construct a loader that appends the tree with the given writer. Several
+  // loaders can share a writer, e.g. to build nested buckets.
+  explicit BulkLoader(PageWriter* writer, f64 fill_percent = kDefaultFillPercent);
+
+  DISALLOW_COPY_AND_ASSIGN(BulkLoader);
+
+  // Add a key/value pair. Keys must be added in strictly increasing order.
+  // `flags` are the leaf flags of the element, such as LeafFlag::kBucket.
+  Status add(std::span<const Byte> key, std::span<const Byte> value, u32 flags = 0);
+
+  // Write the pages which are still in memory and return the bucket rooted
+  // at the top of the tree. No key can be added afterwards.
+  Status finish(BucketMeta& out_bucket);
+
+  // Get the number of key/value pairs added.
+  i64 count() const { return count_; }
+
+  // Get the number of pages written for the tree so far.
+  i64 page_count() const { return page_count_; }
+
+ private:
+  struct Element {
+    u32 flags;
+    u32 key_size;
+    u32 value_size;
+    PageID pgid;
+  };
+
+  // The page being filled at one level of the tree.
+  struct Level {
+    std::vector<Element> elements;
+    std::vector<Byte> data;  // Keys and values of the elements, back to back
+    int byte_size{kPageHeaderSize};
+  };
+
+  // Add an element to the page being filled at the given level, writing the
+  // page out first if the element would take it over the threshold.
+  Status add_element(std::size_t depth, std::span<const Byte> key, std::span<const Byte> value, u32 flags,
+                     PageID pgid);
+
+  // Write out the page being filled at the given level. Return its id and
+  // its first key, which is the key of the page in the level above.
+  Status write_level(std::size_t depth, PageID& out_pgid, std::vector<Byte>& out_first_key);
+
+  // Write out the pages appended by the owned writer since the current run
+  // of consecutive pages started and record the run in the transaction.
+  Status close_run();
+
+  Txn* txn_{};
+  std::unique_ptr<PageWriter> owned_writer_;
+  PageID run_pgid_{};  // First page of the current run appended by the owned writer
+  PageWriter* writer_;
+  int threshold_;
+  std::vector<Level> levels_;
+  std::vector<Byte> last_key_;
+  i64 count_{};
+  i64 page_count_{};
+  bool finished_{};
+};
+
+}  // namespace boltdb
+
+#endif  // BOLTDB_CPP_DB_BULK_LOADER_HPP_
@@ -0,0 +1,40 @@
+#ifndef BOLTDB_CPP_DB_COMPACT_HPP_
+#define BOLTDB_CPP_DB_COMPACT_HPP_
+
+#include <string>
+
+#include "boltdb/db/bulk_loader.hpp"
+#include "boltdb/util/status.hpp"
+#include "boltdb/util/types.hpp"
+
+namespace boltdb {
+
+class DB;
+
+// CompactStats reports the outcome of a compaction.
+struct CompactStats {
+ public:
+  i64 src_size{};    // Size of the source file in bytes
+  i64 dst_size{};    // Size of the compacted file in bytes
+  i64 page_count{};  // Number of pages in the compacted file
+  i64 key_count{};   // Number of key/value pairs copied, in all buckets
+  Duration elapsed{};
+
+  // Get the rate at which the compacted file was written, in MB/s.
+  f64 throughput() const {
+    return elapsed.count() > 0 ? static_cast<f64>(dst_size) / (1024 * 1024) / elapsed.count() : 0;
+  }
+};
+
+// Copy the database into a new file at `path`.
+//
+// The copy is made from a read-only transaction, so the database keeps
+// serving readers and writers while it runs. Every bucket is walked in key
+// order and rebuilt bottom-up with a BulkLoader, so the new file has no free
+// pages and its pages are packed up to `fill_percent`.
+Status compact(DB* db, const std::string& path, CompactStats& out_stats,
+               f64 fill_percent = BulkLoader::kDefaultFillPercent);
+
+}  // namespace boltdb
+
+#endif  // BOLTDB_CPP_DB_COMPACT_HPP_
@@ -1,21 +1,24 @@
 #ifndef BOLTDB_CPP_DB_CURSOR_HPP_
 #define BOLTDB_CPP_DB_CURSOR_HPP_
 
+#include <span>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include "boltdb/page/page.hpp"
 #include "boltdb/util/slice.hpp"
 
 namespace boltdb {
 
 class Bucket;
-class Page;
 class Node;
 
 // ElemRef represents a reference to an element on a given page/node.
 struct ElemRef {
  public:
   ElemRef() = default;
-  ElemRef(Page* p, Node* n, int idx = 0) : page(p), node(n), index(idx) {}
+  ElemRef(Page p, Node* n, int idx = 0) : page(p), node(n), index(idx) {}
 
   // Return true if the ref is pointing at a leaf page/node otherwise false.
   bool is_leaf() const;
@@ -23,7 +26,13 @@ struct ElemRef {
   // Return the number of inodes or page elements.
   int count() const;
 
-  Page* page{};
+  // Get the key of the element at `i`.
+  std::span<const Byte> key(int i) const;
+
+  // Get the child page of the branch element at `i`.
+  PageID child(int i) const;
+
+  Page page;
   Node* node{};
   int index{};
 };
@@ -39,8 +48,19 @@ struct ElemRef {
 // Changing data while traversing with a cursor may cause it to be invalidated
 // and return unexpected keys and/or values. You must reposition your cursor
 // after mutating data.
+//
+// The cursor reads nodes the bucket has already materialized and pages
+// otherwise, it never materializes nodes itself. In a read-only transaction
+// every step is a binary search or an index into a page.
 class Cursor {
  public:
+  // A key and its value, viewing the page or node they live in. Both have a
+  // null data pointer past the end of the bucket, the value also does for a
+  // nested bucket.
+  using KeyValue = std::pair<std::span<const Byte>, std::span<const Byte>>;
+
+  explicit Cursor(Bucket* bucket) : bucket_(bucket) {}
+
   // Return the bucket that this cursor was created from.
   Bucket* bucket() { return bucket_; }
   const Bucket* bucket() const { return bucket_; }
@@ -49,16 +69,41 @@ class Cursor {
   // and returns its key and value.
   // If the bucket is empty then a nil key and value are returned.
   // The returned key and value are only valid for the life of the transaction.
-  std::pair<ByteSlice, ByteSlice> first();
+  KeyValue first();
+
+  // Move the cursor to the last item in the bucket and return its key and
+  // value. If the bucket is empty then a nil key and value are returned.
+  KeyValue last();
+
+  // Move the cursor to the next item in the bucket and return its key and
+  // value. If the cursor is at the end of the bucket then a nil key and value
+  // are returned.
+  KeyValue next();
+
+  // Move the cursor to the given key and return it. If the key doesn't exist
+  // then the next key is used. If no keys follow, a nil key is returned.
+  KeyValue seek(std::span<const Byte> key);
 
  private:
   // Moves the cursor to the first leaf element under the last page in the
   // stack.
   void move_to_leaf();
 
+  // Moves the cursor to the last leaf element under the last page in the
+  // stack.
+  void move_to_last_leaf();
+
+  // Push the page or node of `pgid` and move to the position of `key` in it,
+  // recursively down to a leaf.
+  void search(std::string_view key, PageID pgid);
+
+  // Return the key and value of the current leaf element.
+  KeyValue key_value() const;
+
   Bucket* bucket_;
   std::vector<ElemRef> stack_;
 };
 
 }  // namespace boltdb
-#endif  // BOLTDB_CPP_DB_CURSOR_HPP_
\ No newline at end of file
+
+#endif  // BOLTDB_CPP_DB_CURSOR_HPP_
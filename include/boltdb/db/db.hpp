@@ -1,24 +1,75 @@
 #ifndef BOLTDB_CPP_DB_DB_HPP_
 #define BOLTDB_CPP_DB_DB_HPP_
 
+#include <array>
+#include <atomic>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "boltdb/db/bucket.hpp"
 #include "boltdb/db/db_meta.hpp"
+#include "boltdb/db/page_txids.hpp"
+#include "boltdb/db/wal.hpp"
 #include "boltdb/fs/file_system.hpp"
 #include "boltdb/page/freelist.hpp"
 #include "boltdb/page/page.hpp"
+#include "boltdb/transaction/reader_registry.hpp"
 #include "boltdb/transaction/txn.hpp"
 #include "boltdb/util/common.hpp"
+#include "boltdb/util/histogram.hpp"
+#include "boltdb/util/memory_map.hpp"
 #include "boltdb/util/options.hpp"
+#include "boltdb/util/sharded_counters.hpp"
 #include "boltdb/util/status.hpp"
+#include "boltdb/util/thread_pool.hpp"
 
 namespace boltdb {
 
 class Txn;
 
+// GrowStats represents statistics about the growth of the data file.
+struct GrowStats {
+ public:
+  i64 grow_count{};       // Number of times the file was grown
+  i64 bytes_allocated{};  // Total bytes preallocated on disk
+  i64 shrink_count{};     // Number of times the file was truncated
+  i64 bytes_released{};   // Total bytes given back by truncation
+};
+
+// DBStats represents statistics about the database, cumulative since it was
+// opened unless noted otherwise.
+struct DBStats {
+ public:
+  // Freelist stats, as of the last write transaction.
+  int free_page_n{};     // Number of free pages on the freelist
+  int pending_page_n{};  // Number of pages freed by transactions still visible to readers
+  i64 free_alloc{};      // Total bytes of the free and pending pages
+  i64 freelist_inuse{};  // Bytes used by the freelist page
+
+  // Transaction stats.
+  i64 txn_n{};          // Number of read transactions started
+  int open_txn_n{};     // Number of currently open read transactions
+  TxnStats txn_stats{};  // Sum of the stats of all closed transactions
+
+  i64 mmap_size{};  // Size of the mmap, in bytes
+  GrowStats grow{};
+};
+
+// Latency identifies an operation whose durations the database records in a
+// histogram, see DB::latency().
+enum class Latency : int {
+  kCommit,     // Txn::commit(), from start to finish
+  kRebalance,  // Merging the underfilled nodes at commit
+  kSpill,      // Writing the changed nodes to dirty pages at commit
+  kWrite,      // Writing the dirty pages at commit, syncs included
+  kWriteMeta,  // Writing the meta page at commit, syncs included
+  kSync,       // Each sync of the data file
+  kReadTxn,    // Lifetime of a read-only transaction
+  kRemap,      // Mapping or extending the mmap
+};
+
 // DB represents a collection of buckets persisted to a file on disk.
 // All data access is performed through transactions which can be obtained
 // through the DB. All the functions on DB will return a ErrDatabaseNotOpen if
@@ -28,6 +79,9 @@ class DB {
   // The largest step that can be taken when remapping the mmap.
   constexpr static const int kMaxMmapStep = 1 << 30;  // 1GB
 
+  // The largest mmap size supported.
+  constexpr static const i64 kMaxMapSize = 0xFFFFFFFFFFFF;  // 256TB
+
   // The data file format version.
   constexpr static const u32 kVersion = 1;
 
@@ -36,8 +90,18 @@ class DB {
 
   constexpr static const u16 kSpecialCount = 0xFFFF;
 
-  // TODO(gc): fix this and free memory
-  ~DB() {}
+  // The range of supported page sizes, see Options::page_size().
+  constexpr static const int kMinPageSize = 512;
+  constexpr static const int kMaxPageSize = 64 * 1024;
+
+  // Free the latency histograms, the other resources are released by the
+  // destructors of the members. Open transactions are not closed: commit or
+  // roll them back before deleting the database.
+  ~DB() {
+    for (auto&& histogram : latencies_) {
+      delete histogram.load(std::memory_order_relaxed);
+    }
+  }
 
   // Disallow copy and assignment constructor.
   DB(const DB&) = delete;
@@ -51,9 +115,12 @@ class DB {
   std::string path() const { return file_handle_->path; }
 
   // Get a page reference from the mmap based on the current page size.
-  Page* page(PageID pgid) const;
+  // The returned page stays valid while the file grows since the mmap is
+  // extended in place.
+  Page page(PageID pgid) const;
 
-  friend Status open_db(std::string path, Options options, DB** out_db);
+  friend Status open_db(std::unique_ptr<FileHandle> file_handle, std::unique_ptr<FileHandle> wal_handle,
+                        Options options, DB** out_db);
 
   // TODO(gc): add these methods temporarily.
   int page_size() const { return page_size_; }
@@ -62,36 +129,192 @@ class DB {
   // Return a contigous block of memory starting at a given page.
   Status allocate(int count, Page*& out_page);
 
+  // Start a new transaction. The caller owns the returned transaction and
+  // must close it with commit or rollback before deleting it.
+  //
+  // Multiple read-only transactions can be used concurrently but only one
+  // write transaction can be used at a time. Starting multiple write
+  // transactions will cause the calls to block and be serialized until the
+  // current write transaction finishes.
+  //
+  // Starting and closing a read-only transaction never takes a lock. Readers
+  // are tracked in a lock-free registry which the writer scans to find the
+  // oldest transaction id still in use.
+  Status begin(bool writable, Txn*& out_txn);
+
+  // Get the current meta, which is the valid meta page with the highest
+  // transaction id.
+  Meta meta() const;
+
+  // Get statistics about the database. The counters are updated by
+  // transactions as they close, without a lock, so collecting them never
+  // waits for a writer.
+  DBStats stats() const;
+
+  // Get a snapshot of the histogram of the durations of an operation.
+  HistogramSnapshot latency(Latency latency) const {
+    const Histogram* histogram = latencies_[static_cast<int>(latency)].load(std::memory_order_acquire);
+
+    return histogram != nullptr ? histogram->snapshot() : HistogramSnapshot{};
+  }
+
+  // Record a duration of an operation.
+  void record_latency(Latency latency, Duration duration) {
+    Histogram* histogram = latencies_[static_cast<int>(latency)].load(std::memory_order_acquire);
+
+    if (histogram == nullptr) {
+      histogram = make_histogram(latency);
+    }
+
+    histogram->record(duration);
+  }
+
+  // Get statistics about the growth of the data file.
+  GrowStats grow_stats() const {
+    return {grow_count_.load(std::memory_order_relaxed), grow_bytes_.load(std::memory_order_relaxed),
+            shrink_count_.load(std::memory_order_relaxed), shrink_bytes_.load(std::memory_order_relaxed)};
+  }
+
+  // Get the pool used to encode dirty nodes at commit.
+  // Return nullptr if nodes are encoded by the committing thread.
+  ThreadPool* spill_pool() const { return spill_pool_.get(); }
+
+  // Get the map of the transactions that last wrote each page.
+  // Return nullptr unless Options::track_page_txids() is set.
+  const PageTxids* page_txids() const { return page_txids_.get(); }
+
+  // Get the write-ahead log.
+  // Return nullptr unless Options::wal() is set.
+  Wal* wal() const { return wal_.get(); }
+
  private:
+  friend class BulkLoader;
+  friend class Txn;
+
+  // Index of the number of read transactions in txn_counters_, after the
+  // TxnStats fields.
+  static constexpr const std::size_t kTxnN = 16;
+
   DB(std::unique_ptr<FileHandle> file_handle, Options options)
-      : file_handle_(std::move(file_handle)), options_(options) {}
+      : file_handle_(std::move(file_handle)), options_(options), readers_(options.max_readers()) {}
+
+  Status begin_txn(Txn*& out_txn);
+  Status begin_rwtxn(Txn*& out_txn);
+
+  // Move the pages freed by transactions that can no longer be seen by any
+  // reader to the freelist.
+  void release_pending_pages(TxnID txn_id);
+
+  // Remove a read-only transaction from the database.
+  void remove_txn(Txn* txn);
+
+  // Add the stats of a closing transaction to the database stats. For the
+  // writer, also snapshot the freelist, which only it may read.
+  void record_stats(const Txn& txn);
 
   void move_aux(DB&& other) noexcept;
 
+  // Allocate the histogram of `latency` the first time it records, so that
+  // a database only pays for the histograms it uses. Return the histogram
+  // installed by the first thread to get there.
+  Histogram* make_histogram(Latency latency);
+
   // Initialize the meta, freelist and root pages.
   Status init() const;
 
+  // Find the page size of an existing database from its meta pages.
+  Status read_page_size();
+
+  // Find the valid meta with the highest txid in `file`. The page size isn't
+  // known yet, so the second meta page is looked for at every supported one.
+  static Status read_newest_meta(FileHandle& file, Meta& out_meta);
+
+  // Map the data file into memory, or extend the existing mapping so that it
+  // covers at least `min_size` bytes. Readers are never blocked: the mapping
+  // grows in place and pages they reference stay valid.
+  Status mmap(std::size_t min_size);
+
+  // Grow the size of the data file to at least `size` bytes.
+  //
+  // The file grows geometrically (doubling) while it's smaller than
+  // Options::alloc_size() and by alloc_size() chunks afterwards, which
+  // amortizes the cost of preallocation and of the fsync() that persists the
+  // new file size. The fsync() is skipped if Options::no_grow_sync() is set.
+  Status grow(std::size_t size);
+
+  // Sync the data file, with its metadata if `metadata` is set, and record
+  // the time it took.
+  Status sync(bool metadata);
+
+  // Truncate the data file to `size` bytes, rounded up to a page, if it's
+  // larger. The pages past `size` must be free. The file is not truncated
+  // below the high water mark of an open reader, the rest of the shrink is
+  // then left pending for a later commit.
+  Status shrink(std::size_t size);
+
+  // Check that the pages listed in the commit record of a meta written by a
+  // single sync commit are all on disk. Metas without a record pass.
+  bool commit_complete(const Meta& meta) const;
+
+  // Determine the appropriate size for the mmap given the current size of the
+  // database. The minimum size is 32KB and doubles until it reaches 1GB.
+  // Return an error if the new mmap size is greater than the max allowed.
+  Status mmap_size(std::size_t size, std::size_t& out_size) const;
+
+  // Get the meta page in `slot`, 0 or 1. It's read through the current base of
+  // the mmap, which a concurrent remap may move.
+  const Meta* meta_page(int slot) const { return page(slot).meta(); }
+
   std::unique_ptr<FileHandle> file_handle_;
   Options options_;
 
-  FileHandle* lock_file_;  // windows only
-  Byte* dataref_;          // mmap'ed readonly, write throws SEGV
-  Byte* data_;
-  int data_size_;
-  int file_size_;  // current on disk file size
-  Meta meta0_;
-  Meta meta1_;
+  FileHandle* lock_file_;    // windows only
+  MemoryMap mmap_;           // mmap'ed readonly, write throws SEGV
+  std::size_t file_size_{};  // current on disk file size
+  std::atomic<int> torn_meta_{-1};  // Slot of a single sync commit that didn't complete
   int page_size_;
-  bool opened_;
-  Txn* rwtx_;
-  std::vector<Txn*> txns_;
+  bool opened_{};
+  Txn* rwtx_{};
+  std::mutex rwlock_;       // Allows only one writer at a time
+  ReaderRegistry readers_;  // Open read-only transactions
   FreeList freelist;
+  std::atomic<i64> grow_count_{};
+  std::atomic<i64> grow_bytes_{};
+  std::atomic<i64> shrink_count_{};
+  std::atomic<i64> shrink_bytes_{};
+  bool shrink_pending_{};  // A shrink was held back by an open reader, guarded by `rwlock_`
+  ShardedCounters<kTxnN + 1> txn_counters_;  // TxnStats fields, then txn_n
+  std::atomic<int> free_page_n_{};
+  std::atomic<int> pending_page_n_{};
+  std::atomic<i64> freelist_inuse_{};
+  std::array<std::atomic<Histogram*>, static_cast<int>(Latency::kRemap) + 1> latencies_{};  // Owned, allocated lazily
+  std::size_t dirty_pages_hint_{};  // Number of pages dirtied by the last writer
+  std::unique_ptr<ThreadPool> spill_pool_;  // See Options::spill_threads()
+  std::unique_ptr<PageTxids> page_txids_;   // See Options::track_page_txids()
+  std::unique_ptr<Wal> wal_;                // See Options::wal()
 };
 
 // Open a database at the specified path.
 // If the file does not exist then it will be created automatically.
 Status open_db(std::string path, Options options, DB** out_db);
 
+// Open a database on an already opened file. The file must support mmap
+// through FileHandle::fd(). This is how tests run the database on top of a
+// FileHandle that injects faults.
+Status open_db(std::unique_ptr<FileHandle> file_handle, Options options, DB** out_db);
+
+// Open a database on already opened data and write-ahead log files. The log
+// is only used with Options::wal(), a null `wal_handle` opens the log next to
+// the data file as usual. This is how tests inject faults into the log too.
+Status open_db(std::unique_ptr<FileHandle> file_handle, std::unique_ptr<FileHandle> wal_handle, Options options,
+               DB** out_db);
+
+// Create a database that lives entirely in memory and is gone once closed.
+// Syncs are no-ops and nothing touches the disk, which suits scratch
+// databases, caches and tests. The write-ahead log and page txid tracking are
+// ignored. `name` is only used for debugging.
+Status open_memory_db(const std::string& name, Options options, DB** out_db);
+
 }  // namespace boltdb
 
 #endif  // BOLTDB_CPP_DB_DB_HPP_
\ No newline at end of file
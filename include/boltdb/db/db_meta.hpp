@@ -2,20 +2,38 @@
 #define BOLTDB_CPP_DB_DB_META_HPP_
 
 #include "boltdb/db/bucket_meta.hpp"
+#include "boltdb/page/page.hpp"
 #include "boltdb/util/slice.hpp"
 #include "boltdb/util/status.hpp"
 #include "boltdb/util/types.hpp"
 
 namespace boltdb {
 
+struct CommitRecord;
+
 class Meta {
  public:
+  // Set in the meta of a transaction committed with a single sync, see
+  // Options::single_sync_commit(). The meta page then holds a CommitRecord
+  // right after the meta.
+  constexpr static const u32 kFlagCommitRecord = 0x01;
+
+  // Size of the big-endian encoding of a meta, including the checksum.
+  constexpr static const std::size_t kEncodedSize = 4 * sizeof(u32) + 6 * sizeof(u64);
+
   // Serialize the given meta object.
   static ByteSlice serialize(const Meta& meta);
 
   // Deserialize meta from the given slice.
   static Meta deserialize(ByteSlice slice);
 
+  // Encode into `out`, which must hold kEncodedSize bytes, and return the
+  // position right after the encoding. This doesn't allocate.
+  Byte* encode(Byte* out) const;
+
+  // Decode a meta from the kEncodedSize bytes at `in`.
+  static Meta decode(const Byte* in);
+
   // Write meta information to the specified slice.
   // This does *include* the checksum field.
   void write(ByteSlice& slice) const;
@@ -29,19 +47,50 @@ class Meta {
 
   bool equals(const Meta& other) const;
 
+  // Get the commit record following the meta in its page.
+  // Only valid for a meta that lives in a meta page.
+  CommitRecord* commit_record() const { return reinterpret_cast<CommitRecord*>(const_cast<Meta*>(this) + 1); }
+
   u32 magic;
   u32 version;
   u32 page_size;
   u32 flags;
   BucketMeta root;
   PageID freelist;  // Freelist page id
-  PageID pgid;      // Meta page id
+  PageID pgid;      // High water mark, the id of the first unused page
   TxnID txid;       // Transaction id
   u64 checksum;
 
  private:
-  void write_aux(ByteSlice& slice) const;
+  // Encode every field but the checksum.
+  Byte* encode_aux(Byte* out) const;
 };
+
+// PageRun is a run of `count` contiguous pages starting at `pgid`.
+struct PageRun {
+  PageID pgid;
+  u64 count;
+};
+
+// CommitRecord lists the pages written by a transaction committed with a
+// single sync, and a checksum of their content. The pages and the meta are
+// synced together, so after a crash the meta may be on disk without all of
+// its pages; opening the database checks the record to tell.
+struct CommitRecord {
+  u64 checksum;  // crc64 of the runs, then of the content of their pages
+  u32 count;     // Number of runs following the record
+  u32 reserved;
+
+  // Get the maximum number of runs that fit in a meta page.
+  static std::size_t capacity(int page_size) {
+    return (page_size - kPageHeaderSize - sizeof(Meta) - sizeof(CommitRecord)) / sizeof(PageRun);
+  }
+
+  // Get the runs following the record.
+  PageRun* runs() { return reinterpret_cast<PageRun*>(this + 1); }
+  const PageRun* runs() const { return reinterpret_cast<const PageRun*>(this + 1); }
+};
+
 }  // namespace boltdb
 
 #endif  // BOLTDB_CPP_DB_DB_META_HPP_
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef BOLTDB_CPP_DB_INCREMENTAL_HPP_
+#define BOLTDB_CPP_DB_INCREMENTAL_HPP_
+
+#include <iosfwd>
+#include <string>
+
+#include "boltdb/util/status.hpp"
+#include "boltdb/util/types.hpp"
+
+namespace boltdb {
+
+class Txn;
+
+// IncrementalStats reports the content of an incremental backup.
+struct IncrementalStats {
+ public:
+  TxnID base_txid{};  // Transaction the backup applies on top of
+  TxnID txid{};       // Transaction the backup brings the database to
+  i64 page_count{};   // Number of data pages in the backup
+  i64 bytes{};        // Size of the backup in bytes
+};
+
+// Write an incremental backup of the pages written after `base_txid`, as seen
+// by the read-only transaction `txn`, to `out`. The database must be opened
+// with Options::track_page_txids().
+//
+// The backup holds a header, the meta of the transaction, runs of contiguous
+// changed pages and a crc64 of all of it. Pages freed since the base are only
+// included if they were written again, so with little churn the backup is a
+// small fraction of the file.
+Status write_incremental(Txn* txn, TxnID base_txid, std::ostream& out, IncrementalStats& out_stats);
+
+// Apply the incremental backup read from `in` onto the copy of the database
+// at `path`. The copy must be at least as recent as the base transaction of
+// the backup, e.g. a full backup taken by Txn::copy_file() or the result of
+// applying the previous incremental backup.
+//
+// The backup is applied to a scratch copy next to `path`, which replaces the
+// copy once the whole backup has been applied and its checksum verified. A
+// truncated or damaged backup leaves the copy as it was.
+Status apply_incremental(const std::string& path, std::istream& in, IncrementalStats& out_stats);
+
+}  // namespace boltdb
+
+#endif  // BOLTDB_CPP_DB_INCREMENTAL_HPP_
@@ -0,0 +1,67 @@
+#ifndef BOLTDB_CPP_DB_METRICS_HPP_
+#define BOLTDB_CPP_DB_METRICS_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boltdb/util/common.hpp"
+#include "boltdb/util/status.hpp"
+
+namespace boltdb {
+
+class DB;
+
+// Render the statistics of the database in the Prometheus text exposition
+// format: the DBStats counters, the latency histograms and the bytes held by
+// the MemoryPool. Nothing is allocated and no lock is taken, so this can run
+// as often as needed next to a busy writer.
+//
+// Return the size of the whole text. Only the first out.size() bytes are
+// written if it doesn't fit, in which case the caller can try again with a
+// larger buffer.
+std::size_t render_metrics(const DB& db, std::span<char> out);
+
+// Render the metrics into a string.
+std::string render_metrics(const DB& db);
+
+// MetricsServer answers every HTTP request made to a port on the loopback
+// interface with the metrics of a database, for tests and local scraping.
+// Requests are served one at a time on a thread of their own.
+class MetricsServer {
+ public:
+  explicit MetricsServer(const DB* db) : db_(db) {}
+
+  DISALLOW_COPY_AND_ASSIGN(MetricsServer);
+
+  // Stop the server if it's running.
+  ~MetricsServer() { stop(); }
+
+  // Listen on 127.0.0.1:`port`, or on a port picked by the system if `port`
+  // is 0, see port().
+  Status start(int port);
+
+  // Stop listening and wait for the request being served, if any.
+  void stop();
+
+  // Get the port the server listens on.
+  int port() const { return port_; }
+
+ private:
+  // Accept and answer connections until stop() is called.
+  void serve();
+
+  const DB* db_;
+  int fd_{-1};
+  int port_{};
+  std::atomic<bool> stopping_{};
+  std::vector<char> buffer_;  // Holds the response, grows as needed
+  std::thread thread_;
+};
+
+}  // namespace boltdb
+
+#endif  // BOLTDB_CPP_DB_METRICS_HPP_
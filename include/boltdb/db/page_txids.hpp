@@ -0,0 +1,76 @@
+#ifndef BOLTDB_CPP_DB_PAGE_TXIDS_HPP_
+#define BOLTDB_CPP_DB_PAGE_TXIDS_HPP_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "boltdb/fs/file_system.hpp"
+#include "boltdb/util/common.hpp"
+#include "boltdb/util/status.hpp"
+#include "boltdb/util/types.hpp"
+
+namespace boltdb {
+
+// PageTxids records, for every page of a database, the id of the transaction
+// that last wrote it. This is what incremental backups use to find the pages
+// that changed since a base transaction.
+//
+// The map lives in a sidecar file next to the database: a 16 byte header
+// followed by one txid per page, so the txid of page `pgid` is stored at
+// offset `pgid * 8` (the header takes the slots of the two meta pages).
+//
+// A commit records its pages and syncs the map before it writes them, so the
+// map may claim a page is newer than it is after a crash, never older. The
+// header holds the id of the last transaction that synced the map. If it's
+// behind the database, e.g. because the database was written without the
+// map, every page is assumed to be written by the current transaction.
+class PageTxids {
+ public:
+  constexpr static const u32 kMagic = 0x7478C1D5;
+  constexpr static const u32 kVersion = 1;
+
+  // Get the path of the sidecar file of the database at `db_path`.
+  static std::string path_of(const std::string& db_path) { return db_path + ".txids"; }
+
+  // Open the map of the database at `db_path`, whose current transaction id
+  // is `txid` and high water mark `pgid`. The map is rebuilt if it is missing
+  // or stale. A read-only map is never written to disk.
+  static Status open(const std::string& db_path, TxnID txid, PageID pgid, bool read_only,
+                     std::unique_ptr<PageTxids>& out_txids);
+
+  DISALLOW_COPY_AND_ASSIGN(PageTxids);
+
+  // Record that `count` pages starting at `pgid` are written by `txid`.
+  void record(PageID pgid, int count, TxnID txid);
+
+  // Write the entries recorded since the last sync to disk and mark the map
+  // as current up to `txid`.
+  Status sync(TxnID txid, bool fdatasync);
+
+  // Get the transaction id that last wrote the page.
+  TxnID get(PageID pgid) const;
+
+  // Get the ids of the pages below `pgid` written after `base_txid`, as
+  // [first, last) runs of contiguous pages.
+  std::vector<std::pair<PageID, PageID>> changed_since(TxnID base_txid, PageID pgid) const;
+
+ private:
+  constexpr static const std::size_t kFirstPage = 2;  // Slots 0 and 1 hold the header
+
+  explicit PageTxids(std::unique_ptr<FileHandle> file_handle) : file_handle_(std::move(file_handle)) {}
+
+  // Mark every page below `pgid` as written by `txid`.
+  void reset(TxnID txid, PageID pgid);
+
+  mutable std::mutex mutex_;  // Protects the entries from concurrent backups
+  std::unique_ptr<FileHandle> file_handle_;  // nullptr if read-only
+  std::vector<TxnID> txids_;
+  std::size_t dirty_begin_{};  // Range of entries not written to disk yet
+  std::size_t dirty_end_{};
+};
+
+}  // namespace boltdb
+
+#endif  // BOLTDB_CPP_DB_PAGE_TXIDS_HPP_
@@ -0,0 +1,60 @@
+#ifndef BOLTDB_CPP_DB_PAGE_WRITER_HPP_
+#define BOLTDB_CPP_DB_PAGE_WRITER_HPP_
+
+#include <vector>
+
+#include "boltdb/fs/file_system.hpp"
+#include "boltdb/util/common.hpp"
+#include "boltdb/util/status.hpp"
+#include "boltdb/util/types.hpp"
+
+namespace boltdb {
+
+// PageWriter appends pages to a file at consecutive page ids.
+//
+// Pages are encoded straight into a write buffer and the buffer is written
+// with a single large sequential write once it's full, so building a tree of
+// millions of pages only takes a write call every few megabytes.
+class PageWriter {
+ public:
+  static constexpr const int kDefaultBufferSize = 4 * 1024 * 1024;
+
+  // Construct a writer that appends pages to `file_handle` starting at page
+  // `first_pgid`.
+  PageWriter(FileHandle* file_handle, int page_size, PageID first_pgid, int buffer_size = kDefaultBufferSize);
+
+  DISALLOW_COPY_AND_ASSIGN(PageWriter);
+
+  // Reserve `count` contiguous pages and return their id and a zeroed buffer
+  // to encode them into. The buffer is valid until the next call.
+  Status append(int count, PageID& out_pgid, Byte*& out_data);
+
+  // Write the buffered pages to the file.
+  Status flush();
+
+  // Write the buffered pages to the file and append the next pages starting
+  // at page `pgid`.
+  Status seek(PageID pgid);
+
+  // Get the id of the next page to be appended.
+  PageID next_pgid() const { return next_pgid_; }
+
+  // Get the page size.
+  int page_size() const { return page_size_; }
+
+  // Get the number of bytes written to the file so far.
+  i64 bytes_written() const { return bytes_written_; }
+
+ private:
+  FileHandle* file_handle_;
+  int page_size_;
+  PageID next_pgid_;
+  PageID buffer_pgid_;  // Id of the first page in the buffer
+  std::size_t buffer_size_;
+  std::vector<Byte> buffer_;
+  i64 bytes_written_{};
+};
+
+}  // namespace boltdb
+
+#endif  // BOLTDB_CPP_DB_PAGE_WRITER_HPP_
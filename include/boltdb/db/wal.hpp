@@ -0,0 +1,151 @@
+#ifndef BOLTDB_CPP_DB_WAL_HPP_
+#define BOLTDB_CPP_DB_WAL_HPP_
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boltdb/db/db_meta.hpp"
+#include "boltdb/fs/file_system.hpp"
+#include "boltdb/util/common.hpp"
+#include "boltdb/util/status.hpp"
+#include "boltdb/util/types.hpp"
+
+namespace boltdb {
+
+// Wal is the write-ahead log of a database opened with Options::wal().
+//
+// A commit appends the images of its dirty pages and its meta to the log as
+// one record and syncs the log, which is a single sequential write and a
+// single fdatasync(). The pages and the meta are then written to the data
+// file without syncing it, so readers see them through the mmap, and the
+// page cache flushes them whenever it likes.
+//
+// A background checkpointer syncs the data file once the log grows past
+// Options::wal_checkpoint_size() and empties the log. On open, the records
+// left in the log are replayed onto the data file, so it ends up at the last
+// transaction whose record made it to disk. A log that ends before the meta
+// of the data file is stale, e.g. the database was committed to without it,
+// and is discarded.
+class Wal {
+ public:
+  constexpr static const u32 kMagic = 0x3A11B0C7;
+
+  // The log is extended with zeros this many bytes at a time.
+  constexpr static const i64 kExtendSize = 1 << 20;
+
+  // Get the path of the log of the database at `db_path`.
+  static std::string path_of(const std::string& db_path) { return db_path + "-wal"; }
+
+  // Open the log of the database whose data file is `data_file`, replay it
+  // onto the data file and start the checkpointer. `data_meta` is the newest
+  // valid meta of the data file, nullptr if it has none.
+  static Status open(FileHandle* data_file, const Meta* data_meta, i64 checkpoint_size, bool no_sync,
+                     std::unique_ptr<Wal>& out_wal);
+
+  // Same as above, with the log read from and appended to `file_handle`.
+  static Status open(std::unique_ptr<FileHandle> file_handle, FileHandle* data_file, const Meta* data_meta,
+                     i64 checkpoint_size, bool no_sync, std::unique_ptr<Wal>& out_wal);
+
+  // Return true if the log of the database at `db_path` holds a valid record,
+  // which only replaying can bring into the data file.
+  static bool has_records(const std::string& db_path);
+
+  // Stop the checkpointer and checkpoint the log.
+  ~Wal();
+
+  DISALLOW_COPY_AND_ASSIGN(Wal);
+
+  // Run of `count` contiguous pages starting at `pgid`.
+  struct Pages {
+    PageID pgid;
+    u64 count;
+    const Byte* data;
+  };
+
+  // Append a record of `meta` and `pages` to the log and sync it, then call
+  // `apply` to write them to the data file. Checkpoints wait until `apply`
+  // returns, so they never drop a record whose pages are not in the data
+  // file yet.
+  Status append(const Meta& meta, const std::vector<Pages>& pages, int page_size,
+                const std::function<Status()>& apply);
+
+  // Sync the data file and empty the log.
+  Status checkpoint();
+
+  // Get the size of the records in the log, in bytes.
+  i64 size() const;
+
+  // Get the number of checkpoints that emptied the log.
+  i64 checkpoint_count() const;
+
+  // Get the number of records newer than the data file that were replayed
+  // when the log was opened.
+  i64 replayed_count() const { return replayed_count_; }
+
+ private:
+  struct RecordHeader {
+    u32 magic;
+    u32 page_size;
+    TxnID txid;
+    u64 size;      // Size of the body, which follows the header
+    u64 checksum;  // crc64 of the body
+  };
+
+  Wal(std::unique_ptr<FileHandle> file_handle, FileHandle* data_file, i64 checkpoint_size, bool no_sync)
+      : file_handle_(std::move(file_handle)),
+        data_file_(data_file),
+        checkpoint_size_(checkpoint_size),
+        no_sync_(no_sync) {}
+
+  // Read the header and the body of the record at `offset` into `header`
+  // and `body`. Return false if there's no valid record there.
+  static bool read_record(FileHandle& file, std::size_t offset, std::size_t file_size, RecordHeader& header,
+                          std::vector<Byte>& body);
+
+  // Apply the valid records of the log to the data file, in order. Records
+  // up to `data_meta` only rewrite the pages the data file doesn't hold: its
+  // meta may have reached the disk ahead of their pages.
+  Status replay(const Meta* data_meta);
+
+  // Write the pages of the record `body` to the data file, only the ones that
+  // differ from what it holds if `changed_only` is set.
+  Status apply_record(const RecordHeader& header, const std::vector<Byte>& body, bool changed_only);
+
+  // Empty the log. The caller holds `mutex_`.
+  Status reset();
+
+  // Extend the log with zeros to at least `size` bytes, so that syncing the
+  // records appended up to there doesn't have to update the size of the file
+  // every time. The caller holds `mutex_`.
+  Status extend(i64 size);
+
+  // Overwrite the header of the record at `offset`, so that replaying stops
+  // there.
+  Status invalidate(i64 offset);
+
+  // Checkpoint whenever the log grows past the threshold.
+  void run_checkpointer();
+
+  std::unique_ptr<FileHandle> file_handle_;
+  FileHandle* data_file_;
+  i64 checkpoint_size_;
+  bool no_sync_;
+  i64 replayed_count_{};
+
+  mutable std::mutex mutex_;  // Protects the fields below
+  std::condition_variable cond_;
+  i64 size_{};
+  i64 allocated_{};  // Size of the file
+  i64 checkpoint_count_{};
+  bool stopped_{};
+  std::thread checkpointer_;
+};
+
+}  // namespace boltdb
+
+#endif  // BOLTDB_CPP_DB_WAL_HPP_
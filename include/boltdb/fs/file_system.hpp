@@ -33,6 +33,9 @@ class FileHandle {
                         std::size_t offset) = 0;
   virtual void close() = 0;
 
+  // Get the underlying file descriptor, which is used to mmap the file.
+  virtual int fd() const = 0;
+
   // fdatasync() is similar to fsync(), but does not flush modified metadata
   // unless that metadata is needed order to allow a subsequent data retrieval
   // to be correctly handled. For example, changes to `st_atime`or `st_mtime`
@@ -43,6 +46,18 @@ class FileHandle {
   // flush.
   virtual Status fdatasync() = 0;
 
+  // Flush the data and all the metadata of the file, such as its size, to
+  // disk.
+  virtual Status fsync() = 0;
+
+  // Preallocate disk space for the byte range [offset, offset + nbytes),
+  // extending the file if needed. This uses fallocate(2) where it's supported
+  // and falls back to extending the file with ftruncate(2).
+  virtual Status allocate(std::size_t offset, std::size_t nbytes) = 0;
+
+  // Truncate or extend the file to exactly `size` bytes.
+  virtual Status truncate(std::size_t size) = 0;
+
   // Applies or removes an advisory lock on the file associated with the file
   // descriptor fd.
   // A lock is applied by specifying an operation parameter that is one of
@@ -63,6 +78,9 @@ class FileHandle {
   //  Processes blocked awaiting a lock may be awakened by signals.
   virtual Status flock(int operation, double timeout_s) = 0;
 
+  // Return true if the file only lives in memory and is gone once closed.
+  virtual bool in_memory() const { return false; }
+
   std::string path;
 };
 
@@ -80,6 +98,12 @@ class FileSystem {
   static std::unique_ptr<FileHandle> open(const char* path, int oflag,
                                           int permission) noexcept;
 
+  // Create an anonymous file backed by memory. `name` is only used for
+  // debugging, it shows up in /proc/self/fd. The path of the returned handle
+  // refers to the file through /proc for as long as the handle is open.
+  // Return nullptr if there is an error.
+  static std::unique_ptr<FileHandle> create_memory(const char* name) noexcept;
+
   // Check if the given file corresponds to an existing file or directory.
   // Return true if the given path or file status corresponds to an existing
   // file or directory, false otherwise.
@@ -47,6 +47,12 @@ class FreeList {
   // Moves all page ids for a transaction id (or older) to the freelist.
   void release(TxnID txn_id);
 
+  // Remove the run of free pages ending right below `high_water_mark` if it's
+  // at least `min_count` pages long, and return the first page of the run,
+  // which is the new high water mark. Return `high_water_mark` if the run is
+  // too short. Pending pages are never removed.
+  PageID trim(PageID high_water_mark, int min_count);
+
   // Removes the pages from the given pending tx.
   void rollback(TxnID txn_id);
 
@@ -2,7 +2,6 @@
 #define BOLTDB_CPP_PAGE_NODE_HPP_
 
 #include <cstdint>
-#include <numeric>
 // #include <variant>
 #include <vector>
 
@@ -15,6 +14,8 @@
 namespace boltdb {
 
 class Bucket;
+class Node;
+class ThreadPool;
 
 // Inode represents an internal node inside of a node.
 // It can be used to point to elements in a page
@@ -29,6 +30,13 @@ struct Inode {
   // std::variant<PageID, ByteSlice> value;
 };
 
+// SpilledNode is a node which has been assigned a dirty page during spill but
+// hasn't been written to it yet.
+struct SpilledNode {
+  Node* node;
+  Page* page;
+};
+
 // Node represents an in-memory, deserialized page.
 class Node {
  public:
@@ -49,6 +57,9 @@ class Node {
   // Return true if this node is leaf otherwise false.
   bool is_leaf() const { return is_leaf_; }
 
+  // Get the page of the node, 0 until a new node is spilled.
+  PageID pgid() const { return pgid_; }
+
   // Return the minimum number of inodes this node should have.
   int min_keys() const {
     if (is_leaf_) {
@@ -59,12 +70,10 @@ class Node {
   }
 
   // Return the size of the node after serialization.
-  int byte_size() const;
+  int byte_size() const { return kPageHeaderSize + static_cast<int>(inodes_.size()) * page_element_size() + data_size_; }
 
   // Return true if the node is less than the  given size.
-  // This is an optimization to avoid calculating a large node when we only need
-  // to know if it fits inside a certain page size.
-  bool is_size_less_than(int v) const;
+  bool is_size_less_than(int v) const { return byte_size() < v; }
 
   // Return the size of each page element based on the type of node.
   int page_element_size() const {
@@ -85,6 +94,9 @@ class Node {
   // Get the number of children.
   int num_children() const;
 
+  // Get the inodes, sorted by key.
+  const std::vector<Inode>& inodes() const { return inodes_; }
+
   // Get the next node with the same parent.
   Node* next_sibling() const;
 
@@ -98,32 +110,67 @@ class Node {
   // Remove a key from the node.
   void remove(ByteSlice key);
 
+  // Merge the node with a sibling if deletes left it below the merge
+  // threshold of its bucket, and collapse a root branch with a single child.
+  // Merging removes a key from the parent, which is then rebalanced too.
+  void rebalance();
+
   // Initializes the node from a page.
   void read(const Page& page);
 
   // Writes the items onto one or more pages.
   void write(Page& page);
 
+  // Writes the nodes to dirty pages and splits nodes as it goes.
+  // Return an error if the dirty pages cannot be allocated.
+  //
+  // Pages are allocated by the calling thread in the same order as a
+  // sequential spill, and the nodes are encoded once all of them have a page.
+  // If the database has a spill pool, the encoding runs on the pool.
+  Status spill();
+
+  // Assigns dirty pages to this subtree and collects the nodes to write,
+  // which write_all() then encodes. This is how a bucket spills the nodes of
+  // its nested buckets along with its own.
+  Status spill_to(std::vector<SpilledNode>& spilled);
+
+  // Writes every spilled node to its page, on `pool` if it's not null.
+  // Each node only writes its own page so the result doesn't depend on the
+  // order the nodes are written in.
+  static void write_all(const std::vector<SpilledNode>& spilled, ThreadPool* pool);
+
  private:
   // Find the first satisfied index such that inodes_[index].key >= key.
   int index_of(ByteSlice key);
 
+  // Return true if this node is the last child of each of its ancestors.
+  bool is_right_edge() const;
+
+  // Remove a node from the list of in-memory children.
+  // This doesn't affect the inodes.
+  void remove_child(const Node* target);
+
+  // Move the materialized children of the inodes under this node.
+  void adopt_children();
+
+  // Add the node's underlying page to the freelist, and drop the node from
+  // the node cache of the bucket.
+  void free();
+
   // Breaks up a node into multiple smaller nodes, if appropriate.
   // This should only be called from the `spill()` function.
   std::vector<Node*> split(int page_size);
 
-  // Writes the nodes to dirty pages and splits nodes as it goes.
-  // Return an error if the dirty pages cannot be allocated.
-  Status spill();
-
-  // Breaks up a node into two smaller nodes, if appropriate.
+  // Return true if the inodes starting at `first` don't fit in a single page
+  // and are enough for two pages. `sizes[i]` is the serialized size of the
+  // elements before inode `i`.
   // This should only be called from the `split()` function.
-  std::pair<Node*, Node*> split_two(int page_size);
+  bool can_split(const std::vector<int>& sizes, int first, int page_size) const;
 
-  // Finds the position where a page will fill a given threshold.
-  // It returns the index as well as the size of the first page.
+  // Finds the position where a page starting at inode `first` will fill a
+  // given threshold. It returns the index as well as the size of the page.
   // This is only be called from split().
-  std::pair<int, int> split_index(int threshold);
+  std::pair<int, int> split_index(const std::vector<int>& sizes, int first, int threshold) const;
 
   bool is_leaf_{};
   bool unbalanced_{};
@@ -134,6 +181,9 @@ class Node {
   ByteSlice first_key_;
   std::vector<Node*> children_;
   std::vector<Inode> inodes_;
+  // Total size of the keys and values of the inodes, kept up to date by every
+  // change to them so that byte_size() doesn't have to walk the inodes.
+  int data_size_{};
 };
 
 }  // namespace boltdb
@@ -3,6 +3,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <span>
 #include <string>
 #include <vector>
@@ -35,10 +36,25 @@ class PageHeader {
 
 // `Page` represents a generic page structure, which could be converted to
 // `meta`, `freelist`, `branch` and `leaf` pages.
+//
+// A page either owns a buffer of `page_size` bytes or is a view over memory
+// owned by someone else (typically the mmap). Views are cheap to copy and
+// never allocate. Copies of an owning page share the same buffer.
 class Page {
  public:
+  // Construct an empty page that doesn't reference any memory.
+  Page() = default;
+
+  // Construct a page which owns a zeroed buffer of `page_size` bytes.
   Page(PageID pgid, PageFlag flag, int page_size);
 
+  // Construct a view over `page_size` bytes starting at `data`.
+  // The memory must outlive the page.
+  Page(Byte* data, int page_size) : page_size_(page_size), pheader_(reinterpret_cast<PageHeader*>(data)) {}
+
+  // Return true if the page doesn't reference any memory.
+  bool is_null() const { return pheader_ == nullptr; }
+
   // Accessor.
   PageFlag flag() const { return pheader_->flag; }
   u16 count() const { return pheader_->count; }
@@ -54,8 +70,8 @@ class Page {
   std::string type() const;
 
   // Get underlying page data.
-  const Byte* data() const { return pdata_.data(); }
-  Byte* data() { return pdata_.data(); }
+  const Byte* data() const { return reinterpret_cast<const Byte*>(pheader_); }
+  Byte* data() { return reinterpret_cast<Byte*>(pheader_); }
 
   // Get page size in bytes.
   std::size_t page_size() const { return page_size_; }
@@ -81,14 +97,15 @@ class Page {
   void hexdump(std::ostream& os) const;
 
  private:
+  friend class DB;
   friend class FreeList;
 
   template <typename T>
   T* cast_ptr() const;
 
-  int page_size_;        // Page size
-  PageHeader* pheader_;  // Page header
-  ByteSlice pdata_;      // Page data
+  int page_size_{};                 // Page size
+  PageHeader* pheader_{};           // Page header, points to the page data
+  std::shared_ptr<Byte[]> pdata_;  // Page data, null if this is a view
 };
 
 // BranchPageElement represents a node on a branch page.
@@ -99,6 +116,9 @@ class BranchPageElement {
   // Get a byte slice of the node key.
   ByteSlice key() const;
 
+  // Get a view of the node key without copying it.
+  std::span<const Byte> key_view() const;
+
   u32 pos;
   u32 key_size;
   PageID pgid;
@@ -116,6 +136,10 @@ class LeafPageElement {
   // Get a byte slice of the node value.
   ByteSlice value() const;
 
+  // Get views of the node key and value without copying them.
+  std::span<const Byte> key_view() const;
+  std::span<const Byte> value_view() const;
+
   u32 flags;
   u32 pos;
   u32 key_size;
@@ -0,0 +1,80 @@
+#ifndef BOLTDB_CPP_TRANSACTION_READER_REGISTRY_HPP_
+#define BOLTDB_CPP_TRANSACTION_READER_REGISTRY_HPP_
+
+#include <atomic>
+#include <memory>
+
+#include "boltdb/util/common.hpp"
+#include "boltdb/util/options.hpp"
+#include "boltdb/util/types.hpp"
+
+namespace boltdb {
+
+// ReaderRegistry keeps track of the transaction ids of all the open read-only
+// transactions without taking a lock.
+//
+// Each reader claims one slot of a fixed size array and publishes the id and
+// the high water mark of the meta page it is reading from. The writer scans all the slots to find the
+// oldest id that is still in use, and only pages freed before that id can be
+// moved back to the freelist. Slots are padded to a cache line so that readers
+// running on different cores never share a line.
+class ReaderRegistry {
+ public:
+  // Marker value stored in a slot that is not owned by any reader.
+  static constexpr const TxnID kIdle = ~TxnID{0};
+
+  // Marker value stored in a slot that has been claimed but whose transaction
+  // id has not been published yet. It's treated as the oldest possible reader
+  // so the writer never releases pages the reader is about to see.
+  static constexpr const TxnID kClaimed = 0;
+
+  // High water mark of a reader that hasn't published its meta yet.
+  static constexpr const PageID kUnknownPgid = ~PageID{0};
+
+  explicit ReaderRegistry(int max_readers = Options::kDefaultMaxReaders);
+
+  DISALLOW_COPY_AND_ASSIGN(ReaderRegistry);
+
+  // Claim a free slot and return its index.
+  // Return -1 if all the slots are in use.
+  int acquire();
+
+  // Publish the transaction id and the high water mark of the meta the reader
+  // in the given slot is reading from.
+  void publish(int slot, TxnID txn_id, PageID pgid) {
+    slots_[slot].pgid.store(pgid, std::memory_order_relaxed);
+    slots_[slot].txn_id.store(txn_id, std::memory_order_seq_cst);
+  }
+
+  // Give the slot back once the reader is done.
+  void release(int slot) { slots_[slot].txn_id.store(kIdle, std::memory_order_release); }
+
+  // Get the smallest transaction id published by any reader.
+  // Return `fallback` if there are no open readers.
+  TxnID oldest(TxnID fallback) const;
+
+  // Get the largest high water mark published by any reader.
+  // Return `fallback` if there are no open readers, and kUnknownPgid if a
+  // reader has claimed a slot but not published yet: it may be reading any
+  // meta.
+  PageID highest_pgid(PageID fallback) const;
+
+  // Get the number of slots that are currently claimed.
+  int count() const;
+
+  // Get the maximum number of concurrent readers.
+  int capacity() const { return capacity_; }
+
+ private:
+  struct alignas(64) Slot {
+    std::atomic<TxnID> txn_id{kIdle};
+    std::atomic<PageID> pgid{0};  // Only valid once `txn_id` is published
+  };
+
+  int capacity_;
+  std::unique_ptr<Slot[]> slots_;
+};
+
+}  // namespace boltdb
+
+#endif  // BOLTDB_CPP_TRANSACTION_READER_REGISTRY_HPP_
@@ -1,11 +1,18 @@
 #ifndef BOLTDB_CPP_TRANSACTION_HPP_
 #define BOLTDB_CPP_TRANSACTION_HPP_
 
+#include <chrono>
 #include <functional>
-#include <map>
+#include <iosfwd>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "boltdb/db/db_meta.hpp"
 #include "boltdb/util/common.hpp"
+#include "boltdb/util/page_map.hpp"
+#include "boltdb/util/status.hpp"
 #include "boltdb/util/types.hpp"
 
 namespace boltdb {
@@ -29,18 +36,25 @@ class Page;
 // transaction.
 struct TxnStats {
  public:
-  int page_count{};           // Number of page allocations
-  int page_alloc{};           // Total bytes allocated
-  int cursor_count{};         // Number of cursors created
-  int node_count{};           // Number of node allocations
-  int node_deref{};           // Number of node dereferences
-  int rebalance{};            // Number of node rebalances
+  i64 page_count{};           // Number of page allocations
+  i64 page_alloc{};           // Total bytes allocated
+  i64 cursor_count{};         // Number of cursors created
+  i64 node_count{};           // Number of node allocations
+  i64 node_deref{};           // Number of node dereferences
+  i64 rebalance{};            // Number of node rebalances
   Duration rebalance_time{};  // Total time spent on rebalancing
-  int split{};                // Number of nodes split
-  int spill{};                // Number of nodes spilled
+  i64 split{};                // Number of nodes split
+  i64 append_split{};         // Number of nodes split full in append mode
+  i64 spill{};                // Number of nodes spilled
+  i64 spill_bytes{};          // Total serialized bytes of the spilled nodes
+  i64 spill_alloc{};          // Total bytes of the pages they were written to
   Duration spill_time{};      // Total time spent on spilling
-  int write{};                // Number of writes performed
+  i64 write{};                // Number of writes performed
+  i64 write_bytes{};          // Total bytes written to the data file
   Duration write_time{};      // Total time spent on writing to disk
+
+  // Return how full the spilled pages are, between 0 and 1.
+  f64 spill_fill_ratio() const { return spill_alloc == 0 ? 0 : static_cast<f64>(spill_bytes) / spill_alloc; }
 };
 
 inline TxnStats operator+(const TxnStats& lhs, const TxnStats& rhs) {
@@ -56,9 +70,13 @@ inline TxnStats operator+(const TxnStats& lhs, const TxnStats& rhs) {
   ADD(result, lhs, rhs, rebalance);
   ADD(result, lhs, rhs, rebalance_time);
   ADD(result, lhs, rhs, split);
+  ADD(result, lhs, rhs, append_split);
   ADD(result, lhs, rhs, spill);
+  ADD(result, lhs, rhs, spill_bytes);
+  ADD(result, lhs, rhs, spill_alloc);
   ADD(result, lhs, rhs, spill_time);
   ADD(result, lhs, rhs, write);
+  ADD(result, lhs, rhs, write_bytes);
   ADD(result, lhs, rhs, write_time);
 
 #undef ADD
@@ -82,9 +100,13 @@ inline TxnStats operator-(const TxnStats& lhs, const TxnStats& rhs) {
   SUB(result, lhs, rhs, rebalance);
   SUB(result, lhs, rhs, rebalance_time);
   SUB(result, lhs, rhs, split);
+  SUB(result, lhs, rhs, append_split);
   SUB(result, lhs, rhs, spill);
+  SUB(result, lhs, rhs, spill_bytes);
+  SUB(result, lhs, rhs, spill_alloc);
   SUB(result, lhs, rhs, spill_time);
   SUB(result, lhs, rhs, write);
+  SUB(result, lhs, rhs, write_bytes);
   SUB(result, lhs, rhs, write_time);
 
 #undef SUB
@@ -103,44 +125,142 @@ inline TxnStats operator-(const TxnStats& lhs, const TxnStats& rhs) {
 // quickly grow.
 class Txn {
  public:
+  // Construct a transaction on the given database.
+  // Transactions should be obtained through `DB::begin()`, which initializes
+  // the meta and registers the transaction with the database.
+  Txn(DB* db, bool writable) : writable_(writable), db_(db) {}
+
+  DISALLOW_COPY_AND_ASSIGN(Txn);
+
   // WriteFlag specifies the flag for write-related methods like WriteTo().
   // Tx opens the database file with the specified flag to copy the data.
   //
   // By default, the flag is unset, which works well for mostly in-memory
   // workloads. For databases that are much larger than available RAM,
   // set the flag to syscall.O_DIRECT to avoid trashing the page cache.
-  int write_flag;
+  int write_flag{};
+
+  // WriteRateLimit caps how fast WriteTo() copies the database, in MB/s, so
+  // that a backup doesn't starve foreground I/O. Zero means no limit.
+  int write_rate_limit{};
+
+  // Get the transaction id.
+  TxnID id() const { return meta_.txid; }
+
+  // Get the database the transaction was created from.
+  // Return nullptr once the transaction has been closed.
+  DB* db() const { return db_; }
 
   // Get a reference to the page with a given page id.
   // If page has been written to then a temporary buffered page is returned.
-  Page* page(PageID pgid);
+  Page page(PageID pgid);
 
   bool is_writable() const { return writable_; }
 
+  // Get the current database size in bytes as seen by this transaction.
+  i64 size() const;
+
+  // Write the entire database to a stream. The two meta pages are generated
+  // from the transaction's meta, the rest is copied from the database file
+  // with large sequential reads. This is a consistent snapshot as long as the
+  // transaction is open, writers can keep committing meanwhile.
+  Status write_to(std::ostream& out, i64& out_written);
+
+  // Write the entire database to the file descriptor `fd`, starting at its
+  // current offset. The data pages are copied in the kernel with
+  // copy_file_range() when possible.
+  Status write_to(int fd, i64& out_written);
+
+  // Copy the entire database to the file at `path`, which is created with
+  // `mode` or truncated, and synced to disk.
+  Status copy_file(const std::string& path, int mode);
+
+  // Writes all changes to disk and updates the meta page.
+  // Returns an error if a disk write error occurs, or if commit is
+  // called on a read-only transaction.
+  Status commit();
+
+  // Closes the transaction and ignores all previous updates. Read-only
+  // transactions must be rolled back and not committed.
+  Status rollback();
+
   // Provide temporarily to support other classes (Node and etc).
 
   // Return the page id stored in meta data.
-  PageID meta_page_id() const { return meta_->pgid; }
+  PageID meta_page_id() const { return meta_.pgid; }
+
+  // Get the meta seen by the transaction.
+  const Meta& meta() const { return meta_; }
+
+  // Get the root bucket seen by the transaction.
+  BucketMeta root() const { return meta_.root; }
+
+  // Get the memory resource for objects that live as long as the
+  // transaction, such as nested buckets. Nothing is released before the
+  // transaction is deleted.
+  std::pmr::memory_resource* arena() { return &arena_; }
+
+  // Get the root bucket, opened on first use. The nodes materialized in it
+  // and in the nested buckets opened from it are written on commit.
+  Bucket* root_bucket();
+
+  // Replace the root bucket with the tree rooted at `root.root`, e.g. one
+  // built by a BulkLoader. The pages of the previous tree, including the ones
+  // of its nested buckets, are freed. A root bucket opened before is closed
+  // and its changes are dropped.
+  Status set_root(const BucketMeta& root);
 
   TxnStats stats{};
 
   // TODO(gc): add these methods temporarily.
-  int page_size() const { return db_->page_size(); }
-  void free(PageID pgid) { db_->free(meta_->txid, *page(pgid)); }
+  int page_size() const;
+  void free(PageID pgid);
 
   // Returns a contigous block of memory starting at a given page.
   Status allocate(int count, Page*& out_page);
 
  private:
   friend class Bucket;
+  friend class BulkLoader;
+  friend class DB;
+
+  // Detach the transaction from the database.
+  void close();
+
+  // Writes any dirty pages to disk.
+  Status write();
+
+  // Writes the meta to the disk.
+  Status write_meta();
+
+  // Get the pages written by the transaction, as runs of contiguous pages.
+  std::vector<PageRun> written_runs() const;
+
+  // Fill the commit record of the meta page with the written pages.
+  void write_commit_record(Page& meta_page) const;
+
+  // Copy the database into `fd` if it is not -1, otherwise into `out`.
+  Status copy_to(int fd, std::ostream* out, i64& out_written);
+
+  // Free every page of the tree rooted at the given page, and of the nested
+  // buckets it holds.
+  void free_tree(PageID pgid);
+
+  // Destroy the root bucket, if it was opened.
+  void close_root_bucket();
 
   bool writable_;
-  bool managed_;
+  bool managed_{};
+  bool single_sync_{};  // Pages and meta are synced together
   DB* db_;
-  Meta* meta_;
-  Bucket* bucket_;
-  std::map<PageID, Page*> pages_;
+  Meta meta_{};
+  int reader_slot_{-1};  // Slot in the reader registry, read-only only
+  Bucket* bucket_{};  // Root bucket, in the arena
+  PageMap<Page*> pages_;  // Dirty pages, in no particular order
+  std::vector<std::pair<PageID, PageID>> appended_;  // [first, last) pages written by bulk loaders
   std::function<void()> commit_handlers_;
+  std::pmr::monotonic_buffer_resource arena_;
+  std::chrono::steady_clock::time_point start_;  // When a read-only transaction began
 };
 
 }  // namespace boltdb
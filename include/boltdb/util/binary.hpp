@@ -1,6 +1,8 @@
 #ifndef BOLTDB_CPP_UTIL_BINARY_HPP_
 #define BOLTDB_CPP_UTIL_BINARY_HPP_
 
+#include <bit>
+#include <cstring>
 #include <span>
 #include <type_traits>
 
@@ -9,9 +11,65 @@
 
 namespace boltdb::binary {
 
+// Reverse the bytes of an unsigned integer.
+template <typename T>
+  requires std::is_unsigned_v<T>
+constexpr T byteswap(T v) {
+  if constexpr (sizeof(T) == sizeof(u8)) {
+    return v;
+  } else if constexpr (sizeof(T) == sizeof(u16)) {
+    return __builtin_bswap16(v);
+  } else if constexpr (sizeof(T) == sizeof(u32)) {
+    return __builtin_bswap32(v);
+  } else {
+    static_assert(sizeof(T) == sizeof(u64));
+    return __builtin_bswap64(v);
+  }
+}
+
 // Adapt from Go.
+//
+// load_uint(), store_uint() and store_variadic_uint() work on raw buffers
+// provided by the caller: one unaligned memcpy and at most one byte swap per
+// integer, no allocation.
 class BigEndian {
  public:
+  // Read an integer stored at `in`, which doesn't need to be aligned.
+  template <typename T>
+    requires std::is_integral_v<T>
+  static std::make_unsigned_t<T> load_uint(const Byte* in) {
+    std::make_unsigned_t<T> v;
+    std::memcpy(&v, in, sizeof(v));
+
+    if constexpr (std::endian::native == std::endian::little) {
+      v = byteswap(v);
+    }
+
+    return v;
+  }
+
+  // Write `v` at `out` and return the position right after it.
+  template <typename T>
+    requires std::is_integral_v<T>
+  static Byte* store_uint(Byte* out, T v) {
+    auto u = static_cast<std::make_unsigned_t<T>>(v);
+
+    if constexpr (std::endian::native == std::endian::little) {
+      u = byteswap(u);
+    }
+
+    std::memcpy(out, &u, sizeof(u));
+
+    return out + sizeof(u);
+  }
+
+  template <typename... Integers>
+    requires std::is_integral_v<std::common_type_t<Integers...>>
+  static Byte* store_variadic_uint(Byte* out, Integers... integers) {
+    (..., (out = store_uint(out, integers)));
+    return out;
+  }
+
   template <typename T>
     requires std::is_integral_v<T>
   static std::make_unsigned_t<T> uint(ByteSlice slice) {
@@ -122,6 +180,42 @@ class BigEndian {
 
 class LittleEndian {
  public:
+  // Read an integer stored at `in`, which doesn't need to be aligned.
+  template <typename T>
+    requires std::is_integral_v<T>
+  static std::make_unsigned_t<T> load_uint(const Byte* in) {
+    std::make_unsigned_t<T> v;
+    std::memcpy(&v, in, sizeof(v));
+
+    if constexpr (std::endian::native == std::endian::big) {
+      v = byteswap(v);
+    }
+
+    return v;
+  }
+
+  // Write `v` at `out` and return the position right after it.
+  template <typename T>
+    requires std::is_integral_v<T>
+  static Byte* store_uint(Byte* out, T v) {
+    auto u = static_cast<std::make_unsigned_t<T>>(v);
+
+    if constexpr (std::endian::native == std::endian::big) {
+      u = byteswap(u);
+    }
+
+    std::memcpy(out, &u, sizeof(u));
+
+    return out + sizeof(u);
+  }
+
+  template <typename... Integers>
+    requires std::is_integral_v<std::common_type_t<Integers...>>
+  static Byte* store_variadic_uint(Byte* out, Integers... integers) {
+    (..., (out = store_uint(out, integers)));
+    return out;
+  }
+
   template <typename T>
     requires std::is_integral_v<T>
   static std::make_unsigned_t<T> uint(ByteSlice slice) {
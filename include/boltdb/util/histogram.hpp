@@ -0,0 +1,100 @@
+#ifndef BOLTDB_CPP_UTIL_HISTOGRAM_HPP_
+#define BOLTDB_CPP_UTIL_HISTOGRAM_HPP_
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+#include "boltdb/util/sharded_counters.hpp"
+#include "boltdb/util/types.hpp"
+
+namespace boltdb {
+
+// HistogramSnapshot is a copy of the counts of a Histogram, which can be
+// queried for percentiles.
+class HistogramSnapshot {
+ public:
+  // Durations are counted in nanoseconds, split in kSubBuckets buckets per
+  // power of two, so a bucket is at most 1/16 of its values wide. Durations
+  // of 2^kMaxBits ns (about 68s) and more are counted in the last bucket.
+  static constexpr int kSubBucketBits = 4;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  static constexpr int kMaxBits = 36;
+  static constexpr int kBuckets = (kMaxBits - kSubBucketBits + 1) << kSubBucketBits;
+
+  using Counts = std::array<i64, kBuckets>;
+
+  HistogramSnapshot() = default;
+  HistogramSnapshot(const Counts& counts, i64 sum_nanos);
+
+  // Get the bucket of a duration in nanoseconds.
+  static int bucket_of(i64 nanos) {
+    u64 v = std::min<u64>(std::max<i64>(nanos, 0), (u64{1} << kMaxBits) - 1);
+    int shift = std::max(0, static_cast<int>(std::bit_width(v)) - kSubBucketBits - 1);
+
+    return (shift << kSubBucketBits) + static_cast<int>(v >> shift);
+  }
+
+  // Get the largest duration in nanoseconds counted in a bucket.
+  static i64 bucket_upper_bound(int bucket) {
+    int shift = std::max(0, (bucket >> kSubBucketBits) - 1);
+    i64 mantissa = bucket - (shift << kSubBucketBits);
+
+    return ((mantissa + 1) << shift) - 1;
+  }
+
+  // Get the number of durations recorded in each bucket.
+  const Counts& counts() const { return counts_; }
+
+  // Get the number of durations recorded.
+  i64 count() const { return count_; }
+
+  // Get the sum of the durations recorded.
+  Duration sum() const { return Duration(static_cast<f64>(sum_nanos_) / 1e9); }
+
+  // Get the mean of the durations recorded.
+  Duration mean() const;
+
+  // Get the duration that `percentile` percent of the durations don't exceed,
+  // e.g. percentile(99.9), rounded up to the end of its bucket.
+  // Return zero if nothing was recorded.
+  Duration percentile(f64 percentile) const;
+
+  // Get the largest duration recorded, rounded up to the end of its bucket.
+  Duration max() const { return percentile(100); }
+
+ private:
+  Counts counts_{};
+  i64 count_{};
+  i64 sum_nanos_{};
+};
+
+// Histogram counts durations in log-linear buckets, in the manner of an HDR
+// histogram, so that tail percentiles can be read with a bounded relative
+// error. Threads record without contending on a shared line and without a
+// lock, see ShardedCounters.
+class Histogram {
+ public:
+  Histogram() = default;
+
+  DISALLOW_COPY_AND_ASSIGN(Histogram);
+
+  // Count one duration.
+  void record(Duration duration) {
+    i64 nanos = static_cast<i64>(duration.count() * 1e9);
+
+    counts_.add(HistogramSnapshot::bucket_of(nanos), 1);
+    counts_.add(HistogramSnapshot::kBuckets, std::max<i64>(nanos, 0));
+  }
+
+  // Get a copy of the counts, which keeps changing while threads record.
+  HistogramSnapshot snapshot() const;
+
+ private:
+  // The buckets, followed by the sum of the durations.
+  ShardedCounters<HistogramSnapshot::kBuckets + 1> counts_;
+};
+
+}  // namespace boltdb
+
+#endif  // BOLTDB_CPP_UTIL_HISTOGRAM_HPP_
@@ -1,6 +1,14 @@
 #ifndef BOLTDB_CPP_UTIL_MEMORY_MAP_HPP_
 #define BOLTDB_CPP_UTIL_MEMORY_MAP_HPP_
 
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "boltdb/util/common.hpp"
+#include "boltdb/util/status.hpp"
+#include "boltdb/util/types.hpp"
+
 namespace boltdb {
 
 // mmap() creates a new mapping in the virtual address space of the calling process.
@@ -22,8 +30,68 @@ namespace boltdb {
 //
 // After the `mmap()` call has returned, the file descriptor, `fd`, can be closed immediately without
 // invalidating the mapping.
-class MemoryMap {};
+//
+// MemoryMap maps a file read-only into a large range of address space that is
+// reserved up front with PROT_NONE. Growing the mapping maps more of the file
+// in place with MAP_FIXED, so the base address never changes and pointers
+// handed out to readers stay valid while the file grows. Readers never have to
+// wait for a remap.
+//
+// If the file outgrows the reservation, a new larger range is reserved and the
+// old one is retired rather than unmapped: both map the same file with
+// MAP_SHARED, so readers still holding old pointers keep seeing valid data.
+// Retired ranges are released when the map is closed.
+class MemoryMap {
+ public:
+  MemoryMap() = default;
+  ~MemoryMap();
+
+  DISALLOW_COPY_AND_ASSIGN(MemoryMap);
+
+  // Reserve `reserve_size` bytes of address space and map the first `size`
+  // bytes of the file referred to by `fd`. `flags` are extra mmap flags, such
+  // as MAP_POPULATE.
+  Status map(int fd, std::size_t size, std::size_t reserve_size, int flags);
+
+  // Extend the mapping to cover the first `size` bytes of the file.
+  // Shrinking is a no-op.
+  Status grow(std::size_t size);
+
+  // Release all the mappings.
+  Status unmap();
+
+  // Get the base address of the mapping.
+  Byte* data() const { return data_.load(std::memory_order_acquire); }
+
+  // Get the number of bytes currently mapped.
+  std::size_t size() const { return size_.load(std::memory_order_acquire); }
+
+  // Get the number of bytes of reserved address space.
+  std::size_t reserved() const { return reserved_; }
+
+  // Get the number of times the mapping had to move to a new reservation.
+  int relocations() const { return static_cast<int>(retired_.size()); }
+
+ private:
+  struct Region {
+    Byte* base;
+    std::size_t reserved;
+  };
+
+  // Reserve `reserve_size` bytes of inaccessible address space.
+  static Byte* reserve(std::size_t reserve_size);
+
+  // Map [offset, offset + length) of the file at `base + offset`.
+  Status map_range(Byte* base, std::size_t offset, std::size_t length) const;
+
+  int fd_{-1};
+  int flags_{};
+  std::atomic<Byte*> data_{};
+  std::atomic<std::size_t> size_{};
+  std::size_t reserved_{};
+  std::vector<Region> retired_;
+};
 
 }  // namespace boltdb
 
-#endif  // BOLTDB_CPP_UTIL_MEMORY_MAP_HPP_
\ No newline at end of file
+#endif  // BOLTDB_CPP_UTIL_MEMORY_MAP_HPP_
@@ -13,21 +13,33 @@ class Options {
   constexpr static const int kDefaultMaxBatchSize = 1000;
   constexpr static const int kDefaultMaxBatchDelay = 10;
   constexpr static const int kDefaultAllocSize = 16 * 1024 * 1024;
+  constexpr static const int kDefaultMaxReaders = 1024;
+  constexpr static const i64 kDefaultMmapReserveSize = 1LL << 40;  // 1TB
+  constexpr static const i64 kDefaultWalCheckpointSize = 64 * 1024 * 1024;
 
   // Accessor
   bool is_strict_mode() const { return strict_mode_; }
   bool is_no_sync() const { return no_sync_; }
   bool is_no_grow_sync() const { return no_grow_sync_; }
   bool is_read_only() const { return read_only_; }
+  bool is_track_page_txids() const { return track_page_txids_; }
+  bool is_wal() const { return wal_; }
+  bool is_single_sync_commit() const { return single_sync_commit_; }
 
   int permission() const { return permission_; }
   int open_flag() const { return open_flag_; }
   double timeout() const { return timeout_; }
   int mmap_flags() const { return mmapflags_; }
   int initial_mmap_size() const { return initial_mmap_size_; }
+  i64 mmap_reserve_size() const { return mmap_reserve_size_; }
   int max_batch_size() const { return max_batch_size_; }
   int max_batch_delay() const { return max_batch_delay_; }
   int alloc_size() const { return alloc_size_; }
+  int max_readers() const { return max_readers_; }
+  int spill_threads() const { return spill_threads_; }
+  i64 shrink_threshold() const { return shrink_threshold_; }
+  i64 wal_checkpoint_size() const { return wal_checkpoint_size_; }
+  int page_size() const { return page_size_; }
 
   // Modifier
   Options& set_permission(int permission) {
@@ -75,6 +87,11 @@ class Options {
     return *this;
   }
 
+  Options& set_mmap_reserve_size(i64 mmap_reserve_size) {
+    mmap_reserve_size_ = mmap_reserve_size;
+    return *this;
+  }
+
   Options& set_max_batch_size(int max_batch_size) {
     max_batch_size_ = max_batch_size;
     return *this;
@@ -91,6 +108,46 @@ class Options {
     return *this;
   }
 
+  Options& set_max_readers(int max_readers) {
+    max_readers_ = max_readers;
+    return *this;
+  }
+
+  Options& set_spill_threads(int spill_threads) {
+    spill_threads_ = spill_threads;
+    return *this;
+  }
+
+  Options& set_shrink_threshold(i64 shrink_threshold) {
+    shrink_threshold_ = shrink_threshold;
+    return *this;
+  }
+
+  Options& set_track_page_txids(bool track_page_txids) {
+    track_page_txids_ = track_page_txids;
+    return *this;
+  }
+
+  Options& set_wal(bool wal) {
+    wal_ = wal;
+    return *this;
+  }
+
+  Options& set_wal_checkpoint_size(i64 wal_checkpoint_size) {
+    wal_checkpoint_size_ = wal_checkpoint_size;
+    return *this;
+  }
+
+  Options& set_single_sync_commit(bool single_sync_commit) {
+    single_sync_commit_ = single_sync_commit;
+    return *this;
+  }
+
+  Options& set_page_size(int page_size) {
+    page_size_ = page_size;
+    return *this;
+  }
+
  private:
   // The flags specified for this argument must include exactly one of the
   // following file access modes:
@@ -167,6 +224,14 @@ class Options {
   // it takes no effect.
   int initial_mmap_size_{};
 
+  // MmapReserveSize is the amount of virtual address space reserved for the
+  // mmap when the database is opened. The file is mapped into this range and
+  // grows in place, so readers never have to wait for a remap. The range is
+  // reserved with PROT_NONE and doesn't consume any memory.
+  //
+  // If the database outgrows the reservation a new, larger range is reserved.
+  i64 mmap_reserve_size_{kDefaultMmapReserveSize};
+
   // MaxBatchSize is the maximum size of a batch. Default value is
   // copied from DefaultMaxBatchSize in Open.
   //
@@ -187,6 +252,64 @@ class Options {
   // needs to create new pages. This is done to amortize the cost
   // of truncate() and fsync() when growing the data file.
   int alloc_size_{kDefaultAllocSize};
+
+  // MaxReaders is the maximum number of read-only transactions that can be
+  // open at the same time. Each reader holds one slot of a fixed size registry
+  // so that beginning and closing read transactions never takes a lock.
+  int max_readers_{kDefaultMaxReaders};
+
+  // SpillThreads is the number of threads used to encode dirty nodes into
+  // pages at commit. Pages are still allocated from the freelist by the
+  // committing thread, so the file is identical to a sequential spill.
+  //
+  // If <=0, nodes are encoded by the committing thread.
+  int spill_threads_{};
+
+  // ShrinkThreshold enables giving disk space back after large deletes. When
+  // at least this many bytes of free pages sit right below the high water
+  // mark, a commit removes them from the freelist, lowers the high water mark
+  // and truncates the file.
+  //
+  // The file is truncated to half the threshold past the new high water mark,
+  // so that a commit which allocates a few pages right after a shrink doesn't
+  // grow the file again, and the next shrink needs another threshold's worth
+  // of free pages at the end.
+  //
+  // If <=0, the file never shrinks.
+  i64 shrink_threshold_{};
+
+  // TrackPageTxids keeps a sidecar file recording the transaction that last
+  // wrote each page, which is needed to write incremental backups. Each
+  // commit writes and syncs its entries of the sidecar as well.
+  bool track_page_txids_{};
+
+  // WAL makes commits append their pages to a write-ahead log next to the
+  // data file and sync only the log. The data file is written without
+  // syncing and synced by a background checkpoint. The log is replayed when
+  // the database is opened, except in read-only mode.
+  bool wal_{};
+
+  // WalCheckpointSize is the size the write-ahead log grows to before it is
+  // checkpointed into the data file.
+  //
+  // If <=0, the log is only checkpointed when the database is closed.
+  i64 wal_checkpoint_size_{kDefaultWalCheckpointSize};
+
+  // SingleSyncCommit makes a commit write its pages and its meta and sync
+  // them with one fdatasync(), instead of syncing the pages before writing
+  // the meta. The meta page lists the pages and a checksum of their content,
+  // and opening the database falls back to the previous meta if they don't
+  // match. Commits whose pages don't fit in the list use two syncs.
+  //
+  // Ignored with a write-ahead log, which already syncs once per commit.
+  bool single_sync_commit_{};
+
+  // PageSize is the page size of a new database, a power of two between
+  // DB::kMinPageSize and DB::kMaxPageSize. An existing database keeps the page
+  // size it was created with.
+  //
+  // If <=0, the OS page size is used.
+  int page_size_{};
 };
 
 }  // namespace boltdb
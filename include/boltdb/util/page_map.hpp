@@ -0,0 +1,213 @@
+#ifndef BOLTDB_CPP_UTIL_PAGE_MAP_HPP_
+#define BOLTDB_CPP_UTIL_PAGE_MAP_HPP_
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "boltdb/util/types.hpp"
+
+namespace boltdb {
+
+// PageMap is a hash map from page ids to small values, such as the dirty pages
+// of a transaction or the nodes materialized by a bucket. It uses open
+// addressing with linear probing in a flat array, so a lookup is a multiply and
+// a scan of adjacent slots, and inserting doesn't allocate unless the table
+// grows.
+//
+// Iteration order is unspecified: sort the entries if they have to be visited
+// in page order.
+template <typename V>
+class PageMap {
+ public:
+  using value_type = std::pair<PageID, V>;
+
+  template <typename T>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = T&;
+
+    Iterator() = default;
+    Iterator(T* slot, T* last) : slot_(slot), last_(last) { skip_empty(); }
+
+    reference operator*() const { return *slot_; }
+    pointer operator->() const { return slot_; }
+
+    Iterator& operator++() {
+      slot_++;
+      skip_empty();
+
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator tmp = *this;
+      ++*this;
+
+      return tmp;
+    }
+
+    bool operator==(const Iterator& other) const { return slot_ == other.slot_; }
+
+   private:
+    void skip_empty() {
+      while (slot_ != last_ && slot_->first == kEmpty) {
+        slot_++;
+      }
+    }
+
+    T* slot_{};
+    T* last_{};
+  };
+
+  using iterator = Iterator<value_type>;
+  using const_iterator = Iterator<const value_type>;
+
+  iterator begin() { return {slots_.data(), slots_.data() + slots_.size()}; }
+  iterator end() { return {slots_.data() + slots_.size(), slots_.data() + slots_.size()}; }
+  const_iterator begin() const { return {slots_.data(), slots_.data() + slots_.size()}; }
+  const_iterator end() const { return {slots_.data() + slots_.size(), slots_.data() + slots_.size()}; }
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  iterator find(PageID pgid) {
+    std::size_t index = lookup(pgid);
+
+    return index == kNotFound ? end() : iterator(&slots_[index], slots_.data() + slots_.size());
+  }
+
+  const_iterator find(PageID pgid) const {
+    std::size_t index = lookup(pgid);
+
+    return index == kNotFound ? end() : const_iterator(&slots_[index], slots_.data() + slots_.size());
+  }
+
+  // Get the value of `pgid`, inserting a value-initialized one if needed.
+  V& operator[](PageID pgid) {
+    if ((size_ + 1) * 4 > slots_.size() * 3) {
+      rehash(std::max<std::size_t>(kMinCapacity, slots_.size() * 2));
+    }
+
+    for (std::size_t i = slot_of(pgid);; i = (i + 1) & mask_) {
+      if (slots_[i].first == pgid) {
+        return slots_[i].second;
+      }
+
+      if (slots_[i].first == kEmpty) {
+        slots_[i] = {pgid, V{}};
+        size_++;
+
+        return slots_[i].second;
+      }
+    }
+  }
+
+  // Remove the entry of `pgid`. Return the number of entries removed.
+  std::size_t erase(PageID pgid) {
+    std::size_t i = lookup(pgid);
+
+    if (i == kNotFound) {
+      return 0;
+    }
+
+    // Shift back the entries of the probe sequence that can move into the
+    // hole, so that lookups don't stop at it before finding them.
+    for (std::size_t j = (i + 1) & mask_; slots_[j].first != kEmpty; j = (j + 1) & mask_) {
+      std::size_t home = slot_of(slots_[j].first);
+
+      if (((j - home) & mask_) >= ((j - i) & mask_)) {
+        slots_[i] = std::move(slots_[j]);
+        i = j;
+      }
+    }
+
+    slots_[i] = value_type{kEmpty, V{}};
+    size_--;
+
+    return 1;
+  }
+
+  // Make room for `n` entries without growing again.
+  void reserve(std::size_t n) {
+    std::size_t capacity = std::bit_ceil(std::max<std::size_t>(kMinCapacity, (n * 4 + 2) / 3));
+
+    if (capacity > slots_.size()) {
+      rehash(capacity);
+    }
+  }
+
+  // Remove all the entries, keeping the table.
+  void clear() {
+    if (size_ > 0) {
+      for (auto&& slot : slots_) {
+        slot.first = kEmpty;
+      }
+
+      size_ = 0;
+    }
+  }
+
+ private:
+  // No page is ever stored at this id.
+  static constexpr PageID kEmpty = ~PageID{};
+  static constexpr std::size_t kNotFound = ~std::size_t{};
+  static constexpr std::size_t kMinCapacity = 16;
+
+  // Fibonacci hashing: page ids are mostly sequential, the multiplication
+  // spreads them over the high bits.
+  std::size_t slot_of(PageID pgid) const { return (pgid * 0x9E3779B97F4A7C15ULL) >> shift_; }
+
+  std::size_t lookup(PageID pgid) const {
+    if (size_ == 0) {
+      return kNotFound;
+    }
+
+    for (std::size_t i = slot_of(pgid);; i = (i + 1) & mask_) {
+      if (slots_[i].first == pgid) {
+        return i;
+      }
+
+      if (slots_[i].first == kEmpty) {
+        return kNotFound;
+      }
+    }
+  }
+
+  void rehash(std::size_t capacity) {
+    std::vector<value_type> old(capacity, value_type{kEmpty, V{}});
+    old.swap(slots_);
+    mask_ = capacity - 1;
+    shift_ = 64 - std::countr_zero(capacity);
+
+    for (auto&& slot : old) {
+      if (slot.first == kEmpty) {
+        continue;
+      }
+
+      std::size_t i = slot_of(slot.first);
+
+      while (slots_[i].first != kEmpty) {
+        i = (i + 1) & mask_;
+      }
+
+      slots_[i] = std::move(slot);
+    }
+  }
+
+  std::vector<value_type> slots_;
+  std::size_t size_{};
+  std::size_t mask_{};
+  int shift_{64};
+};
+
+}  // namespace boltdb
+
+#endif  // BOLTDB_CPP_UTIL_PAGE_MAP_HPP_
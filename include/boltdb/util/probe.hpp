@@ -0,0 +1,46 @@
+#ifndef BOLTDB_CPP_UTIL_PROBE_HPP_
+#define BOLTDB_CPP_UTIL_PROBE_HPP_
+
+// Static tracepoints (USDT) of the "boltdb" provider. They are compiled in
+// when the library is configured with -DBOLTDB_USDT=ON and <sys/sdt.h> is
+// available (systemtap-sdt-dev). A probe is then a single nop in the code and
+// a note in the ELF file, which tools such as bpftrace or perf attach to at
+// run time, e.g. to find slow commits:
+//
+//   bpftrace -e 'usdt:./db_test:boltdb:txn__commit__done { @ns = hist(arg1); }'
+//
+// Otherwise BOLTDB_PROBE expands to nothing and its arguments are not even
+// evaluated.
+//
+// Probes and their arguments:
+//
+//   txn__begin(txid, writable)          A transaction began, `txid` is the id of
+//                                       the meta it reads, plus one for writers.
+//   txn__commit__start(txid, dirty)     A commit starts with `dirty` pages.
+//   txn__commit__done(txid, nanos)      A commit completed in `nanos` ns.
+//   txn__rollback(txid, writable)       A transaction was rolled back.
+//   freelist__allocate(pgid, count)     A run of `count` free pages starting at
+//                                       `pgid` was allocated, `pgid` is 0 if
+//                                       the freelist had no such run.
+//   freelist__free(txid, pgid, count)   `count` pages starting at `pgid` were
+//                                       freed by transaction `txid`.
+//   node__split(inodes, nodes)          A node of `inodes` inodes was split in
+//                                       `nodes` nodes.
+//   node__spill(pgid, size, count)      A node of `size` bytes was written to
+//                                       `count` pages starting at `pgid`.
+//   mmap__remap(old_size, size, nanos)  The mmap grew from `old_size` to `size`
+//                                       bytes in `nanos` ns.
+//   file__write__start(fd, offset, n)   A write of `n` bytes at `offset`.
+//   file__write__done(fd, written)      The write returned `written`.
+//   file__fdatasync__start(fd)          An fdatasync() of `fd`.
+//   file__fdatasync__done(fd, result)   The fdatasync() returned `result`.
+
+#if defined(BOLTDB_USDT) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+
+#define BOLTDB_PROBE(name, ...) STAP_PROBEV(boltdb, name, __VA_ARGS__)
+#else
+#define BOLTDB_PROBE(name, ...) static_cast<void>(0)
+#endif
+
+#endif  // BOLTDB_CPP_UTIL_PROBE_HPP_
@@ -0,0 +1,74 @@
+#ifndef BOLTDB_CPP_UTIL_SHARDED_COUNTERS_HPP_
+#define BOLTDB_CPP_UTIL_SHARDED_COUNTERS_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+#include "boltdb/util/common.hpp"
+#include "boltdb/util/types.hpp"
+
+namespace boltdb {
+
+// ShardedCounters is a set of `N` counters that any number of threads add to
+// without contending with each other. Each thread adds to one of kShards
+// copies of the counters, each on its own cache lines, and reading sums the
+// copies. Reads never block writers, but a read racing with an add may see
+// some of its counters and not the others.
+template <std::size_t N>
+class ShardedCounters {
+ public:
+  using Values = std::array<i64, N>;
+
+  static constexpr int kShards = 16;
+
+  ShardedCounters() = default;
+
+  DISALLOW_COPY_AND_ASSIGN(ShardedCounters);
+
+  // Add `value` to the `i`-th counter.
+  void add(std::size_t i, i64 value) { shards_[shard_index()].counters[i].fetch_add(value, std::memory_order_relaxed); }
+
+  // Add each of `values` to its counter, skipping the zeros.
+  void add(const Values& values) {
+    Shard& shard = shards_[shard_index()];
+
+    for (std::size_t i = 0; i < N; i++) {
+      if (values[i] != 0) {
+        shard.counters[i].fetch_add(values[i], std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Get the sum of each counter over all the shards.
+  Values sum() const {
+    Values values{};
+
+    for (auto&& shard : shards_) {
+      for (std::size_t i = 0; i < N; i++) {
+        values[i] += shard.counters[i].load(std::memory_order_relaxed);
+      }
+    }
+
+    return values;
+  }
+
+ private:
+  struct alignas(64) Shard {
+    std::array<std::atomic<i64>, N> counters{};
+  };
+
+  // Threads are assigned shards round robin the first time they add.
+  static int shard_index() {
+    static std::atomic<int> next{};
+    thread_local int index = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+
+    return index;
+  }
+
+  std::array<Shard, kShards> shards_{};
+};
+
+}  // namespace boltdb
+
+#endif  // BOLTDB_CPP_UTIL_SHARDED_COUNTERS_HPP_
@@ -74,6 +74,9 @@ class ByteSlice {
   // Append a byte.
   ByteSlice& append(Byte v);
 
+  // Append `n` bytes starting at `data`.
+  ByteSlice& append(const Byte* data, std::size_t n);
+
   // Reserve a specified capacity for this slice.
   // Note that, this operation will not change the #size.
   void reserve(std::size_t sz);
@@ -134,7 +137,7 @@ class ByteSlice {
     int sz1 = lhs.size();
     int sz2 = rhs.size();
 
-    int res = std::memcmp(lhs.head_, lhs.head_, std::min(sz1, sz2));
+    int res = std::memcmp(lhs.head_, rhs.head_, std::min(sz1, sz2));
 
     if (res == 0) {
       return sz1 < sz2;
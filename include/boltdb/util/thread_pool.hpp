@@ -0,0 +1,67 @@
+#ifndef BOLTDB_CPP_UTIL_THREAD_POOL_HPP_
+#define BOLTDB_CPP_UTIL_THREAD_POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "boltdb/util/common.hpp"
+
+namespace boltdb {
+
+// ThreadPool runs tasks on a fixed number of worker threads.
+//
+// Every worker owns a task queue. Tasks are handed out round-robin and a
+// worker takes tasks from the front of its own queue; once that is empty it
+// steals from the back of the other queues before going to sleep, so uneven
+// tasks don't leave workers idle.
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  explicit ThreadPool(int num_threads);
+
+  // Wait for the queued tasks to finish and join the workers.
+  ~ThreadPool();
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+
+  // Get the number of worker threads.
+  int size() const { return static_cast<int>(threads_.size()); }
+
+  // Queue a task to run on one of the workers.
+  void submit(Task task);
+
+  // Run `fn(i)` for every i in [0, n) on the workers and wait for all the
+  // calls to finish. If any call throws, the first exception is rethrown in
+  // the calling thread once all the calls are done.
+  void parallel_for(int n, const std::function<void(int)>& fn);
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void worker(int index);
+
+  // Pop a task from the queue of the given worker, or steal one from another.
+  bool pop(int index, Task& task);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;  // Protects `stop_` and pairs with `cv_`
+  std::condition_variable cv_;
+  std::atomic<int> pending_{};   // Number of queued tasks
+  std::atomic<unsigned> next_{};  // Next queue to push to
+  bool stop_{};
+};
+
+}  // namespace boltdb
+
+#endif  // BOLTDB_CPP_UTIL_THREAD_POOL_HPP_
@@ -1,5 +1,13 @@
 #include "boltdb/db/bucket.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <string_view>
+
+#include "boltdb/db/cursor.hpp"
+#include "boltdb/db/db.hpp"
 #include "boltdb/page/node.hpp"
 #include "boltdb/transaction/txn.hpp"
 #include "boltdb/util/exception.hpp"
@@ -7,13 +15,40 @@
 
 namespace boltdb {
 
-Bucket::Bucket(Txn* txn) : txn_(txn) {
+static std::string_view as_view(std::span<const Byte> bytes) { return {bytes.data(), bytes.size()}; }
+
+Bucket::Bucket(Txn* txn) : txn_(txn), sub_buckets_cache_(txn->arena()) {
   if (txn->is_writable()) {
     // TODO
   }
 }
 
+Bucket::Bucket(Txn* txn, const BucketMeta& bucket_meta) : Bucket(txn) { bucket_meta_ = bucket_meta; }
+
+Bucket::Bucket(Txn* txn, std::span<const Byte> value) : Bucket(txn) {
+  std::memcpy(&bucket_meta_, value.data(), sizeof(bucket_meta_));
+
+  // An inline bucket keeps its only page in the value, right after the meta.
+  if (bucket_meta_.root == 0) {
+    inline_page_ = Page(const_cast<Byte*>(value.data() + sizeof(BucketMeta)),
+                        static_cast<int>(value.size() - sizeof(BucketMeta)));
+    page_ = &inline_page_;
+  }
+}
+
+Bucket::~Bucket() {
+  // Nested buckets live in the transaction arena, which only releases their
+  // memory when the transaction goes away.
+  for (auto&& [_, child] : sub_buckets_cache_) {
+    child->~Bucket();
+  }
+}
+
 bool Bucket::node(PageID pgid, Node* parent, Node*& out_node) {
+  if (!txn_->is_writable()) {
+    throw DBException("node() called on a read-only transaction");
+  }
+
   // Retrieve node if it's already been created.
   if (auto iter = node_cache_.find(pgid); iter != node_cache_.end()) {
     out_node = iter->second;
@@ -22,18 +57,14 @@ bool Bucket::node(PageID pgid, Node* parent, Node*& out_node) {
   }
 
   // Otherwise create a node and cache ite.
-  Node* n = new Node(pgid, this, parent);
+  Node* n = make_node(pgid, parent);
 
   if (parent == nullptr) {
     root_node_ = n;
   }
 
   // Use the inline page if this is an inline bucket.
-  Page* p = page_;
-
-  if (p == nullptr) {
-    p = txn_->page(pgid);
-  }
+  Page p = page_ != nullptr ? *page_ : txn_->page(pgid);
 
   // Read the page into the node and cache it.
   n->read(p);
@@ -47,6 +78,108 @@ bool Bucket::node(PageID pgid, Node* parent, Node*& out_node) {
   return false;
 }
 
+Node* Bucket::make_node(PageID pgid, Node* parent) {
+  nodes_.push_back(std::make_unique<Node>(pgid, this, parent));
+
+  return nodes_.back().get();
+}
+
+void Bucket::rebalance() {
+  auto start = std::chrono::steady_clock::now();
+
+  rebalance_nodes();
+
+  Duration elapsed = std::chrono::steady_clock::now() - start;
+  txn_->stats.rebalance_time += elapsed;
+  txn_->db()->record_latency(Latency::kRebalance, elapsed);
+}
+
+void Bucket::rebalance_nodes() {
+  // Rebalancing can materialize siblings, which are appended to the nodes.
+  for (std::size_t i = 0; i < nodes_.size(); i++) {
+    nodes_[i]->rebalance();
+  }
+
+  for (auto&& [_, child] : sub_buckets_cache_) {
+    child->rebalance_nodes();
+  }
+}
+
+Status Bucket::spill() {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<SpilledNode> spilled;
+
+  if (Status status = spill_nodes(spilled); !status.ok()) {
+    return status;
+  }
+
+  // Write the nodes of all the buckets at once, so a commit that touches many
+  // small buckets still keeps the spill pool busy.
+  Node::write_all(spilled, txn_->db()->spill_pool());
+
+  Duration elapsed = std::chrono::steady_clock::now() - start;
+  txn_->stats.spill_time += elapsed;
+  txn_->db()->record_latency(Latency::kSpill, elapsed);
+
+  return {};
+}
+
+Status Bucket::spill_nodes(std::vector<SpilledNode>& spilled) {
+  // Spill the nested buckets first, their new roots change the values stored
+  // in this bucket.
+  for (auto&& [name, child] : sub_buckets_cache_) {
+    if (Status status = child->spill_nodes(spilled); !status.ok()) {
+      return status;
+    }
+
+    // Ignore the nested buckets that weren't changed.
+    if (child->root_node_ == nullptr) {
+      continue;
+    }
+
+    auto value = reinterpret_cast<const Byte*>(&child->bucket_meta_);
+    ByteSlice key(name.begin(), name.end());
+    leaf_node({name.data(), name.size()})->put(key, key, ByteSlice(value, value + sizeof(BucketMeta)), 0,
+                                               LeafFlag::kBucket);
+  }
+
+  // Ignore if there's no materialized node.
+  if (root_node_ == nullptr) {
+    return {};
+  }
+
+  if (Status status = root_node_->spill_to(spilled); !status.ok()) {
+    return status;
+  }
+
+  // The root node may have split and created a new root.
+  root_node_ = root_node_->root();
+  bucket_meta_.root = root_node_->pgid();
+
+  return {};
+}
+
+Node* Bucket::leaf_node(std::span<const Byte> key) {
+  std::string_view target = as_view(key);
+  Node* n = root_node_;
+
+  if (n == nullptr) {
+    node(root(), nullptr, n);
+  }
+
+  // Descend into the last child whose first key is not after the key.
+  while (!n->is_leaf()) {
+    const std::vector<Inode>& inodes = n->inodes();
+    auto iter = std::upper_bound(inodes.begin(), inodes.end(), target, [](std::string_view k, const Inode& inode) {
+      return k < as_view(inode.key.span());
+    });
+
+    n = n->child_at(iter == inodes.begin() ? 0 : static_cast<int>(std::distance(inodes.begin(), iter)) - 1);
+  }
+
+  return n;
+}
+
 std::unique_ptr<Cursor> Bucket::cursor() {
   // Update transaction statistics.
   txn_->stats.cursor_count++;
@@ -55,30 +188,127 @@ std::unique_ptr<Cursor> Bucket::cursor() {
   return std::make_unique<Cursor>(this);
 }
 
-std::pair<Page*, Node*> Bucket::page_node(PageID pgid) {
+std::pair<Page, Node*> Bucket::page_node(PageID pgid) {
   // Inline buckets have a fake page embedded in their value so treat them
   // differently. We'll return the rootNode (if available) or the fake page.
   if (bucket_meta_.root == 0) {
-    if (id != 0) {
-      std::string error =
-          format("inline bucket non-zero page access(2): %d != 0", id);
+    if (pgid != 0) {
+      std::string error = format("inline bucket non-zero page access(2): %d != 0", pgid);
       throw DBException(error);
     }
 
     if (root_node_ != nullptr) {
-      return {nullptr, root_node_};
+      return {Page{}, root_node_};
     }
 
-    return {page_, nullptr};
+    return {*page_, nullptr};
   }
 
   // Check the node cache for non-inline buckets.
-  if (auto iter = node_cache_.find(id); ite != node_cache_.end()) {
-    return {iter->first, nullptr};
+  if (auto iter = node_cache_.find(pgid); iter != node_cache_.end()) {
+    return {Page{}, iter->second};
   }
 
   // Finally lookup the page from the transaction if no node is materialized.
-  return {txn_->page(id), nullptr};
+  return {txn_->page(pgid), nullptr};
+}
+
+std::span<const Byte> Bucket::get(std::span<const Byte> key) {
+  u32 flags;
+  std::span<const Byte> value;
+
+  if (!lookup(key, flags, value) || (flags & LeafFlag::kBucket) != 0) {
+    return {};
+  }
+
+  return value;
+}
+
+Bucket* Bucket::bucket(std::span<const Byte> name) {
+  if (auto iter = sub_buckets_cache_.find(as_view(name)); iter != sub_buckets_cache_.end()) {
+    return iter->second;
+  }
+
+  u32 flags;
+  std::span<const Byte> value;
+
+  if (!lookup(name, flags, value) || (flags & LeafFlag::kBucket) == 0 || value.size() < sizeof(BucketMeta)) {
+    return nullptr;
+  }
+
+  void* memory = txn_->arena()->allocate(sizeof(Bucket), alignof(Bucket));
+  auto* child = new (memory) Bucket(txn_, value);
+  sub_buckets_cache_.emplace(std::pmr::string(as_view(name), txn_->arena()), child);
+
+  return child;
+}
+
+bool Bucket::lookup(std::span<const Byte> key, u32& out_flags, std::span<const Byte>& out_value) {
+  std::string_view target = as_view(key);
+  PageID pgid = root();
+
+  while (true) {
+    auto [p, n] = page_node(pgid);
+
+    if (n != nullptr && n->is_leaf()) {
+      const std::vector<Inode>& inodes = n->inodes();
+      auto iter = std::lower_bound(inodes.begin(), inodes.end(), target, [](const Inode& inode, std::string_view k) {
+        return as_view(inode.key.span()) < k;
+      });
+
+      if (iter == inodes.end() || as_view(iter->key.span()) != target) {
+        return false;
+      }
+
+      out_flags = iter->flags;
+      out_value = iter->value.span();
+
+      return true;
+    }
+
+    // Descend into the last child whose first key is not after the key, or
+    // into the first child if the key comes before all of them, like
+    // leaf_node() does when the key is put.
+    if (n != nullptr) {
+      const std::vector<Inode>& inodes = n->inodes();
+
+      if (inodes.empty()) {
+        return false;
+      }
+
+      auto iter = std::upper_bound(inodes.begin(), inodes.end(), target, [](std::string_view k, const Inode& inode) {
+        return k < as_view(inode.key.span());
+      });
+
+      pgid = iter == inodes.begin() ? iter->pgid : std::prev(iter)->pgid;
+      continue;
+    }
+
+    if ((p.flag() & PageFlag::kLeaf) != 0) {
+      auto elements = p.leaf_page_elements();
+      auto iter = std::lower_bound(elements.begin(), elements.end(), target,
+                                   [](const LeafPageElement& e, std::string_view k) { return as_view(e.key_view()) < k; });
+
+      if (iter == elements.end() || as_view(iter->key_view()) != target) {
+        return false;
+      }
+
+      out_flags = iter->flags;
+      out_value = iter->value_view();
+
+      return true;
+    }
+
+    auto elements = p.branch_page_elements();
+    auto iter = std::upper_bound(elements.begin(), elements.end(), target,
+                                 [](std::string_view k, const BranchPageElement& e) { return k < as_view(e.key_view()); });
+
+    if (elements.empty()) {
+      return false;
+    }
+
+    pgid = iter == elements.begin() ? iter->pgid : std::prev(iter)->pgid;
+  }
 }
 
 }  // namespace boltdb
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include "boltdb/db/bulk_loader.hpp"
+
+#include <algorithm>
+#include <new>
+
+#include "boltdb/db/bucket.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/transaction/txn.hpp"
+
+namespace boltdb {
+
+static int fill_threshold(int page_size, f64 fill_percent) {
+  fill_percent = std::max(fill_percent, Bucket::kMinFillPercent);
+  fill_percent = std::min(fill_percent, Bucket::kMaxFillPercent);
+
+  return static_cast<int>(page_size * fill_percent);
+}
+
+BulkLoader::BulkLoader(Txn* txn, f64 fill_percent) : txn_(txn), writer_(nullptr), threshold_(0) {
+  DB* db = txn->db();
+
+  // The tree can only be appended to a writable transaction that is open.
+  if (db == nullptr || !txn->is_writable()) {
+    return;
+  }
+
+  run_pgid_ = txn->meta_.pgid;
+  owned_writer_ = std::make_unique<PageWriter>(db->file_handle_.get(), db->page_size(), run_pgid_);
+  writer_ = owned_writer_.get();
+  threshold_ = fill_threshold(db->page_size(), fill_percent);
+}
+
+BulkLoader::BulkLoader(PageWriter* writer, f64 fill_percent)
+    : writer_(writer), threshold_(fill_threshold(writer->page_size(), fill_percent)) {}
+
+Status BulkLoader::add(std::span<const Byte> key, std::span<const Byte> value, u32 flags) {
+  if (writer_ == nullptr) {
+    return {kStatusErr, "tx not writable"};
+  }
+
+  if (finished_) {
+    return {kStatusErr, "bulk load: already finished"};
+  }
+
+  if (key.empty()) {
+    return {kStatusErr, "bulk load: zero-length key"};
+  }
+
+  if (key.size() > Bucket::kMaxKeySize) {
+    return {kStatusErr, "bulk load: key too large"};
+  }
+
+  if (value.size() > Bucket::kMaxValueSize) {
+    return {kStatusErr, "bulk load: value too large"};
+  }
+
+  if (count_ > 0 && !std::lexicographical_compare(last_key_.begin(), last_key_.end(), key.begin(), key.end())) {
+    return {kStatusErr, "bulk load: keys must be added in strictly increasing order"};
+  }
+
+  last_key_.assign(key.begin(), key.end());
+
+  if (Status status = add_element(0, key, value, flags, 0); !status.ok()) {
+    return status;
+  }
+
+  count_++;
+
+  return {};
+}
+
+Status BulkLoader::finish(BucketMeta& out_bucket) {
+  if (writer_ == nullptr) {
+    return {kStatusErr, "tx not writable"};
+  }
+
+  if (finished_) {
+    return {kStatusErr, "bulk load: already finished"};
+  }
+
+  finished_ = true;
+
+  // Write out the partially filled page of every level from the bottom up.
+  // The page of the top level is the root: all the levels below it have
+  // written at least one page, so it holds at least two elements unless the
+  // whole tree fits in a single leaf.
+  if (levels_.empty()) {
+    levels_.emplace_back();
+  }
+
+  PageID root;
+
+  for (std::size_t depth = 0;; depth++) {
+    std::vector<Byte> first_key;
+
+    if (Status status = write_level(depth, root, first_key); !status.ok()) {
+      return status;
+    }
+
+    if (depth + 1 == levels_.size()) {
+      break;
+    }
+
+    if (Status status = add_element(depth + 1, first_key, {}, 0, root); !status.ok()) {
+      return status;
+    }
+  }
+
+  if (owned_writer_ != nullptr) {
+    if (Status status = close_run(); !status.ok()) {
+      return status;
+    }
+
+    // Map the new pages so they can be read once the transaction commits.
+    std::size_t size = txn_->meta_.pgid * writer_->page_size();
+
+    if (Status status = txn_->db_->mmap(size); !status.ok()) {
+      return status;
+    }
+  }
+
+  out_bucket = {.root = root, .sequence = 0};
+
+  return {};
+}
+
+Status BulkLoader::add_element(std::size_t depth, std::span<const Byte> key, std::span<const Byte> value, u32 flags,
+                               PageID pgid) {
+  if (levels_.size() == depth) {
+    levels_.emplace_back();
+  }
+
+  int element_size = depth == 0 ? kLeafPageElementSize : kBranchPageElementSize;
+  int size = element_size + static_cast<int>(key.size() + value.size());
+
+  // Keep at least the minimum number of keys on every page, so that each
+  // level has fewer pages than the one below it.
+  auto& elements = levels_[depth].elements;
+  bool full = elements.size() >= kMinKeysPerPage && levels_[depth].byte_size + size > threshold_;
+
+  if (full || elements.size() + 1 >= DB::kSpecialCount) {
+    PageID page_id;
+    std::vector<Byte> first_key;
+
+    if (Status status = write_level(depth, page_id, first_key); !status.ok()) {
+      return status;
+    }
+
+    if (Status status = add_element(depth + 1, first_key, {}, 0, page_id); !status.ok()) {
+      return status;
+    }
+  }
+
+  // The levels may have been reallocated by the recursive call.
+  Level& level = levels_[depth];
+  level.elements.push_back({flags, static_cast<u32>(key.size()), static_cast<u32>(value.size()), pgid});
+  level.data.insert(level.data.end(), key.begin(), key.end());
+  level.data.insert(level.data.end(), value.begin(), value.end());
+  level.byte_size += size;
+
+  return {};
+}
+
+Status BulkLoader::write_level(std::size_t depth, PageID& out_pgid, std::vector<Byte>& out_first_key) {
+  Level& level = levels_[depth];
+  bool is_leaf = depth == 0;
+  int page_size = writer_->page_size();
+  int count = (level.byte_size + page_size - 1) / page_size;
+
+  PageID pgid;
+  Byte* data;
+
+  // The transaction, or another loader in it, allocated pages past ours since
+  // the last page was appended. Continue the tree after them.
+  if (txn_ != nullptr && txn_->meta_.pgid != writer_->next_pgid()) {
+    if (Status status = close_run(); !status.ok()) {
+      return status;
+    }
+
+    if (Status status = writer_->seek(txn_->meta_.pgid); !status.ok()) {
+      return status;
+    }
+
+    run_pgid_ = txn_->meta_.pgid;
+  }
+
+  if (Status status = writer_->append(count, pgid, data); !status.ok()) {
+    return status;
+  }
+
+  // Keep the transaction's high water mark above the tree so that pages
+  // allocated by the transaction don't overlap with it.
+  if (txn_ != nullptr) {
+    txn_->meta_.pgid = writer_->next_pgid();
+  }
+
+  auto header = new (data) PageHeader(pgid, is_leaf ? PageFlag::kLeaf : PageFlag::kBranch);
+  header->count = static_cast<u16>(level.elements.size());
+  header->overflow = count - 1;
+
+  Page page(data, count * page_size);
+  int element_size = is_leaf ? kLeafPageElementSize : kBranchPageElementSize;
+  Byte* base = std::next(page.skip_page_header(), level.elements.size() * element_size);
+  const Byte* src = level.data.data();
+
+  for (u16 i = 0; i < level.elements.size(); i++) {
+    const Element& element = level.elements[i];
+    u32 size = element.key_size + element.value_size;
+
+    if (is_leaf) {
+      auto leaf = page.leaf_page_element(i);
+      leaf->flags = element.flags;
+      leaf->pos = std::distance(reinterpret_cast<Byte*>(leaf), base);
+      leaf->key_size = element.key_size;
+      leaf->value_size = element.value_size;
+    } else {
+      auto branch = page.branch_page_element(i);
+      branch->pos = std::distance(reinterpret_cast<Byte*>(branch), base);
+      branch->key_size = element.key_size;
+      branch->pgid = element.pgid;
+    }
+
+    base = std::copy(src, std::next(src, size), base);
+    src = std::next(src, size);
+  }
+
+  if (!level.elements.empty()) {
+    out_first_key.assign(level.data.begin(), std::next(level.data.begin(), level.elements[0].key_size));
+  }
+
+  level.elements.clear();
+  level.data.clear();
+  level.byte_size = kPageHeaderSize;
+
+  out_pgid = pgid;
+  page_count_ += count;
+
+  return {};
+}
+
+Status BulkLoader::close_run() {
+  if (Status status = owned_writer_->flush(); !status.ok()) {
+    return status;
+  }
+
+  // The pages bypass the dirty pages of the transaction, let it know about
+  // them for the page txid map and the write-ahead log.
+  if (writer_->next_pgid() > run_pgid_) {
+    txn_->appended_.emplace_back(run_pgid_, writer_->next_pgid());
+  }
+
+  run_pgid_ = writer_->next_pgid();
+
+  return {};
+}
+
+}  // namespace boltdb
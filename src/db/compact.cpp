@@ -0,0 +1,217 @@
+#include "boltdb/db/compact.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+
+#include "boltdb/db/db.hpp"
+#include "boltdb/db/page_writer.hpp"
+#include "boltdb/fs/file_system.hpp"
+#include "boltdb/page/page.hpp"
+#include "boltdb/transaction/txn.hpp"
+#include "boltdb/util/exception.hpp"
+#include "boltdb/util/util.hpp"
+
+namespace boltdb {
+
+// Page ids of the compacted file: two meta pages, an empty freelist, and the
+// trees right after them.
+static constexpr const PageID kFreeListPageID = 2;
+static constexpr const PageID kFirstTreePageID = 3;
+
+namespace {
+
+class Compactor {
+ public:
+  Compactor(Txn* txn, PageWriter* writer, f64 fill_percent)
+      : txn_(txn), writer_(writer), fill_percent_(fill_percent) {}
+
+  // Rebuild the bucket rooted at the given page and return the new bucket.
+  Status copy_bucket(PageID pgid, BucketMeta& out_bucket) {
+    BulkLoader loader(writer_, fill_percent_);
+
+    if (Status status = copy_tree(pgid, loader); !status.ok()) {
+      return status;
+    }
+
+    return loader.finish(out_bucket);
+  }
+
+  i64 key_count() const { return key_count_; }
+
+ private:
+  // Add the elements of the tree rooted at the given page to the loader, in
+  // key order.
+  Status copy_tree(PageID pgid, BulkLoader& loader) {
+    Page page = txn_->page(pgid);
+
+    if ((page.flag() & PageFlag::kBranch) != 0) {
+      for (auto&& element : page.branch_page_elements()) {
+        if (Status status = copy_tree(element.pgid, loader); !status.ok()) {
+          return status;
+        }
+      }
+
+      return {};
+    }
+
+    if ((page.flag() & PageFlag::kLeaf) == 0) {
+      return {kStatusCorrupt, format("compact: unexpected %s page %llu", page.type().c_str(), pgid)};
+    }
+
+    for (auto&& element : page.leaf_page_elements()) {
+      std::span<const Byte> value = element.value_view();
+      BucketMeta bucket;
+
+      key_count_++;
+
+      // Keep values and inline buckets as they are, they don't reference any
+      // page.
+      if ((element.flags & LeafFlag::kBucket) == 0 || value.size() < sizeof(bucket)) {
+        if (Status status = loader.add(element.key_view(), value, element.flags); !status.ok()) {
+          return status;
+        }
+
+        continue;
+      }
+
+      std::memcpy(&bucket, value.data(), sizeof(bucket));
+
+      if (bucket.root == 0) {
+        if (Status status = loader.add(element.key_view(), value, element.flags); !status.ok()) {
+          return status;
+        }
+
+        continue;
+      }
+
+      // Rebuild the nested bucket first, its pages are written ahead of the
+      // page of the parent that references it.
+      BucketMeta copy;
+
+      if (Status status = copy_bucket(bucket.root, copy); !status.ok()) {
+        return status;
+      }
+
+      copy.sequence = bucket.sequence;
+
+      std::span<const Byte> header(reinterpret_cast<const Byte*>(&copy), sizeof(copy));
+
+      if (Status status = loader.add(element.key_view(), header, element.flags); !status.ok()) {
+        return status;
+      }
+    }
+
+    return {};
+  }
+
+  Txn* txn_;
+  PageWriter* writer_;
+  f64 fill_percent_;
+  i64 key_count_{};
+};
+
+}  // namespace
+
+// Write the empty freelist and both meta pages of the compacted file, meta 1
+// with a lower transaction id so that meta 0 is the one picked on open.
+static Status write_meta(FileHandle* file_handle, const Meta& meta, int page_size) {
+  try {
+    Page freelist(kFreeListPageID, PageFlag::kFreeList, page_size);
+
+    if (file_handle->write(freelist.data(), page_size, kFreeListPageID * page_size) != page_size) {
+      return {kStatusErr, "compact: short write of the freelist"};
+    }
+
+    for (PageID pgid = 0; pgid < 2; pgid++) {
+      Page page(pgid, PageFlag::kMeta, page_size);
+      *page.meta() = meta;
+      page.meta()->txid -= pgid;
+      page.meta()->checksum = page.meta()->sum64();
+
+      if (file_handle->write(page.data(), page_size, pgid * page_size) != page_size) {
+        return {kStatusErr, "compact: short write of the meta"};
+      }
+    }
+  } catch (const IOException& e) {
+    return {kStatusErr, e.what()};
+  }
+
+  return {};
+}
+
+Status compact(DB* db, const std::string& path, CompactStats& out_stats, f64 fill_percent) {
+  auto start = std::chrono::steady_clock::now();
+
+  if (path == db->path()) {
+    return {kStatusErr, "compact: destination is the source database"};
+  }
+
+  // Work on a consistent snapshot. Pages seen by the transaction can't be
+  // reused by writers until it's closed.
+  Txn* txn;
+
+  if (Status status = db->begin(false, txn); !status.ok()) {
+    return status;
+  }
+
+  std::unique_ptr<Txn> guard(txn);
+  BucketMeta src_root = txn->root();
+  std::unique_ptr<FileHandle> file_handle = FileSystem::create(path.c_str());
+
+  if (file_handle == nullptr) {
+    txn->rollback();
+    return {kStatusErr, format("compact: could not create \"%s\"", path.c_str())};
+  }
+
+  int page_size = db->page_size();
+  PageWriter writer(file_handle.get(), page_size, kFirstTreePageID);
+  Compactor compactor(txn, &writer, fill_percent);
+  BucketMeta root{};
+
+  Status status = compactor.copy_bucket(src_root.root, root);
+
+  // Make the trees durable before the meta pages that point to them, so that
+  // an interrupted compaction never leaves a file that looks valid.
+  if (status.ok()) {
+    status = writer.flush();
+  }
+
+  if (status.ok()) {
+    status = file_handle->fsync();
+  }
+
+  // The meta of the snapshot the trees were copied from.
+  Meta meta = txn->meta();
+  txn->rollback();
+
+  meta.root = {.root = root.root, .sequence = src_root.sequence};
+  meta.freelist = kFreeListPageID;
+  meta.pgid = writer.next_pgid();
+  meta.flags &= ~Meta::kFlagCommitRecord;  // The record describes the source file
+
+  if (status.ok()) {
+    status = write_meta(file_handle.get(), meta, page_size);
+  }
+
+  if (status.ok()) {
+    status = file_handle->fsync();
+  }
+
+  // Don't leave a partial copy behind.
+  if (!status.ok()) {
+    FileSystem::remove(*file_handle);
+
+    return status;
+  }
+
+  out_stats.src_size = static_cast<i64>(std::filesystem::file_size(db->path()));
+  out_stats.dst_size = static_cast<i64>(FileSystem::file_size(*file_handle));
+  out_stats.page_count = static_cast<i64>(meta.pgid);
+  out_stats.key_count = compactor.key_count();
+  out_stats.elapsed = std::chrono::steady_clock::now() - start;
+
+  return {};
+}
+
+}  // namespace boltdb
@@ -1,49 +1,210 @@
 #include "boltdb/db/cursor.hpp"
 
+#include <algorithm>
+
 #include "boltdb/db/bucket.hpp"
 #include "boltdb/page/node.hpp"
 #include "boltdb/page/page.hpp"
 
 namespace boltdb {
 
-std::pair<ByteSlice, ByteSlice> Cursor::first() {
+static std::string_view as_view(std::span<const Byte> bytes) { return {bytes.data(), bytes.size()}; }
+
+Cursor::KeyValue Cursor::first() {
   stack_.clear();
 
   auto [p, n] = bucket_->page_node(bucket_->root());
   stack_.emplace_back(p, n, 0);
+  move_to_leaf();
+
+  // If we land on an empty page then move to the next value.
+  if (stack_.back().count() == 0) {
+    return next();
+  }
+
+  return key_value();
+}
+
+Cursor::KeyValue Cursor::last() {
+  stack_.clear();
+
+  auto [p, n] = bucket_->page_node(bucket_->root());
+  ElemRef ref(p, n);
+  ref.index = ref.count() - 1;
+  stack_.push_back(ref);
+  move_to_last_leaf();
+
+  return key_value();
+}
+
+Cursor::KeyValue Cursor::next() {
+  while (true) {
+    // Attempt to move over one element until we're successful. Move up the
+    // stack as we hit the end of each page in our stack.
+    int i = static_cast<int>(stack_.size()) - 1;
+
+    for (; i >= 0; i--) {
+      ElemRef& ref = stack_[i];
+
+      if (ref.index < ref.count() - 1) {
+        ref.index++;
+        break;
+      }
+    }
+
+    // If we've hit the root page then stop and return. This will leave the
+    // cursor on the last element of the last page.
+    if (i == -1) {
+      return {};
+    }
+
+    // Otherwise start from where we left off in the stack and find the first
+    // element of the first leaf page.
+    stack_.resize(i + 1);
+    move_to_leaf();
+
+    // If this is an empty page then restart and move back up the stack.
+    if (stack_.back().count() == 0) {
+      continue;
+    }
+
+    return key_value();
+  }
+}
+
+Cursor::KeyValue Cursor::seek(std::span<const Byte> key) {
+  stack_.clear();
+  search(as_view(key), bucket_->root());
+
+  // If we ended up after the last element of a page then move to the next
+  // one.
+  if (stack_.back().index >= stack_.back().count()) {
+    return next();
+  }
+
+  return key_value();
 }
 
 void Cursor::move_to_leaf() {
+  while (!stack_.back().is_leaf()) {
+    // Keep adding pages pointing to the first element to the stack.
+    PageID pgid = stack_.back().child(stack_.back().index);
+    auto [p, n] = bucket_->page_node(pgid);
+    stack_.emplace_back(p, n, 0);
+  }
+}
+
+void Cursor::move_to_last_leaf() {
+  while (!stack_.back().is_leaf()) {
+    // Keep adding pages pointing to the last element to the stack.
+    PageID pgid = stack_.back().child(stack_.back().index);
+    auto [p, n] = bucket_->page_node(pgid);
+    ElemRef ref(p, n);
+    ref.index = ref.count() - 1;
+    stack_.push_back(ref);
+  }
+}
+
+void Cursor::search(std::string_view key, PageID pgid) {
   while (true) {
-    auto& ref = stack_.back();
+    auto [p, n] = bucket_->page_node(pgid);
+    ElemRef ref(p, n);
+    int count = ref.count();
+
+    // Find the first element whose key is not before the key.
+    int first = 0;
+    int last = count;
+
+    while (first < last) {
+      int mid = first + (last - first) / 2;
+
+      if (as_view(ref.key(mid)) < key) {
+        first = mid + 1;
+      } else {
+        last = mid;
+      }
+    }
 
     if (ref.is_leaf()) {
-      break;
+      ref.index = first;
+      stack_.push_back(ref);
+
+      return;
     }
 
-    // Keep adding pages pointing to the first element to the stack.
-    PageID pgid;
+    // In a branch, the key belongs to the last child starting at or before
+    // it.
+    if (first == count || as_view(ref.key(first)) != key) {
+      first = std::max(first - 1, 0);
+    }
+
+    ref.index = first;
+    stack_.push_back(ref);
+    pgid = ref.child(first);
+  }
+}
+
+Cursor::KeyValue Cursor::key_value() const {
+  const ElemRef& ref = stack_.back();
+
+  // If the cursor is pointing to the end of page/node then return nil.
+  if (ref.count() == 0 || ref.index >= ref.count()) {
+    return {};
+  }
+
+  if (ref.node != nullptr) {
+    const Inode& inode = ref.node->inodes()[ref.index];
 
-    if (ref.node != nullptr) {
-      pgid = ref.
+    if ((inode.flags & LeafFlag::kBucket) != 0) {
+      return {inode.key.span(), {}};
     }
+
+    return {inode.key.span(), inode.value.span()};
   }
+
+  const LeafPageElement* element = ref.page.leaf_page_element(static_cast<u16>(ref.index));
+
+  if ((element->flags & LeafFlag::kBucket) != 0) {
+    return {element->key_view(), {}};
+  }
+
+  return {element->key_view(), element->value_view()};
 }
 
-inline bool ElemRef::is_leaf() const {
+bool ElemRef::is_leaf() const {
   if (node != nullptr) {
     return node->is_leaf();
   }
 
-  return page->flag() == PageFlag::kLeaf;
+  return (page.flag() & PageFlag::kLeaf) != 0;
+}
+
+int ElemRef::count() const {
+  if (node != nullptr) {
+    return static_cast<int>(node->inodes().size());
+  }
+
+  return page.count();
+}
+
+std::span<const Byte> ElemRef::key(int i) const {
+  if (node != nullptr) {
+    return node->inodes()[i].key.span();
+  }
+
+  if (is_leaf()) {
+    return page.leaf_page_element(static_cast<u16>(i))->key_view();
+  }
+
+  return page.branch_page_element(static_cast<u16>(i))->key_view();
 }
 
-inline int ElemRef::count() const {
+PageID ElemRef::child(int i) const {
   if (node != nullptr) {
-    return node->inode_count();
+    return node->inodes()[i].pgid;
   }
 
-  return page->count();
+  return page.branch_page_element(static_cast<u16>(i))->pgid;
 }
 
-}  // namespace boltdb
\ No newline at end of file
+}  // namespace boltdb
@@ -1,5 +1,7 @@
 #include "boltdb/db/db.hpp"
 
+#include <cstring>
+#include <optional>
 #include <vector>
 
 #include "boltdb/fs/file_system.hpp"
@@ -7,10 +9,19 @@
 #include "boltdb/util/binary.hpp"
 #include "boltdb/util/crc64.hpp"
 #include "boltdb/util/exception.hpp"
+#include "boltdb/util/probe.hpp"
 #include "boltdb/util/util.hpp"
 
 namespace boltdb {
 
+// Every open allocates a DB, scratch databases in memory included, so large
+// members such as the latency histograms are allocated on first use.
+static_assert(sizeof(DB) <= 8 * 1024, "DB is too large");
+
+static bool is_valid_page_size(i64 page_size) {
+  return page_size >= DB::kMinPageSize && page_size <= DB::kMaxPageSize && (page_size & (page_size - 1)) == 0;
+}
+
 Status DB::init() const {
   std::vector<Page> pages;
 
@@ -26,7 +37,7 @@ Status DB::init() const {
     meta->freelist = 2;
     meta->flags = 0;
     meta->root = {.root = 3, .sequence = 0};
-    meta->pgid = i;
+    meta->pgid = 4;
     meta->txid = i;
     meta->checksum = meta->sum64();
 
@@ -65,12 +76,490 @@ Status DB::init() const {
   return {};
 }
 
-Page* DB::page(PageID pgid) const {
+Page DB::page(PageID pgid) const {
   auto offset = pgid * page_size_;
 
-  (void)offset;
+  return {std::next(mmap_.data(), offset), page_size_};
+}
+
+Status DB::allocate(int count, Page*& out_page) {
+  // Allocate a temporary buffer for the page.
+  auto page = std::make_unique<Page>(PageID{}, PageFlag::kInvalid, count * page_size_);
+  page->set_overflow(count - 1);
+
+  // Use pages from the freelist if they are available.
+  PageID pgid = freelist.allocate_contiguous(count);
+
+  if (pgid == 0) {
+    // Resize mmap() if we're at the end.
+    pgid = rwtx_->meta_.pgid;
+    std::size_t min_size = (pgid + count + 1) * page_size_;
+
+    if (min_size >= mmap_.size()) {
+      if (Status status = mmap(min_size); !status.ok()) {
+        return status;
+      }
+    }
+
+    // Move the page id high water mark.
+    rwtx_->meta_.pgid += count;
+  }
+
+  page->pheader_->pgid = pgid;
+  out_page = page.release();
+
+  return {};
+}
+
+Histogram* DB::make_histogram(Latency latency) {
+  auto histogram = std::make_unique<Histogram>();
+  Histogram* expected = nullptr;
+
+  if (latencies_[static_cast<int>(latency)].compare_exchange_strong(expected, histogram.get(),
+                                                                      std::memory_order_acq_rel)) {
+    return histogram.release();
+  }
+
+  return expected;
+}
+
+Status DB::read_page_size() {
+  Meta meta;
+
+  if (Status status = read_newest_meta(*file_handle_, meta); !status.ok()) {
+    return status;
+  }
+
+  page_size_ = static_cast<int>(meta.page_size);
+
+  return {};
+}
+
+Status DB::read_newest_meta(FileHandle& file, Meta& out_meta) {
+  // Read both meta pages with a single read. The page size isn't known yet,
+  // so read far enough to cover the second meta page at the largest one.
+  constexpr std::size_t kBufferSize = 2 * kMaxPageSize;
+  auto buffer = std::make_unique_for_overwrite<Byte[]>(kBufferSize);
+  std::size_t size;
+
+  try {
+    ssize_t bytes_read = file.read(buffer.get(), kBufferSize, 0);
+    size = bytes_read > 0 ? bytes_read : 0;
+  } catch (const IOException& e) {
+    return {kStatusErr, e.what()};
+  }
+
+  // The first meta page is always at offset 0, but it may be torn. The second
+  // one is at offset page_size, so try every supported page size and only
+  // trust a meta found there if it agrees on its own offset. Use the valid
+  // meta with the highest txid.
+  std::optional<Meta> newest;
+
+  auto consider = [&](std::size_t offset) {
+    if (offset + kPageHeaderSize + sizeof(Meta) > size) {
+      return;
+    }
+
+    Meta meta;
+    std::memcpy(&meta, buffer.get() + offset + kPageHeaderSize, sizeof(Meta));
+
+    if (!meta.validate().ok() || !is_valid_page_size(meta.page_size)) {
+      return;
+    }
+
+    if (offset != 0 && offset != meta.page_size) {
+      return;
+    }
+
+    if (!newest || meta.txid > newest->txid) {
+      newest = meta;
+    }
+  };
+
+  consider(0);
+
+  for (std::size_t page_size = kMinPageSize; page_size <= kMaxPageSize; page_size *= 2) {
+    consider(page_size);
+  }
+
+  if (!newest) {
+    return {kStatusCorrupt, "invalid database: no valid meta page"};
+  }
+
+  out_meta = *newest;
+
+  return {};
+}
+
+Status DB::mmap(std::size_t min_size) {
+  std::size_t size = std::max<std::size_t>(FileSystem::file_size(*file_handle_), min_size);
+
+  // Ensure the size is at least the minimum size.
+  if (Status status = mmap_size(size, size); !status.ok()) {
+    return status;
+  }
+
+  // Extending the mapping doesn't move it, so there's no need to dereference
+  // the nodes of the writer or to wait for the readers.
+  Status status;
+  [[maybe_unused]] std::size_t old_size = mmap_.size();
+  auto start = std::chrono::steady_clock::now();
+
+  if (mmap_.data() == nullptr) {
+    std::size_t reserve_size = std::max<std::size_t>(options_.mmap_reserve_size(), size);
+    status = mmap_.map(file_handle_->fd(), size, reserve_size, options_.mmap_flags());
+  } else {
+    status = mmap_.grow(size);
+  }
+
+  if (!status.ok()) {
+    return status;
+  }
+
+  auto remap_time = std::chrono::steady_clock::now() - start;
+  record_latency(Latency::kRemap, remap_time);
+  BOLTDB_PROBE(mmap__remap, old_size, mmap_.size(), std::chrono::nanoseconds(remap_time).count());
+
+  // Validate the meta pages. We only return an error if both meta pages fail
+  // validation, since meta0 failing validation means that it wasn't saved
+  // properly -- but we can recover using meta1. And vice-versa.
+  Status status0 = meta_page(0)->validate();
+  Status status1 = meta_page(1)->validate();
+
+  if (!status0.ok() && !status1.ok()) {
+    return status0;
+  }
+
+  return {};
+}
+
+Status DB::grow(std::size_t size) {
+  // Ignore if the new size is less than available file size.
+  if (size <= file_size_) {
+    return {};
+  }
+
+  // Double the file while it's small, then grow by alloc_size() at a time so
+  // that insert-heavy workloads don't preallocate and sync on every commit.
+  std::size_t step = std::max<std::size_t>(file_size_, page_size_);
+  step = std::min<std::size_t>(step, options_.alloc_size());
+  size = std::max(size, file_size_ + step);
+
+  // Keep the file size a multiple of the page size.
+  if (std::size_t remainder = size % page_size_; remainder != 0) {
+    size += page_size_ - remainder;
+  }
+
+  if (Status status = file_handle_->allocate(file_size_, size - file_size_); !status.ok()) {
+    return status;
+  }
+
+  // Sync to ensure the file size metadata is flushed.
+  if (!options_.is_no_grow_sync()) {
+    if (Status status = sync(true); !status.ok()) {
+      return status;
+    }
+  }
+
+  grow_count_.fetch_add(1, std::memory_order_relaxed);
+  grow_bytes_.fetch_add(size - file_size_, std::memory_order_relaxed);
+  file_size_ = size;
+
+  return {};
+}
+
+Status DB::sync(bool metadata) {
+  auto start = std::chrono::steady_clock::now();
+  Status status = metadata ? file_handle_->fsync() : file_handle_->fdatasync();
+
+  if (status.ok()) {
+    record_latency(Latency::kSync, std::chrono::steady_clock::now() - start);
+  }
+
+  return status;
+}
+
+Status DB::shrink(std::size_t size) {
+  if (std::size_t remainder = size % page_size_; remainder != 0) {
+    size += page_size_ - remainder;
+  }
+
+  // Readers that began before the high water mark was lowered may still read
+  // up to theirs, e.g. to back up the file. Keep their pages and try again on
+  // a later commit.
+  PageID reader_pgid = readers_.highest_pgid(0);
+  std::size_t reader_size = reader_pgid > file_size_ / page_size_ ? file_size_ : reader_pgid * page_size_;
+
+  shrink_pending_ = size < file_size_ && reader_size > size;
+  size = std::max(size, reader_size);
+
+  if (size >= file_size_) {
+    return {};
+  }
+
+  // The mapping is left as it is. Nothing reads the pages past the end of the
+  // file, and the mapping sees the file again once it grows back.
+  if (Status status = file_handle_->truncate(size); !status.ok()) {
+    return status;
+  }
+
+  if (!options_.is_no_grow_sync()) {
+    if (Status status = sync(true); !status.ok()) {
+      return status;
+    }
+  }
+
+  shrink_count_.fetch_add(1, std::memory_order_relaxed);
+  shrink_bytes_.fetch_add(file_size_ - size, std::memory_order_relaxed);
+  file_size_ = size;
+
+  return {};
+}
+
+bool DB::commit_complete(const Meta& meta) const {
+  if ((meta.flags & Meta::kFlagCommitRecord) == 0) {
+    return true;
+  }
+
+  const CommitRecord* record = meta.commit_record();
+
+  if (record->count > CommitRecord::capacity(page_size_)) {
+    return false;
+  }
+
+  u64 crc = crc64_be(0, reinterpret_cast<const Byte*>(record->runs()), record->count * sizeof(PageRun));
+
+  for (u32 i = 0; i < record->count; i++) {
+    const PageRun& run = record->runs()[i];
+
+    if ((run.pgid + run.count) * page_size_ > file_size_) {
+      return false;
+    }
+
+    crc = crc64_be(crc, page(run.pgid).data(), run.count * page_size_);
+  }
+
+  return crc == record->checksum;
+}
+
+Status DB::mmap_size(std::size_t size, std::size_t& out_size) const {
+  // Double the size from 32KB until 1GB.
+  for (int i = 15; i <= 30; i++) {
+    if (size <= (1UL << i)) {
+      out_size = 1UL << i;
+      return {};
+    }
+  }
+
+  // Verify the requested size is not above the maximum allowed.
+  if (size > kMaxMapSize) {
+    return {kStatusErr, "mmap too large"};
+  }
+
+  // If larger than 1GB then grow by 1GB at a time.
+  std::size_t remainder = size % kMaxMmapStep;
+
+  if (remainder > 0) {
+    size += kMaxMmapStep - remainder;
+  }
+
+  // Ensure that the mmap size is a multiple of the page size.
+  // This should always be true since we're incrementing in MBs.
+  if ((size % page_size_) != 0) {
+    size = ((size / page_size_) + 1) * page_size_;
+  }
+
+  // If we've exceeded the max size then only grow up to the max size.
+  out_size = std::min<std::size_t>(size, kMaxMapSize);
+
+  return {};
+}
+
+Status DB::begin(bool writable, Txn*& out_txn) {
+  if (writable) {
+    return begin_rwtxn(out_txn);
+  }
+
+  return begin_txn(out_txn);
+}
+
+Meta DB::meta() const {
+  // We have to return the meta with the highest txid which doesn't fail
+  // validation. Otherwise, we can cause errors when in fact the database is
+  // in a consistent state. metaA is the one with the higher txid.
+  int slot_a = 0;
+  int slot_b = 1;
+  const Meta* meta_a = meta_page(slot_a);
+  const Meta* meta_b = meta_page(slot_b);
+
+  if (meta_b->txid > meta_a->txid) {
+    std::swap(slot_a, slot_b);
+    std::swap(meta_a, meta_b);
+  }
+
+  // Use higher meta page if valid. Otherwise fallback to previous, if valid.
+  if (slot_a != torn_meta_.load(std::memory_order_acquire) && meta_a->validate().ok()) {
+    return *meta_a;
+  }
+
+  if (meta_b->validate().ok()) {
+    return *meta_b;
+  }
+
+  // This should never be reached, because both meta1 and meta0 were validated
+  // on open and meta pages are only written by the single writer.
+  throw DBException("meta(): invalid meta pages");
+}
+
+Status DB::begin_txn(Txn*& out_txn) {
+  if (!opened_) {
+    return {kStatusErr, "database not open"};
+  }
+
+  // Claim a reader slot before looking at the meta. A claimed slot holds the
+  // smallest possible id, so a writer scanning the registry in the meantime
+  // keeps every pending page around until we publish the real id.
+  int slot = readers_.acquire();
+
+  if (slot < 0) {
+    return {kStatusErr, format("too many open read transactions (max %d)", readers_.capacity())};
+  }
+
+  auto txn = std::make_unique<Txn>(this, false);
+
+  try {
+    txn->meta_ = meta();
+  } catch (const DBException& e) {
+    readers_.release(slot);
+    return {kStatusCorrupt, e.what()};
+  }
+
+  txn->reader_slot_ = slot;
+  txn->start_ = std::chrono::steady_clock::now();
+  readers_.publish(slot, txn->meta_.txid, txn->meta_.pgid);
+  txn_counters_.add(kTxnN, 1);
+  BOLTDB_PROBE(txn__begin, txn->meta_.txid, false);
+
+  out_txn = txn.release();
+
+  return {};
+}
+
+Status DB::begin_rwtxn(Txn*& out_txn) {
+  // If the database was opened with Options.ReadOnly, return an error.
+  if (options_.is_read_only()) {
+    return {kStatusErr, "database is in read-only mode"};
+  }
+
+  // Obtain writer lock. This is released by the transaction when it closes.
+  // This enforces only one writer transaction at a time.
+  rwlock_.lock();
+
+  if (!opened_) {
+    rwlock_.unlock();
+    return {kStatusErr, "database not open"};
+  }
+
+  auto txn = std::make_unique<Txn>(this, true);
+
+  // Writers tend to dirty about as many pages as the previous one did.
+  txn->pages_.reserve(dirty_pages_hint_);
+
+  try {
+    txn->meta_ = meta();
+  } catch (const DBException& e) {
+    rwlock_.unlock();
+    return {kStatusCorrupt, e.what()};
+  }
+
+  // Increment the transaction id.
+  txn->meta_.txid += 1;
+  rwtx_ = txn.get();
+
+  release_pending_pages(txn->meta_.txid);
+  BOLTDB_PROBE(txn__begin, txn->meta_.txid, true);
+
+  out_txn = txn.release();
+
+  return {};
+}
+
+void DB::release_pending_pages(TxnID txn_id) {
+  // Free any pages associated with closed read-only transactions. Readers
+  // never block on this scan: they publish their ids with atomic stores and
+  // the writer only needs a lower bound.
+  TxnID min_id = readers_.oldest(txn_id);
+
+  if (min_id > 0) {
+    freelist.release(min_id - 1);
+  }
+}
+
+void DB::remove_txn(Txn* txn) {
+  if (txn->reader_slot_ >= 0) {
+    readers_.release(txn->reader_slot_);
+    txn->reader_slot_ = -1;
+  }
+}
+
+// The duration stats are counted in nanoseconds.
+static i64 to_nanos(Duration d) { return static_cast<i64>(d.count() * 1e9); }
+
+static Duration from_nanos(i64 nanos) { return Duration(static_cast<f64>(nanos) / 1e9); }
+
+void DB::record_stats(const Txn& txn) {
+  const TxnStats& stats = txn.stats;
+
+  // Same order as in stats().
+  txn_counters_.add({stats.page_count, stats.page_alloc, stats.cursor_count, stats.node_count, stats.node_deref,
+                     stats.rebalance, to_nanos(stats.rebalance_time), stats.split, stats.append_split, stats.spill,
+                     stats.spill_bytes, stats.spill_alloc, to_nanos(stats.spill_time), stats.write,
+                     stats.write_bytes, to_nanos(stats.write_time), 0});
+
+  if (!txn.writable_) {
+    record_latency(Latency::kReadTxn, std::chrono::steady_clock::now() - txn.start_);
+  }
+
+  if (txn.writable_) {
+    free_page_n_.store(freelist.free_count(), std::memory_order_relaxed);
+    pending_page_n_.store(freelist.pending_count(), std::memory_order_relaxed);
+    freelist_inuse_.store(freelist.byte_size(), std::memory_order_relaxed);
+  }
+}
 
-  return nullptr;
+DBStats DB::stats() const {
+  auto values = txn_counters_.sum();
+  DBStats stats;
+
+  stats.free_page_n = free_page_n_.load(std::memory_order_relaxed);
+  stats.pending_page_n = pending_page_n_.load(std::memory_order_relaxed);
+  stats.free_alloc = static_cast<i64>(stats.free_page_n + stats.pending_page_n) * page_size_;
+  stats.freelist_inuse = freelist_inuse_.load(std::memory_order_relaxed);
+  stats.txn_n = values[kTxnN];
+  stats.open_txn_n = readers_.count();
+  stats.mmap_size = static_cast<i64>(mmap_.size());
+  stats.grow = grow_stats();
+
+  TxnStats& txn_stats = stats.txn_stats;
+  int i = 0;
+  txn_stats.page_count = values[i++];
+  txn_stats.page_alloc = values[i++];
+  txn_stats.cursor_count = values[i++];
+  txn_stats.node_count = values[i++];
+  txn_stats.node_deref = values[i++];
+  txn_stats.rebalance = values[i++];
+  txn_stats.rebalance_time = from_nanos(values[i++]);
+  txn_stats.split = values[i++];
+  txn_stats.append_split = values[i++];
+  txn_stats.spill = values[i++];
+  txn_stats.spill_bytes = values[i++];
+  txn_stats.spill_alloc = values[i++];
+  txn_stats.spill_time = from_nanos(values[i++]);
+  txn_stats.write = values[i++];
+  txn_stats.write_bytes = values[i++];
+  txn_stats.write_time = from_nanos(values[i++]);
+
+  return stats;
 }
 
 Status open_db(std::string path, Options options, DB** out_db) {
@@ -81,6 +570,21 @@ Status open_db(std::string path, Options options, DB** out_db) {
     return {StatusType::kStatusErr, "error: fail to open " + path};
   }
 
+  return open_db(std::move(handle), options, out_db);
+}
+
+Status open_db(std::unique_ptr<FileHandle> handle, Options options, DB** out_db) {
+  return open_db(std::move(handle), nullptr, options, out_db);
+}
+
+Status open_db(std::unique_ptr<FileHandle> handle, std::unique_ptr<FileHandle> wal_handle, Options options,
+               DB** out_db) {
+  std::string path = handle->path;
+
+  // A database in memory is gone once closed, there's nothing to recover or
+  // back up incrementally, so it never gets a log or a page-txid map.
+  bool in_memory = handle->in_memory();
+
   // Lock file so that other processes using Bolt in read-write mode cannot use
   // the database at the same time. This would cause corruption since the two
   // processes would write meta pages and free pages separately.
@@ -102,44 +606,91 @@ Status open_db(std::string path, Options options, DB** out_db) {
 
   std::unique_ptr<DB> db(new DB(std::move(handle), options));
 
-  if (FileSystem::file_size(*db->file_handle_) == 0) {
-    db->page_size_ = OS::getpagesize();
-    Status status = db->init();
+  // Bring the data file up to date with the write-ahead log before anything
+  // reads the meta pages. The log only holds what the data file may lack,
+  // opening without it would lose those commits.
+  if (options.is_wal() && !options.is_read_only() && !in_memory) {
+    Meta meta;
+    bool has_meta = FileSystem::file_size(*db->file_handle_) > 0 && DB::read_newest_meta(*db->file_handle_, meta).ok();
+
+    const Meta* data_meta = has_meta ? &meta : nullptr;
+    Status status = wal_handle != nullptr
+                        ? Wal::open(std::move(wal_handle), db->file_handle_.get(), data_meta,
+                                    options.wal_checkpoint_size(), options.is_no_sync(), db->wal_)
+                        : Wal::open(db->file_handle_.get(), data_meta, options.wal_checkpoint_size(),
+                                    options.is_no_sync(), db->wal_);
 
     if (!status.ok()) {
       return status;
     }
-  } else {
-    Status status;
-    // Read the first meta page to determine the page size.
-    ByteSlice buffer(0x1000);
-
-    // TODO(gc): what happens if the page size is 512, 1024, 2048, 4096, 8192.
-    ssize_t bytes_read = db->file_handle_->read(
-        const_cast<Byte*>(buffer.data()), buffer.size(), 0);
-    Meta meta = Meta::deserialize(buffer);
-
-    (void)bytes_read;
-
-    if (status = meta.validate(); !status.ok()) {
-      // If we can't read the page size, we can assume it's the same
-      // as the OS -- since that's how the page size was chosen in the
-      // first place.
-      //
-      // If the first page is invalid and this OS uses a different
-      // page size than what the database was created with then we
-      // are out of luck and cannot access the database.
-      db->page_size_ = OS::getpagesize();
-    } else {
-      db->page_size_ = meta.page_size;
+  } else if (!in_memory && Wal::has_records(path)) {
+    return {kStatusErr, format("%s has a write-ahead log to replay, open it read-write with Options::wal()",
+                               path.c_str())};
+  }
+
+  if (FileSystem::file_size(*db->file_handle_) == 0) {
+    db->page_size_ = options.page_size() > 0 ? options.page_size() : OS::getpagesize();
+
+    if (!is_valid_page_size(db->page_size_)) {
+      return {kStatusErr, format("invalid page size %d", db->page_size_)};
+    }
+
+    if (Status status = db->init(); !status.ok()) {
+      return status;
+    }
+  } else if (Status status = db->read_page_size(); !status.ok()) {
+    return status;
+  }
+
+  db->file_size_ = FileSystem::file_size(*db->file_handle_);
+
+  // Memory map the data file.
+  if (Status status = db->mmap(options.initial_mmap_size()); !status.ok()) {
+    return status;
+  }
+
+  // If the last commit synced its pages and meta together and didn't make it
+  // to disk, fall back to the previous meta. Only the latest commit can be
+  // incomplete, it started after the previous one was synced.
+  int latest_slot = db->meta_page(1)->txid > db->meta_page(0)->txid ? 1 : 0;
+  const Meta* latest = db->meta_page(latest_slot);
+
+  if (latest->validate().ok() && !db->commit_complete(*latest)) {
+    db->torn_meta_ = latest_slot;
+  }
+
+  // Read in the freelist.
+  db->freelist.read_from(db->page(db->meta().freelist));
+
+  if (options.is_track_page_txids() && !in_memory) {
+    Meta meta = db->meta();
+
+    if (Status status = PageTxids::open(path, meta.txid, meta.pgid, options.is_read_only(), db->page_txids_);
+        !status.ok()) {
+      return status;
     }
   }
 
+  if (options.spill_threads() > 0) {
+    db->spill_pool_ = std::make_unique<ThreadPool>(options.spill_threads());
+  }
+
+  db->opened_ = true;
   *out_db = db.release();
 
   return {};
 }
 
+Status open_memory_db(const std::string& name, Options options, DB** out_db) {
+  auto handle = FileSystem::create_memory(name.c_str());
+
+  if (handle == nullptr) {
+    return {StatusType::kStatusErr, "error: fail to create memory file " + name};
+  }
+
+  return open_db(std::move(handle), options, out_db);
+}
+
 // Serialize the given meta object.
 ByteSlice Meta::serialize(const Meta& meta) {
   ByteSlice slice;
@@ -149,35 +700,39 @@ ByteSlice Meta::serialize(const Meta& meta) {
   return slice;
 }
 
-template <typename T>
-void deserialize_aux(ByteSlice& slice, T& out_data) {
-  out_data = binary::BigEndian::uint<T>(slice);
-  slice.remove_prefix(sizeof(T));
+// Deserialize meta from the given slice.
+Meta Meta::deserialize(ByteSlice slice) { return decode(slice.data()); }
+
+Byte* Meta::encode(Byte* out) const {
+  return binary::BigEndian::store_uint(encode_aux(out), checksum);
 }
 
-// Deserialize meta from the given slice.
-Meta Meta::deserialize(ByteSlice slice) {
+Meta Meta::decode(const Byte* in) {
+  using binary::BigEndian;
+
   Meta meta;
 
-  deserialize_aux(slice, meta.magic);
-  deserialize_aux(slice, meta.version);
-  deserialize_aux(slice, meta.page_size);
-  deserialize_aux(slice, meta.flags);
-  deserialize_aux(slice, meta.root.root);
-  deserialize_aux(slice, meta.root.sequence);
-  deserialize_aux(slice, meta.freelist);
-  deserialize_aux(slice, meta.pgid);
-  deserialize_aux(slice, meta.txid);
-  deserialize_aux(slice, meta.checksum);
+  meta.magic = BigEndian::load_uint<u32>(in);
+  meta.version = BigEndian::load_uint<u32>(in + 4);
+  meta.page_size = BigEndian::load_uint<u32>(in + 8);
+  meta.flags = BigEndian::load_uint<u32>(in + 12);
+  meta.root.root = BigEndian::load_uint<u64>(in + 16);
+  meta.root.sequence = BigEndian::load_uint<u64>(in + 24);
+  meta.freelist = BigEndian::load_uint<u64>(in + 32);
+  meta.pgid = BigEndian::load_uint<u64>(in + 40);
+  meta.txid = BigEndian::load_uint<u64>(in + 48);
+  meta.checksum = BigEndian::load_uint<u64>(in + 56);
 
   return meta;
 }
 
 u64 Meta::sum64() const {
-  ByteSlice slice;
-  write_aux(slice);
+  // Called on every validate(), so on every transaction: keep it on the
+  // stack.
+  Byte buffer[kEncodedSize];
+  Byte* end = encode_aux(buffer);
 
-  return crc64_be(0, slice.data(), slice.size());
+  return crc64_be(0, buffer, end - buffer);
 }
 
 Status Meta::validate() const {
@@ -206,14 +761,15 @@ bool Meta::equals(const Meta& other) const {
 }
 
 void Meta::write(ByteSlice& slice) const {
-  write_aux(slice);
-  slice = binary::BigEndian::append_uint(slice, checksum);
+  Byte buffer[kEncodedSize];
+  Byte* end = encode(buffer);
+
+  slice.append(buffer, end - buffer);
 }
 
-void Meta::write_aux(ByteSlice& slice) const {
-  slice = binary::BigEndian::append_variadic_uint(
-      slice, magic, version, page_size, flags, root.root, root.sequence,
-      freelist, pgid, txid);
+Byte* Meta::encode_aux(Byte* out) const {
+  return binary::BigEndian::store_variadic_uint(out, magic, version, page_size, flags, root.root, root.sequence,
+                                                freelist, pgid, txid);
 }
 
-}  // namespace boltdb
\ No newline at end of file
+}  // namespace boltdb
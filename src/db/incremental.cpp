@@ -0,0 +1,370 @@
+#include "boltdb/db/incremental.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "boltdb/db/db.hpp"
+#include "boltdb/db/page_txids.hpp"
+#include "boltdb/fs/file_system.hpp"
+#include "boltdb/page/page.hpp"
+#include "boltdb/transaction/txn.hpp"
+#include "boltdb/util/crc64.hpp"
+#include "boltdb/util/exception.hpp"
+#include "boltdb/util/util.hpp"
+
+namespace boltdb {
+
+namespace {
+
+constexpr const u32 kIncrementalMagic = 0xB017DE17;
+constexpr const u32 kIncrementalVersion = 1;
+
+// Number of bytes applied to the database copy at a time.
+constexpr const std::size_t kApplyChunkSize = 1 << 20;
+
+struct IncrementalHeader {
+  u32 magic;
+  u32 version;
+  u32 page_size;
+  u32 flags;
+  TxnID base_txid;
+  TxnID txid;
+  PageID pgid;  // High water mark
+};
+
+// A run of `count` pages starting at `pgid` follows its header. A run of zero
+// pages ends the backup.
+struct RunHeader {
+  PageID pgid;
+  u64 count;
+};
+
+// Wraps a stream and keeps a crc64 of everything written to it.
+class ChecksumWriter {
+ public:
+  explicit ChecksumWriter(std::ostream& out) : out_(out) {}
+
+  Status write(const void* data, std::size_t size) {
+    crc_ = crc64_be(crc_, static_cast<const Byte*>(data), size);
+    bytes_ += static_cast<i64>(size);
+
+    if (!out_.write(static_cast<const Byte*>(data), static_cast<std::streamsize>(size))) {
+      return {kStatusErr, "incremental: stream write failed"};
+    }
+
+    return {};
+  }
+
+  u64 crc() const { return crc_; }
+  i64 bytes() const { return bytes_; }
+
+ private:
+  std::ostream& out_;
+  u64 crc_{};
+  i64 bytes_{};
+};
+
+// Wraps a stream and keeps a crc64 of everything read from it.
+class ChecksumReader {
+ public:
+  explicit ChecksumReader(std::istream& in) : in_(in) {}
+
+  Status read(void* data, std::size_t size) {
+    if (!in_.read(static_cast<Byte*>(data), static_cast<std::streamsize>(size))) {
+      return {kStatusCorrupt, "incremental: unexpected end of backup"};
+    }
+
+    crc_ = crc64_be(crc_, static_cast<const Byte*>(data), size);
+    bytes_ += static_cast<i64>(size);
+
+    return {};
+  }
+
+  u64 crc() const { return crc_; }
+  i64 bytes() const { return bytes_; }
+
+ private:
+  std::istream& in_;
+  u64 crc_{};
+  i64 bytes_{};
+};
+
+// Write both meta pages of `meta` to the file, meta 1 with a lower
+// transaction id so that meta 0 is the one picked on open. The pages carry no
+// commit record.
+Status write_meta_pages(FileHandle* file_handle, const Meta& meta) {
+  int page_size = static_cast<int>(meta.page_size);
+
+  for (PageID pgid = 0; pgid < 2; pgid++) {
+    Page page(pgid, PageFlag::kMeta, page_size);
+    *page.meta() = meta;
+    page.meta()->txid -= pgid;
+    page.meta()->flags &= ~Meta::kFlagCommitRecord;
+    page.meta()->checksum = page.meta()->sum64();
+
+    if (file_handle->write(page.data(), page_size, pgid * page_size) != page_size) {
+      return {kStatusErr, "incremental: short write of the meta"};
+    }
+  }
+
+  return {};
+}
+
+// Apply the runs of pages that follow the header of the backup, and then its
+// meta, to the copy in `file_handle`.
+Status apply_runs(FileHandle* file_handle, ChecksumReader& reader, const IncrementalHeader& header,
+                  i64& out_page_count) {
+  // Find the current meta of the copy.
+  int page_size = static_cast<int>(header.page_size);
+  std::vector<Byte> buffer(std::max<std::size_t>(2 * page_size, kApplyChunkSize));
+  Meta base{};
+
+  try {
+    if (file_handle->read(buffer.data(), 2 * page_size, 0) != 2 * page_size) {
+      return {kStatusCorrupt, "incremental: could not read the meta pages of the copy"};
+    }
+  } catch (const IOException& e) {
+    return {kStatusErr, e.what()};
+  }
+
+  for (int i = 0; i < 2; i++) {
+    const Meta* meta = Page(buffer.data() + i * page_size, page_size).meta();
+
+    if (meta->validate().ok() && meta->page_size == header.page_size && meta->txid >= base.txid) {
+      base = *meta;
+    }
+  }
+
+  if (base.magic == 0) {
+    return {kStatusCorrupt, "incremental: the copy has no valid meta page of the same page size"};
+  }
+
+  if (base.txid < header.base_txid || base.txid > header.txid) {
+    return {kStatusErr, format("incremental: the copy is at txid %llu, the backup applies to %llu..%llu", base.txid,
+                               header.base_txid, header.txid)};
+  }
+
+  Page meta_page(0, PageFlag::kMeta, page_size);
+
+  if (Status status = reader.read(meta_page.data(), page_size); !status.ok()) {
+    return status;
+  }
+
+  Meta meta = *meta_page.meta();
+
+  if (!meta.validate().ok() || meta.txid != header.txid || meta.pgid != header.pgid) {
+    return {kStatusCorrupt, "incremental: invalid meta"};
+  }
+
+  out_page_count = 0;
+
+  try {
+    while (true) {
+      RunHeader run;
+
+      if (Status status = reader.read(&run, sizeof(run)); !status.ok()) {
+        return status;
+      }
+
+      if (run.count == 0) {
+        break;
+      }
+
+      if (run.pgid < 2 || run.pgid + run.count > header.pgid) {
+        return {kStatusCorrupt, format("incremental: run of pages %llu..%llu out of range", run.pgid,
+                                       run.pgid + run.count)};
+      }
+
+      std::size_t offset = run.pgid * page_size;
+      std::size_t end = offset + run.count * page_size;
+
+      while (offset < end) {
+        std::size_t size = std::min(buffer.size(), end - offset);
+
+        if (Status status = reader.read(buffer.data(), size); !status.ok()) {
+          return status;
+        }
+
+        if (file_handle->write(buffer.data(), size, offset) != static_cast<ssize_t>(size)) {
+          return {kStatusErr, "incremental: short write"};
+        }
+
+        offset += size;
+      }
+
+      out_page_count += static_cast<i64>(run.count);
+    }
+  } catch (const IOException& e) {
+    return {kStatusErr, e.what()};
+  }
+
+  u64 expected_crc = reader.crc();
+  u64 crc;
+
+  if (Status status = reader.read(&crc, sizeof(crc)); !status.ok()) {
+    return status;
+  }
+
+  if (crc != expected_crc) {
+    return {kStatusCorrupt, "incremental: checksum mismatch"};
+  }
+
+  // Everything past the high water mark is unused.
+  if (Status status = file_handle->truncate(header.pgid * page_size); !status.ok()) {
+    return status;
+  }
+
+  try {
+    if (Status status = write_meta_pages(file_handle, meta); !status.ok()) {
+      return status;
+    }
+  } catch (const IOException& e) {
+    return {kStatusErr, e.what()};
+  }
+
+  if (Status status = file_handle->fsync(); !status.ok()) {
+    return status;
+  }
+
+  return {};
+}
+
+}  // namespace
+
+Status write_incremental(Txn* txn, TxnID base_txid, std::ostream& out, IncrementalStats& out_stats) {
+  DB* db = txn->db();
+
+  if (db == nullptr) {
+    return {kStatusErr, "tx closed"};
+  }
+
+  // The dirty pages of a writer are not in the page txid map yet.
+  if (txn->is_writable()) {
+    return {kStatusErr, "incremental: needs a read-only transaction"};
+  }
+
+  const PageTxids* txids = db->page_txids();
+
+  if (txids == nullptr) {
+    return {kStatusErr, "incremental: page txids are not tracked, see Options::track_page_txids()"};
+  }
+
+  const Meta& meta = txn->meta();
+
+  if (base_txid > meta.txid) {
+    return {kStatusErr, format("incremental: base txid %llu is ahead of txid %llu", base_txid, meta.txid)};
+  }
+
+  int page_size = db->page_size();
+  ChecksumWriter writer(out);
+  IncrementalHeader header{.magic = kIncrementalMagic,
+                           .version = kIncrementalVersion,
+                           .page_size = static_cast<u32>(page_size),
+                           .flags = 0,
+                           .base_txid = base_txid,
+                           .txid = meta.txid,
+                           .pgid = meta.pgid};
+
+  if (Status status = writer.write(&header, sizeof(header)); !status.ok()) {
+    return status;
+  }
+
+  Page meta_page(0, PageFlag::kMeta, page_size);
+  *meta_page.meta() = meta;
+
+  if (Status status = writer.write(meta_page.data(), page_size); !status.ok()) {
+    return status;
+  }
+
+  // Pages of the snapshot can't be rewritten while the transaction is open,
+  // so they are read straight from the mmap.
+  i64 page_count = 0;
+
+  for (auto&& [first, last] : txids->changed_since(base_txid, meta.pgid)) {
+    RunHeader run{.pgid = first, .count = last - first};
+    Page page = txn->page(first);
+
+    if (Status status = writer.write(&run, sizeof(run)); !status.ok()) {
+      return status;
+    }
+
+    if (Status status = writer.write(page.data(), run.count * page_size); !status.ok()) {
+      return status;
+    }
+
+    page_count += static_cast<i64>(run.count);
+  }
+
+  RunHeader end{};
+
+  if (Status status = writer.write(&end, sizeof(end)); !status.ok()) {
+    return status;
+  }
+
+  u64 crc = writer.crc();
+
+  if (Status status = writer.write(&crc, sizeof(crc)); !status.ok()) {
+    return status;
+  }
+
+  out_stats = {.base_txid = base_txid, .txid = meta.txid, .page_count = page_count, .bytes = writer.bytes()};
+
+  return {};
+}
+
+Status apply_incremental(const std::string& path, std::istream& in, IncrementalStats& out_stats) {
+  ChecksumReader reader(in);
+  IncrementalHeader header;
+
+  if (Status status = reader.read(&header, sizeof(header)); !status.ok()) {
+    return status;
+  }
+
+  if (header.magic != kIncrementalMagic || header.version != kIncrementalVersion) {
+    return {kStatusErr, "incremental: not an incremental backup"};
+  }
+
+  // Apply the backup to a scratch copy of the copy, which replaces it only once
+  // the whole backup has been applied and its checksum verified. A truncated
+  // or damaged backup leaves the copy as it was.
+  std::string scratch_path = path + ".incremental";
+  std::error_code ec;
+
+  if (!std::filesystem::copy_file(path, scratch_path, std::filesystem::copy_options::overwrite_existing, ec)) {
+    return {kStatusErr, format("incremental: could not copy \"%s\": %s", path.c_str(), ec.message().c_str())};
+  }
+
+  auto file_handle = FileSystem::open(scratch_path.c_str(), O_RDWR, 0);
+  i64 page_count = 0;
+  Status status;
+
+  if (file_handle == nullptr) {
+    status = {kStatusErr, format("incremental: could not open \"%s\"", scratch_path.c_str())};
+  } else {
+    status = apply_runs(file_handle.get(), reader, header, page_count);
+  }
+
+  if (status.ok() && std::rename(scratch_path.c_str(), path.c_str()) != 0) {
+    status = {kStatusErr, format("incremental: rename \"%s\": %s", scratch_path.c_str(), strerror(errno))};
+  }
+
+  if (!status.ok()) {
+    std::remove(scratch_path.c_str());
+
+    return status;
+  }
+
+  // A page txid map left next to the copy describes another file.
+  std::remove(PageTxids::path_of(path).c_str());
+
+  out_stats = {.base_txid = header.base_txid, .txid = header.txid, .page_count = page_count, .bytes = reader.bytes()};
+
+  return {};
+}
+
+}  // namespace boltdb
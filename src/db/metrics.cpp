@@ -0,0 +1,328 @@
+#include "boltdb/db/metrics.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+#include "boltdb/alloc/memory_pool.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/util/histogram.hpp"
+#include "boltdb/util/util.hpp"
+
+namespace boltdb {
+
+namespace {
+
+// MetricsWriter appends text to a fixed buffer, and keeps counting the size
+// of the text past the end of the buffer.
+class MetricsWriter {
+ public:
+  explicit MetricsWriter(std::span<char> out) : out_(out) {}
+
+  std::size_t size() const { return size_; }
+
+  void append(std::string_view text) {
+    if (size_ < out_.size()) {
+      std::memcpy(out_.data() + size_, text.data(), std::min(text.size(), out_.size() - size_));
+    }
+
+    size_ += text.size();
+  }
+
+  void append(i64 value) {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    append(std::string_view(buffer, result.ptr - buffer));
+  }
+
+  void append(f64 value) {
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    append(std::string_view(buffer, result.ptr - buffer));
+  }
+
+  // Write the HELP and TYPE lines of a metric family.
+  void family(std::string_view name, std::string_view type, std::string_view help) {
+    append("# HELP ");
+    append(name);
+    append(" ");
+    append(help);
+    append("\n# TYPE ");
+    append(name);
+    append(" ");
+    append(type);
+    append("\n");
+  }
+
+  template <typename T>
+  void sample(std::string_view name, std::string_view labels, T value) {
+    append(name);
+    append(labels);
+    append(" ");
+    append(value);
+    append("\n");
+  }
+
+  void counter(std::string_view name, std::string_view help, i64 value) {
+    family(name, "counter", help);
+    sample(name, "", value);
+  }
+
+  void counter(std::string_view name, std::string_view help, Duration value) {
+    family(name, "counter", help);
+    sample(name, "", value.count());
+  }
+
+  void gauge(std::string_view name, std::string_view help, i64 value) {
+    family(name, "gauge", help);
+    sample(name, "", value);
+  }
+
+  // Write a histogram with a bucket per power of two nanoseconds from 1us to
+  // 32s, which are bucket boundaries of HistogramSnapshot, so the counts are
+  // exact. The tail percentiles, which these buckets are too coarse for, go
+  // to a separate gauge family.
+  void histogram(std::string_view name, std::string_view help, const HistogramSnapshot& snapshot) {
+    static constexpr int kFirstBit = 10;
+    static constexpr int kLastBit = 35;
+
+    family(name, "histogram", help);
+
+    i64 seen = 0;
+    int bucket = 0;
+
+    for (int bit = kFirstBit; bit <= kLastBit; bit++) {
+      i64 bound = i64{1} << bit;
+
+      for (; bucket < HistogramSnapshot::kBuckets && HistogramSnapshot::bucket_upper_bound(bucket) < bound; bucket++) {
+        seen += snapshot.counts()[bucket];
+      }
+
+      append(name);
+      append("_bucket{le=\"");
+      append(static_cast<f64>(bound) / 1e9);
+      append("\"} ");
+      append(seen);
+      append("\n");
+    }
+
+    sample_suffix(name, "_bucket{le=\"+Inf\"}", snapshot.count());
+    sample_suffix(name, "_sum", snapshot.sum().count());
+    sample_suffix(name, "_count", snapshot.count());
+
+    append("# HELP ");
+    append(name);
+    append("_quantile ");
+    append(help);
+    append(", at the given quantile\n# TYPE ");
+    append(name);
+    append("_quantile gauge\n");
+
+    for (auto [label, percentile] : {std::pair<std::string_view, f64>{"0.5", 50}, {"0.99", 99}, {"0.999", 99.9}}) {
+      append(name);
+      append("_quantile{quantile=\"");
+      append(label);
+      append("\"} ");
+      append(snapshot.percentile(percentile).count());
+      append("\n");
+    }
+  }
+
+ private:
+  template <typename T>
+  void sample_suffix(std::string_view name, std::string_view suffix, T value) {
+    append(name);
+    sample(suffix, "", value);
+  }
+
+  std::span<char> out_;
+  std::size_t size_{};
+};
+
+}  // namespace
+
+std::size_t render_metrics(const DB& db, std::span<char> out) {
+  MetricsWriter w(out);
+  DBStats stats = db.stats();
+  const TxnStats& txn = stats.txn_stats;
+
+  w.counter("boltdb_read_txns_total", "Read-only transactions started.", stats.txn_n);
+  w.gauge("boltdb_open_read_txns", "Read-only transactions currently open.", stats.open_txn_n);
+
+  w.counter("boltdb_page_allocations_total", "Pages allocated by transactions.", txn.page_count);
+  w.counter("boltdb_page_alloc_bytes_total", "Bytes of the pages allocated by transactions.", txn.page_alloc);
+  w.counter("boltdb_cursors_total", "Cursors created.", txn.cursor_count);
+  w.counter("boltdb_nodes_total", "Nodes materialized.", txn.node_count);
+  w.counter("boltdb_node_derefs_total", "Node dereferences.", txn.node_deref);
+  w.counter("boltdb_rebalances_total", "Node rebalances.", txn.rebalance);
+  w.counter("boltdb_rebalance_seconds_total", "Time spent rebalancing nodes.", txn.rebalance_time);
+  w.counter("boltdb_splits_total", "Nodes split.", txn.split);
+  w.counter("boltdb_append_splits_total", "Nodes split full in append mode.", txn.append_split);
+  w.counter("boltdb_spills_total", "Nodes spilled.", txn.spill);
+  w.counter("boltdb_spill_bytes_total", "Serialized bytes of the spilled nodes.", txn.spill_bytes);
+  w.counter("boltdb_spill_alloc_bytes_total", "Bytes of the pages nodes were spilled to.", txn.spill_alloc);
+  w.counter("boltdb_spill_seconds_total", "Time spent spilling nodes.", txn.spill_time);
+  w.counter("boltdb_writes_total", "Writes to the data file.", txn.write);
+  w.counter("boltdb_write_bytes_total", "Bytes written to the data file.", txn.write_bytes);
+  w.counter("boltdb_write_seconds_total", "Time spent writing commits to disk.", txn.write_time);
+
+  w.gauge("boltdb_free_pages", "Free pages on the freelist.", stats.free_page_n);
+  w.gauge("boltdb_pending_pages", "Freed pages still visible to readers.", stats.pending_page_n);
+  w.gauge("boltdb_free_alloc_bytes", "Bytes of the free and pending pages.", stats.free_alloc);
+  w.gauge("boltdb_freelist_inuse_bytes", "Bytes used by the freelist page.", stats.freelist_inuse);
+
+  w.gauge("boltdb_mmap_bytes", "Size of the mmap.", stats.mmap_size);
+  w.counter("boltdb_file_grows_total", "Times the data file was grown.", stats.grow.grow_count);
+  w.counter("boltdb_file_grow_bytes_total", "Bytes preallocated on disk.", stats.grow.bytes_allocated);
+  w.counter("boltdb_file_shrinks_total", "Times the data file was truncated.", stats.grow.shrink_count);
+  w.counter("boltdb_file_shrink_bytes_total", "Bytes given back by truncation.", stats.grow.bytes_released);
+
+  w.gauge("boltdb_memory_pool_outstanding_bytes", "Bytes allocated from the memory pool and not released.",
+          static_cast<i64>(MemoryPool::instance().bytes_outstanding()));
+
+  w.histogram("boltdb_commit_duration_seconds", "Duration of commits", db.latency(Latency::kCommit));
+  w.histogram("boltdb_rebalance_duration_seconds", "Duration of node rebalances", db.latency(Latency::kRebalance));
+  w.histogram("boltdb_spill_duration_seconds", "Duration of node spills", db.latency(Latency::kSpill));
+  w.histogram("boltdb_write_duration_seconds", "Duration of writing the pages of a commit",
+              db.latency(Latency::kWrite));
+  w.histogram("boltdb_write_meta_duration_seconds", "Duration of writing the meta page of a commit",
+              db.latency(Latency::kWriteMeta));
+  w.histogram("boltdb_sync_duration_seconds", "Duration of data file syncs", db.latency(Latency::kSync));
+  w.histogram("boltdb_read_txn_duration_seconds", "Lifetime of read-only transactions",
+              db.latency(Latency::kReadTxn));
+  w.histogram("boltdb_remap_duration_seconds", "Duration of mmap remaps", db.latency(Latency::kRemap));
+
+  return w.size();
+}
+
+std::string render_metrics(const DB& db) {
+  std::string text(64 * 1024, '\0');
+  std::size_t size = render_metrics(db, text);
+
+  if (size > text.size()) {
+    text.resize(size);
+    size = render_metrics(db, text);
+  }
+
+  text.resize(std::min(size, text.size()));
+
+  return text;
+}
+
+Status MetricsServer::start(int port) {
+  fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  if (fd_ < 0) {
+    return {kStatusErr, format("socket: %s", std::strerror(errno))};
+  }
+
+  int one = 1;
+  ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(static_cast<u16>(port));
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+
+  if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd_, 16) != 0 ||
+      ::getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+    Status status{kStatusErr, format("listen on port %d: %s", port, std::strerror(errno))};
+    ::close(fd_);
+    fd_ = -1;
+
+    return status;
+  }
+
+  port_ = ntohs(addr.sin_port);
+  buffer_.resize(64 * 1024);
+  thread_ = std::thread([this] { serve(); });
+
+  return {};
+}
+
+void MetricsServer::stop() {
+  if (fd_ < 0) {
+    return;
+  }
+
+  // Shutting the socket down wakes the thread up from accept().
+  stopping_.store(true);
+  ::shutdown(fd_, SHUT_RDWR);
+  thread_.join();
+  ::close(fd_);
+  fd_ = -1;
+}
+
+void MetricsServer::serve() {
+  static constexpr std::string_view kHeader =
+      "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nConnection: close\r\n"
+      "Content-Length: ";
+
+  while (!stopping_.load()) {
+    int conn = ::accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+
+    if (conn < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      break;
+    }
+
+    // Read the request up to the end of its headers, the answer is the same
+    // whatever it asks for.
+    char request[4096];
+    std::size_t size = 0;
+
+    while (size < sizeof(request)) {
+      ssize_t n = ::read(conn, request + size, sizeof(request) - size);
+
+      if (n <= 0) {
+        break;
+      }
+
+      size += n;
+
+      if (std::string_view(request, size).find("\r\n\r\n") != std::string_view::npos) {
+        break;
+      }
+    }
+
+    // The buffer only grows when the metrics outgrow it.
+    std::size_t body = render_metrics(*db_, buffer_);
+
+    if (body > buffer_.size()) {
+      buffer_.resize(body * 2);
+      body = render_metrics(*db_, buffer_);
+    }
+
+    char length[24];
+    auto result = std::to_chars(length, length + sizeof(length), body);
+
+    std::string_view parts[] = {kHeader, std::string_view(length, result.ptr - length), "\r\n\r\n",
+                                std::string_view(buffer_.data(), std::min(body, buffer_.size()))};
+
+    for (auto part : parts) {
+      while (!part.empty()) {
+        ssize_t n = ::send(conn, part.data(), part.size(), MSG_NOSIGNAL);
+
+        if (n <= 0) {
+          break;
+        }
+
+        part.remove_prefix(n);
+      }
+    }
+
+    ::close(conn);
+  }
+}
+
+}  // namespace boltdb
@@ -0,0 +1,172 @@
+#include "boltdb/db/page_txids.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "boltdb/util/exception.hpp"
+#include "boltdb/util/util.hpp"
+
+namespace boltdb {
+
+Status PageTxids::open(const std::string& db_path, TxnID txid, PageID pgid, bool read_only,
+                       std::unique_ptr<PageTxids>& out_txids) {
+  std::string path = path_of(db_path);
+  auto handle = FileSystem::open(path.c_str(), read_only ? O_RDONLY : O_RDWR | O_CREAT, 0644);
+
+  if (handle == nullptr && !read_only) {
+    return {kStatusErr, format("open %s: %s", path.c_str(), strerror(errno))};
+  }
+
+  std::unique_ptr<PageTxids> txids(new PageTxids(nullptr));
+  bool current = false;
+
+  if (handle != nullptr) {
+    std::size_t size = FileSystem::file_size(*handle);
+    txids->txids_.resize(std::max(size / sizeof(TxnID), kFirstPage));
+
+    try {
+      auto* data = reinterpret_cast<Byte*>(txids->txids_.data());
+      std::size_t offset = 0;
+
+      while (offset < size) {
+        ssize_t n = handle->read(data + offset, size - offset, offset);
+
+        if (n <= 0) {
+          break;
+        }
+
+        offset += n;
+      }
+
+      size = offset;
+    } catch (const IOException& e) {
+      return {kStatusErr, e.what()};
+    }
+
+    u32 header[2];
+    std::memcpy(header, txids->txids_.data(), sizeof(header));
+
+    // A sync that didn't make it to the meta leaves the header one ahead.
+    TxnID synced_txid = txids->txids_[1];
+    current = size >= kFirstPage * sizeof(TxnID) && header[0] == kMagic && header[1] == kVersion &&
+              (synced_txid == txid || synced_txid == txid + 1);
+  }
+
+  if (!read_only) {
+    txids->file_handle_ = std::move(handle);
+  }
+
+  if (!current) {
+    txids->reset(txid, pgid);
+
+    if (!read_only) {
+      if (Status status = txids->file_handle_->truncate(0); !status.ok()) {
+        return status;
+      }
+
+      if (Status status = txids->sync(txid, true); !status.ok()) {
+        return status;
+      }
+    }
+  }
+
+  out_txids = std::move(txids);
+
+  return {};
+}
+
+void PageTxids::record(PageID pgid, int count, TxnID txid) {
+  std::lock_guard lock(mutex_);
+  std::size_t end = pgid + count;
+
+  if (end > txids_.size()) {
+    txids_.resize(end);
+  }
+
+  std::fill(txids_.begin() + pgid, txids_.begin() + end, txid);
+
+  if (dirty_begin_ == dirty_end_) {
+    dirty_begin_ = pgid;
+    dirty_end_ = end;
+  } else {
+    dirty_begin_ = std::min<std::size_t>(dirty_begin_, pgid);
+    dirty_end_ = std::max(dirty_end_, end);
+  }
+}
+
+Status PageTxids::sync(TxnID txid, bool fdatasync) {
+  std::lock_guard lock(mutex_);
+
+  u32 header[2] = {kMagic, kVersion};
+  std::memcpy(txids_.data(), header, sizeof(header));
+  txids_[1] = txid;
+
+  if (file_handle_ == nullptr) {
+    dirty_begin_ = dirty_end_ = 0;
+    return {};
+  }
+
+  // Write the entries first, the header says which transaction they're
+  // current up to.
+  try {
+    std::size_t size = (dirty_end_ - dirty_begin_) * sizeof(TxnID);
+    std::size_t offset = dirty_begin_ * sizeof(TxnID);
+
+    if (size > 0 && file_handle_->write(txids_.data() + dirty_begin_, size, offset) != static_cast<ssize_t>(size)) {
+      return {kStatusErr, format("write %s: short write", file_handle_->path.c_str())};
+    }
+
+    size = kFirstPage * sizeof(TxnID);
+
+    if (file_handle_->write(txids_.data(), size, 0) != static_cast<ssize_t>(size)) {
+      return {kStatusErr, format("write %s: short write", file_handle_->path.c_str())};
+    }
+  } catch (const IOException& e) {
+    return {kStatusErr, e.what()};
+  }
+
+  if (fdatasync) {
+    if (Status status = file_handle_->fdatasync(); !status.ok()) {
+      return status;
+    }
+  }
+
+  dirty_begin_ = dirty_end_ = 0;
+
+  return {};
+}
+
+TxnID PageTxids::get(PageID pgid) const {
+  std::lock_guard lock(mutex_);
+
+  return pgid < txids_.size() ? txids_[pgid] : 0;
+}
+
+std::vector<std::pair<PageID, PageID>> PageTxids::changed_since(TxnID base_txid, PageID pgid) const {
+  std::lock_guard lock(mutex_);
+  std::vector<std::pair<PageID, PageID>> runs;
+
+  for (PageID i = kFirstPage; i < pgid; i++) {
+    // Pages past the end of the map are not known, so they count as changed.
+    if (i < txids_.size() && txids_[i] <= base_txid) {
+      continue;
+    }
+
+    if (!runs.empty() && runs.back().second == i) {
+      runs.back().second++;
+    } else {
+      runs.emplace_back(i, i + 1);
+    }
+  }
+
+  return runs;
+}
+
+void PageTxids::reset(TxnID txid, PageID pgid) {
+  txids_.assign(std::max<std::size_t>(pgid, kFirstPage), txid);
+  dirty_begin_ = kFirstPage;
+  dirty_end_ = txids_.size();
+}
+
+}  // namespace boltdb
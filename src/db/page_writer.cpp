@@ -0,0 +1,75 @@
+#include "boltdb/db/page_writer.hpp"
+
+#include <algorithm>
+
+#include "boltdb/util/exception.hpp"
+#include "boltdb/util/util.hpp"
+
+namespace boltdb {
+
+PageWriter::PageWriter(FileHandle* file_handle, int page_size, PageID first_pgid, int buffer_size)
+    : file_handle_(file_handle),
+      page_size_(page_size),
+      next_pgid_(first_pgid),
+      buffer_pgid_(first_pgid),
+      buffer_size_(std::max(buffer_size, page_size)) {
+  buffer_.reserve(buffer_size_);
+}
+
+Status PageWriter::append(int count, PageID& out_pgid, Byte*& out_data) {
+  std::size_t size = static_cast<std::size_t>(count) * page_size_;
+
+  // Make room in the buffer. Pages larger than the buffer get a buffer of
+  // their own.
+  if (buffer_.size() + size > buffer_size_) {
+    if (Status status = flush(); !status.ok()) {
+      return status;
+    }
+  }
+
+  std::size_t offset = buffer_.size();
+  buffer_.resize(offset + size);
+
+  out_pgid = next_pgid_;
+  out_data = std::next(buffer_.data(), offset);
+  next_pgid_ += count;
+
+  return {};
+}
+
+Status PageWriter::flush() {
+  if (buffer_.empty()) {
+    return {};
+  }
+
+  std::size_t offset = buffer_pgid_ * page_size_;
+
+  try {
+    ssize_t n = file_handle_->write(buffer_.data(), buffer_.size(), offset);
+
+    if (n != static_cast<ssize_t>(buffer_.size())) {
+      return {kStatusErr, format("write: expect written %zu bytes, got %zd bytes", buffer_.size(), n)};
+    }
+  } catch (const IOException& e) {
+    return {kStatusErr, e.what()};
+  }
+
+  bytes_written_ += static_cast<i64>(buffer_.size());
+  buffer_pgid_ = next_pgid_;
+  buffer_.clear();
+
+  return {};
+}
+
+Status PageWriter::seek(PageID pgid) {
+  if (Status status = flush(); !status.ok()) {
+    return status;
+  }
+
+  next_pgid_ = pgid;
+  buffer_pgid_ = pgid;
+
+  return {};
+}
+
+}  // namespace boltdb
@@ -0,0 +1,417 @@
+#include "boltdb/db/wal.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include "boltdb/page/page.hpp"
+#include "boltdb/util/crc64.hpp"
+#include "boltdb/util/exception.hpp"
+#include "boltdb/util/util.hpp"
+
+namespace boltdb {
+
+// Each page of a record is prefixed with its id and its number of pages.
+struct WalPageHeader {
+  PageID pgid;
+  u64 count;
+};
+
+Status Wal::open(FileHandle* data_file, const Meta* data_meta, i64 checkpoint_size, bool no_sync,
+                 std::unique_ptr<Wal>& out_wal) {
+  std::string path = path_of(data_file->path);
+  auto handle = FileSystem::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+  if (handle == nullptr) {
+    return {kStatusErr, format("open %s: %s", path.c_str(), strerror(errno))};
+  }
+
+  return open(std::move(handle), data_file, data_meta, checkpoint_size, no_sync, out_wal);
+}
+
+Status Wal::open(std::unique_ptr<FileHandle> file_handle, FileHandle* data_file, const Meta* data_meta,
+                 i64 checkpoint_size, bool no_sync, std::unique_ptr<Wal>& out_wal) {
+  std::unique_ptr<Wal> wal(new Wal(std::move(file_handle), data_file, checkpoint_size, no_sync));
+
+  wal->allocated_ = static_cast<i64>(FileSystem::file_size(*wal->file_handle_));
+
+  if (Status status = wal->replay(data_meta); !status.ok()) {
+    return status;
+  }
+
+  if (checkpoint_size > 0) {
+    wal->checkpointer_ = std::thread(&Wal::run_checkpointer, wal.get());
+  }
+
+  out_wal = std::move(wal);
+
+  return {};
+}
+
+bool Wal::has_records(const std::string& db_path) {
+  std::string path = path_of(db_path);
+  auto handle = FileSystem::open(path.c_str(), O_RDONLY, 0);
+
+  if (handle == nullptr) {
+    return false;
+  }
+
+  RecordHeader header;
+  std::vector<Byte> body;
+
+  try {
+    return read_record(*handle, 0, FileSystem::file_size(*handle), header, body);
+  } catch (const IOException& e) {
+    // Don't risk dropping the commits it may hold.
+    return true;
+  }
+}
+
+Wal::~Wal() {
+  {
+    std::lock_guard lock(mutex_);
+    stopped_ = true;
+  }
+
+  cond_.notify_one();
+
+  if (checkpointer_.joinable()) {
+    checkpointer_.join();
+  }
+
+  checkpoint();
+}
+
+Status Wal::append(const Meta& meta, const std::vector<Pages>& pages, int page_size,
+                   const std::function<Status()>& apply) {
+  // Encode the whole record, so it's appended with a single write.
+  std::size_t size = sizeof(RecordHeader) + sizeof(Meta);
+
+  for (auto&& run : pages) {
+    size += sizeof(WalPageHeader) + run.count * page_size;
+  }
+
+  std::vector<Byte> buffer(size);
+  Byte* p = buffer.data() + sizeof(RecordHeader);
+  std::memcpy(p, &meta, sizeof(Meta));
+  p += sizeof(Meta);
+
+  for (auto&& run : pages) {
+    WalPageHeader header{.pgid = run.pgid, .count = run.count};
+    std::memcpy(p, &header, sizeof(header));
+    std::memcpy(p + sizeof(header), run.data, run.count * page_size);
+    p += sizeof(header) + run.count * page_size;
+  }
+
+  Byte* body = buffer.data() + sizeof(RecordHeader);
+  RecordHeader header{.magic = kMagic,
+                      .page_size = static_cast<u32>(page_size),
+                      .txid = meta.txid,
+                      .size = size - sizeof(RecordHeader),
+                      .checksum = crc64_be(0, body, size - sizeof(RecordHeader))};
+  std::memcpy(buffer.data(), &header, sizeof(header));
+
+  std::unique_lock lock(mutex_);
+
+  if (Status status = extend(size_ + static_cast<i64>(size)); !status.ok()) {
+    return status;
+  }
+
+  Status status;
+
+  try {
+    if (file_handle_->write(buffer.data(), size, size_) != static_cast<ssize_t>(size)) {
+      status = {kStatusErr, format("write %s: short write", file_handle_->path.c_str())};
+    }
+  } catch (const IOException& e) {
+    status = {kStatusErr, e.what()};
+  }
+
+  if (status.ok() && !no_sync_) {
+    status = file_handle_->fdatasync();
+  }
+
+  if (status.ok()) {
+    status = apply();
+  }
+
+  // The transaction is rolled back if its record can't be synced or the data
+  // file can't be written. The record may be on disk in full nonetheless, drop
+  // it so it isn't replayed either.
+  if (!status.ok()) {
+    invalidate(size_);
+
+    return status;
+  }
+
+  size_ += static_cast<i64>(size);
+  bool full = checkpoint_size_ > 0 && size_ >= checkpoint_size_;
+  lock.unlock();
+
+  if (full) {
+    cond_.notify_one();
+  }
+
+  return {};
+}
+
+Status Wal::checkpoint() {
+  std::unique_lock lock(mutex_);
+  i64 size = size_;
+
+  if (size == 0) {
+    return {};
+  }
+
+  // Sync without holding the lock, so commits can go on meanwhile.
+  lock.unlock();
+
+  if (!no_sync_) {
+    if (Status status = data_file_->fdatasync(); !status.ok()) {
+      return status;
+    }
+  }
+
+  lock.lock();
+
+  // The pages of the records appended meanwhile need another sync, which is
+  // short since most of the data file is clean by now.
+  if (size_ != size && !no_sync_) {
+    if (Status status = data_file_->fdatasync(); !status.ok()) {
+      return status;
+    }
+  }
+
+  return reset();
+}
+
+i64 Wal::size() const {
+  std::lock_guard lock(mutex_);
+
+  return size_;
+}
+
+i64 Wal::checkpoint_count() const {
+  std::lock_guard lock(mutex_);
+
+  return checkpoint_count_;
+}
+
+bool Wal::read_record(FileHandle& file, std::size_t offset, std::size_t file_size, RecordHeader& header,
+                      std::vector<Byte>& body) {
+  if (offset + sizeof(RecordHeader) > file_size ||
+      file.read(&header, sizeof(header), offset) != static_cast<ssize_t>(sizeof(header)) || header.magic != kMagic ||
+      header.size < sizeof(Meta) || header.size > file_size - offset - sizeof(header)) {
+    return false;
+  }
+
+  body.resize(header.size);
+
+  return file.read(body.data(), header.size, offset + sizeof(header)) == static_cast<ssize_t>(header.size) &&
+         crc64_be(0, body.data(), header.size) == header.checksum;
+}
+
+Status Wal::replay(const Meta* data_meta) {
+  std::size_t file_size = FileSystem::file_size(*file_handle_);
+  std::vector<std::size_t> offsets;
+  TxnID last_txid = 0;
+  RecordHeader header;
+  std::vector<Byte> body;
+
+  try {
+    // Find the records first. Records have consecutive ids, anything else is
+    // left over from before the last checkpoint.
+    for (std::size_t offset = 0; read_record(*file_handle_, offset, file_size, header, body);
+         offset += sizeof(header) + header.size) {
+      if (!offsets.empty() && header.txid != last_txid + 1) {
+        break;
+      }
+
+      offsets.push_back(offset);
+      last_txid = header.txid;
+    }
+
+    // The log of a data file that went on without it, or that is gone, would
+    // only write old pages over newer ones.
+    TxnID data_txid = data_meta != nullptr ? data_meta->txid : 0;
+    bool stale = last_txid < data_txid || FileSystem::file_size(*data_file_) == 0;
+
+    for (std::size_t i = 0; i < offsets.size() && !stale; i++) {
+      if (!read_record(*file_handle_, offsets[i], file_size, header, body)) {
+        return {kStatusErr, "wal: record changed while replaying"};
+      }
+
+      if (Status status = apply_record(header, body, header.txid <= data_txid); !status.ok()) {
+        return status;
+      }
+
+      if (header.txid > data_txid) {
+        replayed_count_++;
+      }
+    }
+  } catch (const IOException& e) {
+    return {kStatusErr, e.what()};
+  }
+
+  if (replayed_count_ > 0) {
+    if (Status status = data_file_->fdatasync(); !status.ok()) {
+      return status;
+    }
+  }
+
+  std::lock_guard lock(mutex_);
+
+  return reset();
+}
+
+Status Wal::apply_record(const RecordHeader& header, const std::vector<Byte>& body, bool changed_only) {
+  // Write the pages and then the meta, like a commit does.
+  int page_size = static_cast<int>(header.page_size);
+  std::vector<Byte> current;
+  Meta meta;
+  std::memcpy(&meta, body.data(), sizeof(meta));
+
+  for (std::size_t pos = sizeof(meta); pos + sizeof(WalPageHeader) <= header.size;) {
+    WalPageHeader page;
+    std::memcpy(&page, body.data() + pos, sizeof(page));
+    pos += sizeof(page);
+
+    std::size_t size = page.count * page_size;
+    std::size_t offset = page.pgid * page_size;
+
+    if (pos + size > header.size) {
+      return {kStatusCorrupt, format("wal: page %llu overruns its record", page.pgid)};
+    }
+
+    if (changed_only) {
+      current.resize(size);
+
+      if (data_file_->read(current.data(), size, offset) == static_cast<ssize_t>(size) &&
+          std::memcmp(current.data(), body.data() + pos, size) == 0) {
+        pos += size;
+        continue;
+      }
+    }
+
+    if (data_file_->write(body.data() + pos, size, offset) != static_cast<ssize_t>(size)) {
+      return {kStatusErr, "wal: short write while replaying"};
+    }
+
+    pos += size;
+  }
+
+  // The data file holds a meta at least as new.
+  if (changed_only) {
+    return {};
+  }
+
+  Page meta_page(meta.txid % 2, PageFlag::kMeta, page_size);
+  *meta_page.meta() = meta;
+
+  if (data_file_->write(meta_page.data(), page_size, meta_page.id() * page_size) != page_size) {
+    return {kStatusErr, "wal: short write while replaying"};
+  }
+
+  return {};
+}
+
+Status Wal::reset() {
+  // The log is overwritten in place from the start, which keeps the syncs of
+  // the next records cheap: they don't change the size of the file. Records
+  // left behind are never replayed, the chain stops at the first record that
+  // isn't newer than the one before.
+  if (checkpoint_size_ > 0 && size_ <= 2 * checkpoint_size_) {
+    if (Status status = invalidate(0); !status.ok()) {
+      return status;
+    }
+  } else {
+    if (Status status = file_handle_->truncate(0); !status.ok()) {
+      return status;
+    }
+
+    allocated_ = 0;
+
+    if (!no_sync_) {
+      if (Status status = file_handle_->fsync(); !status.ok()) {
+        return status;
+      }
+    }
+  }
+
+  if (size_ > 0) {
+    checkpoint_count_++;
+  }
+
+  size_ = 0;
+
+  return {};
+}
+
+Status Wal::extend(i64 size) {
+  if (size <= allocated_) {
+    return {};
+  }
+
+  static const std::vector<Byte> zeros(kExtendSize);
+  i64 end = std::max(size, allocated_ + kExtendSize);
+
+  try {
+    for (i64 offset = allocated_; offset < end;) {
+      std::size_t n = std::min<std::size_t>(zeros.size(), end - offset);
+
+      if (file_handle_->write(zeros.data(), n, offset) != static_cast<ssize_t>(n)) {
+        return {kStatusErr, format("write %s: short write", file_handle_->path.c_str())};
+      }
+
+      offset += static_cast<i64>(n);
+    }
+  } catch (const IOException& e) {
+    return {kStatusErr, e.what()};
+  }
+
+  allocated_ = end;
+
+  return {};
+}
+
+Status Wal::invalidate(i64 offset) {
+  RecordHeader header{};
+
+  try {
+    if (file_handle_->write(&header, sizeof(header), offset) != static_cast<ssize_t>(sizeof(header))) {
+      return {kStatusErr, format("write %s: short write", file_handle_->path.c_str())};
+    }
+  } catch (const IOException& e) {
+    return {kStatusErr, e.what()};
+  }
+
+  if (!no_sync_) {
+    return file_handle_->fdatasync();
+  }
+
+  return {};
+}
+
+void Wal::run_checkpointer() {
+  std::unique_lock lock(mutex_);
+
+  while (!stopped_) {
+    cond_.wait(lock, [this] { return stopped_ || size_ >= checkpoint_size_; });
+
+    if (stopped_) {
+      break;
+    }
+
+    lock.unlock();
+    Status status = checkpoint();
+    lock.lock();
+
+    // Try again later rather than spinning on a failing disk.
+    if (!status.ok()) {
+      cond_.wait_for(lock, std::chrono::seconds(1), [this] { return stopped_; });
+    }
+  }
+}
+
+}  // namespace boltdb
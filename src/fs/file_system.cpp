@@ -1,6 +1,7 @@
 #include "boltdb/fs/file_system.hpp"
 
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include <cerrno>
@@ -11,12 +12,13 @@
 #include <thread>
 
 #include "boltdb/util/exception.hpp"
+#include "boltdb/util/probe.hpp"
 #include "boltdb/util/timer.hpp"
 #include "boltdb/util/util.hpp"
 
 namespace boltdb {
 
-class UnixFileHandle final : public FileHandle {
+class UnixFileHandle : public FileHandle {
  public:
   UnixFileHandle(std::string path, int fd)
       : FileHandle(std::move(path)), fd_(fd) {}
@@ -42,7 +44,9 @@ class UnixFileHandle final : public FileHandle {
                 std::size_t offset) override {
     set_file_pointer(offset);
 
+    BOLTDB_PROBE(file__write__start, fd_, offset, nbytes);
     ssize_t bytes_written = ::write(fd_, in_buffer, nbytes);
+    BOLTDB_PROBE(file__write__done, fd_, bytes_written);
 
     if (bytes_written == -1) {
       std::string error = format("Could not write file \"%s\": %s",
@@ -64,7 +68,9 @@ class UnixFileHandle final : public FileHandle {
   }
 
   Status fdatasync() override {
+    BOLTDB_PROBE(file__fdatasync__start, fd_);
     int res = ::fdatasync(fd_);
+    BOLTDB_PROBE(file__fdatasync__done, fd_, res);
 
     if (res != 0) {
       std::string error = format("fdatasync: %s", strerror(errno));
@@ -74,6 +80,56 @@ class UnixFileHandle final : public FileHandle {
     return {};
   }
 
+  Status fsync() override {
+    int res = ::fsync(fd_);
+
+    if (res != 0) {
+      std::string error = format("fsync: %s", strerror(errno));
+      return {kStatusErr, error};
+    }
+
+    return {};
+  }
+
+  Status allocate(std::size_t offset, std::size_t nbytes) override {
+#if defined(__linux__)
+    if (::fallocate(fd_, 0, offset, nbytes) == 0) {
+      return {};
+    }
+
+    // Not every file system supports fallocate, fall back to ftruncate.
+    if (errno != EOPNOTSUPP && errno != ENOSYS) {
+      std::string error = format("fallocate: %s", strerror(errno));
+      return {kStatusErr, error};
+    }
+#endif
+
+    struct stat st;
+
+    if (fstat(fd_, &st) != 0) {
+      std::string error = format("fstat: %s", strerror(errno));
+      return {kStatusErr, error};
+    }
+
+    // Only extend the file, never shrink it.
+    if (static_cast<std::size_t>(st.st_size) >= offset + nbytes) {
+      return {};
+    }
+
+    return truncate(offset + nbytes);
+  }
+
+  Status truncate(std::size_t size) override {
+    int res = ::ftruncate(fd_, static_cast<off_t>(size));
+
+    if (res != 0) {
+      std::string error = format("ftruncate: %s", strerror(errno));
+      return {kStatusErr, error};
+    }
+
+    return {};
+  }
+
   Status flock(int operation, double timeout_s) override {
     Timer timer(timeout_s);
 
@@ -102,7 +158,7 @@ class UnixFileHandle final : public FileHandle {
     return {};
   }
 
-  int fd() const { return fd_; }
+  int fd() const override { return fd_; }
 
  private:
   // Set the file pointer of a file handle to a specified location.
@@ -120,7 +176,21 @@ class UnixFileHandle final : public FileHandle {
   }
 
   int fd_;
-  bool flocked_;
+  bool flocked_{};
+};
+
+// MemoryFileHandle is a file that only lives in memory, created with
+// memfd_create(2). It can be read, written, locked and mmapped like a regular
+// file, but nothing ever reaches a disk so syncing is a no-op.
+class MemoryFileHandle final : public UnixFileHandle {
+ public:
+  explicit MemoryFileHandle(int fd) : UnixFileHandle(format("/proc/self/fd/%d", fd), fd) {}
+
+  Status fdatasync() override { return {}; }
+
+  Status fsync() override { return {}; }
+
+  bool in_memory() const override { return true; }
 };
 
 std::unique_ptr<FileHandle> FileSystem::create(const char* path) noexcept {
@@ -138,6 +208,16 @@ std::unique_ptr<FileHandle> FileSystem::open(const char* path, int oflag,
   return std::make_unique<UnixFileHandle>(path, fd);
 }
 
+std::unique_ptr<FileHandle> FileSystem::create_memory(const char* name) noexcept {
+  int fd = ::memfd_create(name, MFD_CLOEXEC);
+
+  if (fd == -1) {
+    return nullptr;
+  }
+
+  return std::make_unique<MemoryFileHandle>(fd);
+}
+
 bool FileSystem::exists(FileHandle& handle) {
   std::string path = handle.path;
 
@@ -158,8 +238,7 @@ Status FileSystem::remove(FileHandle& handle) {
 
 std::uintmax_t FileSystem::file_size(FileHandle& handle) {
   struct stat st;
-  int fd = static_cast<UnixFileHandle&>(handle).fd();
-  int res = fstat(fd, &st);
+  int res = fstat(handle.fd(), &st);
 
   if (res == -1) {
     return static_cast<std::uintmax_t>(-1);
@@ -1,7 +1,9 @@
 #include "boltdb/page/freelist.hpp"
 
+#include "boltdb/db/db.hpp"
 #include "boltdb/page/page.hpp"
 #include "boltdb/util/exception.hpp"
+#include "boltdb/util/probe.hpp"
 
 namespace boltdb {
 
@@ -18,7 +20,7 @@ std::vector<T> merge_two(const std::vector<T>& v1, const std::vector<T>& v2) {
 int FreeList::byte_size() const {
   auto n = count();
 
-  if (n >= kSpecialCount) {
+  if (n >= DB::kSpecialCount) {
     // The first element will be used to store the count.
     // See freelist.write.
     n++;
@@ -61,12 +63,16 @@ PageID FreeList::allocate_contiguous(int n) {
         cache_.erase(j + first_id);
       }
 
+      BOLTDB_PROBE(freelist__allocate, first_id, n);
+
       return first_id;
     }
 
     prev_id = id;
   }
 
+  BOLTDB_PROBE(freelist__allocate, 0, n);
+
   return 0;
 }
 
@@ -92,6 +98,8 @@ void FreeList::free(TxnID txn_id, const Page& page) {
     pending_[txn_id].push_back(i);
     cache_[i] = true;
   }
+
+  BOLTDB_PROBE(freelist__free, txn_id, pgid, overflow + 1);
 }
 
 void FreeList::release(TxnID txn_id) {
@@ -117,6 +125,30 @@ void FreeList::release(TxnID txn_id) {
   ids_ = merge_two(pgids, ids_);
 }
 
+PageID FreeList::trim(PageID high_water_mark, int min_count) {
+  // Walk back from the largest id while the ids are contiguous and end at the
+  // high water mark.
+  auto first = ids_.end();
+  PageID next = high_water_mark;
+
+  while (first != ids_.begin() && *std::prev(first) + 1 == next) {
+    first = std::prev(first);
+    next = *first;
+  }
+
+  if (std::distance(first, ids_.end()) < std::max(min_count, 1)) {
+    return high_water_mark;
+  }
+
+  for (auto iter = first; iter != ids_.end(); iter++) {
+    cache_.erase(*iter);
+  }
+
+  ids_.erase(first, ids_.end());
+
+  return next;
+}
+
 void FreeList::rollback(TxnID txn_id) {
   // Remove page ids from cache.
   for (auto id : pending_[txn_id]) {
@@ -146,7 +178,7 @@ void FreeList::read_from(const Page& page) {
   int count = page.count();
   Byte* base = const_cast<Byte*>(page.skip_page_header());
 
-  if (count == kSpecialCount) {
+  if (count == DB::kSpecialCount) {
     count = *reinterpret_cast<PageID*>(base);
     base = std::next(base, sizeof(PageID));
   }
@@ -180,12 +212,12 @@ Status FreeList::write_to(Page& out_page) {
   Byte* base = out_page.skip_page_header();
   auto first = reinterpret_cast<PageID*>(base);
 
-  if (n < kSpecialCount) {
+  if (n < DB::kSpecialCount) {
     out_page.set_count(n);
   } else {
-    out_page.set_count(kSpecialCount);
+    out_page.set_count(DB::kSpecialCount);
     *first = n;
-    first = std::next(first, sizeof(PageID));
+    first = std::next(first);
   }
 
   auto pending_pgids = sorted_pending_pgids();
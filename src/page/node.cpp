@@ -1,5 +1,7 @@
 #include "boltdb/page/node.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <exception>
 #include <utility>
 
@@ -8,36 +10,12 @@
 #include "boltdb/page/page.hpp"
 #include "boltdb/transaction/txn.hpp"
 #include "boltdb/util/exception.hpp"
+#include "boltdb/util/probe.hpp"
+#include "boltdb/util/thread_pool.hpp"
 #include "boltdb/util/util.hpp"
 
 namespace boltdb {
 
-// The byte size is computed as:
-// Page Header | Page Element Size1 + Len(key1) + Len(value1) ...
-//               Page Element SizeN + Len(keyN) + Len(valueN)
-int Node::byte_size() const {
-  int elsz = page_element_size();
-
-  return std::accumulate(inodes_.begin(), inodes_.end(), kPageHeaderSize, [elsz](int init, const Inode& inode) {
-    return init + elsz + inode.key.size() + inode.value.size();
-  });
-}
-
-bool Node::is_size_less_than(int v) const {
-  int sz = kPageHeaderSize;
-  int elsz = page_element_size();
-
-  for (auto&& inode : inodes_) {
-    sz += elsz + inode.key.size() + inode.value.size();
-
-    if (sz >= v) {
-      return false;
-    }
-  }
-
-  return true;
-}
-
 Node* Node::child_at(int index) {
   if (is_leaf_) {
     std::string err = format("invalid child_at(%d) on a leaf node", index);
@@ -50,12 +28,15 @@ Node* Node::child_at(int index) {
   if (!cached) {
     children_.push_back(n);
   }
+
+  return n;
 }
 
 int Node::child_index(const Node* child) const {
   auto first = inodes_.begin();
   auto last = inodes_.end();
-  auto iter = std::lower_bound(first, last, child->first_key_, std::less<ByteSlice>{});
+  auto iter = std::lower_bound(first, last, child->first_key_,
+                               [](const Inode& inode, const ByteSlice& key) { return inode.key < key; });
 
   return std::distance(first, iter);
 }
@@ -119,12 +100,21 @@ void Node::put(ByteSlice old_key, ByteSlice new_key, ByteSlice value, PageID pgi
   int index = index_of(old_key);
 
   // Add capacity and shift nodes if we don't have an exact match and need to insert.
-  auto exist = (!inodes_.empty() && index < inodes_.size() && inodes_[index].key == old_key);
+  auto exist = (!inodes_.empty() && index < static_cast<int>(inodes_.size()) && inodes_[index].key == old_key);
   if (!exist) {
     auto iter = std::next(inodes_.begin(), index);
     inodes_.insert(iter, Inode{});
+  } else {
+    data_size_ -= inodes_[index].key.size() + inodes_[index].value.size();
+  }
+
+  // Keep track of new keys appended to the bucket.
+  if (is_leaf_ && !exist) {
+    bucket_->record_insert(index + 1 == static_cast<int>(inodes_.size()) && is_right_edge());
   }
 
+  data_size_ += new_key.size() + value.size();
+
   inodes_[index].flags = flags;
   inodes_[index].key = new_key;
   inodes_[index].value = value;
@@ -135,11 +125,12 @@ void Node::remove(ByteSlice key) {
   int index = index_of(key);
 
   // Exit if the key isn't found.
-  if (index >= inodes_.size() || key != inodes_[index].key) {
+  if (index >= static_cast<int>(inodes_.size()) || key != inodes_[index].key) {
     return;
   }
 
   // Delete inode from the node.
+  data_size_ -= inodes_[index].key.size() + inodes_[index].value.size();
   auto iter = std::next(inodes_.begin(), index);
   inodes_.erase(iter);
 
@@ -148,6 +139,125 @@ void Node::remove(ByteSlice key) {
   unbalanced_ = true;
 }
 
+void Node::rebalance() {
+  if (!unbalanced_) {
+    return;
+  }
+
+  unbalanced_ = false;
+
+  // Update statistics.
+  Txn* txn = bucket_->txn();
+  txn->stats.rebalance++;
+
+  // Ignore if node is above threshold and has enough keys.
+  int threshold = static_cast<int>(txn->page_size() * bucket_->merge_percent());
+
+  if (byte_size() > threshold && static_cast<int>(inodes_.size()) > min_keys()) {
+    return;
+  }
+
+  // Root node has special handling.
+  if (parent_ == nullptr) {
+    // If root node is a branch and only has one node then collapse it.
+    if (!is_leaf_ && inodes_.size() == 1) {
+      Node* child;
+      bucket_->node(inodes_[0].pgid, this, child);
+
+      // Move root's child up.
+      is_leaf_ = child->is_leaf_;
+      inodes_ = std::move(child->inodes_);
+      data_size_ = child->data_size_;
+      children_.clear();
+      child->inodes_.clear();
+      child->data_size_ = 0;
+
+      // Reparent all child nodes being moved.
+      adopt_children();
+
+      // Remove old child.
+      child->parent_ = nullptr;
+      child->free();
+    }
+
+    return;
+  }
+
+  // If node has no keys then just remove it.
+  if (inodes_.empty()) {
+    parent_->remove(first_key_);
+    parent_->remove_child(this);
+    free();
+    parent_->rebalance();
+
+    return;
+  }
+
+  assert(parent_->num_children() > 1);
+
+  // Merge the next sibling into the first child, and every other node into
+  // its previous sibling.
+  Node* target = this;
+  Node* source = next_sibling();
+
+  if (parent_->child_index(this) != 0) {
+    target = prev_sibling();
+    source = this;
+  }
+
+  // Move the inodes of the source, and the nodes materialized below it.
+  target->data_size_ += source->data_size_;
+  target->inodes_.insert(target->inodes_.end(), std::make_move_iterator(source->inodes_.begin()),
+                         std::make_move_iterator(source->inodes_.end()));
+  source->inodes_.clear();
+  source->data_size_ = 0;
+  target->adopt_children();
+
+  // Remove the source from the parent, and free its page.
+  parent_->remove(source->first_key_);
+  parent_->remove_child(source);
+  source->unbalanced_ = false;
+  source->free();
+
+  // Either this node or target node was deleted from the parent so rebalance it.
+  parent_->rebalance();
+}
+
+void Node::remove_child(const Node* target) {
+  auto iter = std::find(children_.begin(), children_.end(), target);
+
+  if (iter != children_.end()) {
+    children_.erase(iter);
+  }
+}
+
+void Node::adopt_children() {
+  if (is_leaf_) {
+    return;
+  }
+
+  for (auto&& inode : inodes_) {
+    auto [_, child] = bucket_->page_node(inode.pgid);
+
+    if (child != nullptr && child->parent_ != this) {
+      if (child->parent_ != nullptr) {
+        child->parent_->remove_child(child);
+      }
+
+      child->parent_ = this;
+      children_.push_back(child);
+    }
+  }
+}
+
+void Node::free() {
+  if (pgid_ != 0) {
+    bucket_->txn()->free(pgid_);
+    bucket_->remove_node(pgid_);
+    pgid_ = 0;
+  }
+}
+
 // TODO(gc): value and pgid can't exist at same time, try use variant.
 // page no child page information.
 void Node::read(const Page& page) {
@@ -163,11 +273,13 @@ void Node::read(const Page& page) {
     for (auto i = 0; i < count; i++) {
       auto element = page.leaf_page_element(i);
       inodes_.emplace_back(element->flags, static_cast<PageID>(0), element->key(), element->value());
+      data_size_ += element->key_size + element->value_size;
     }
   } else {
     for (auto i = 0; i < count; i++) {
       auto element = page.branch_page_element(i);
       inodes_.emplace_back(static_cast<u32>(PageFlag::kInvalid), element->pgid, element->key(), ByteSlice{});
+      data_size_ += element->key_size;
     }
   }
 
@@ -200,7 +312,7 @@ void Node::write(Page& page) {
   auto size = inodes_.size();
 
   if (size >= DB::kSpecialCount) {
-    std::string error = format("inode overflow: %d (pgid=%d)", size, page->id());
+    std::string error = format("inode overflow: %d (pgid=%d)", size, page.id());
 
     throw NodeException(error);
   }
@@ -220,7 +332,7 @@ void Node::write(Page& page) {
 
   // TODO(gc): add enumeration support.
   if (is_leaf_) {
-    for (int i = 0; i < size; i++) {
+    for (std::size_t i = 0; i < size; i++) {
       auto& inode = inodes_[i];
       auto& key = inode.key;
       auto& val = inode.value;
@@ -231,12 +343,12 @@ void Node::write(Page& page) {
       element->key_size = key.size();
       element->value_size = val.size();
       base = std::copy(key.data(), std::next(key.data(), key.size()), base);
+      base = std::copy(val.data(), std::next(val.data(), val.size()), base);
     }
   } else {
-    for (int i = 0; i < size; i++) {
+    for (std::size_t i = 0; i < size; i++) {
       auto& inode = inodes_[i];
       auto& key = inode.key;
-      auto& val = inode.value;
       auto element = page.branch_page_element(static_cast<u16>(i));
 
       element->pos = std::distance(reinterpret_cast<Byte*>(element), base);
@@ -251,100 +363,166 @@ void Node::write(Page& page) {
 }
 
 int Node::index_of(ByteSlice key) {
-  auto iter = std::lower_bound(inodes_.begin(), inodes_.end(), key);
+  auto iter = std::lower_bound(inodes_.begin(), inodes_.end(), key,
+                               [](const Inode& inode, const ByteSlice& key) { return inode.key < key; });
 
-  int index = std::distance(inodes_.begin(), iter);
+  return std::distance(inodes_.begin(), iter);
 }
 
-std::vector<Node*> Node::split(int page_size) {
-  std::vector<Node*> nodes;
-  Node* split_node = this;
-
-  while (true) {
-    auto [left, right] = split_node->split_two(page_size);
-    nodes.push_back(left);
-
-    // If we can't split then exit the loop.
-    if (right == nullptr) {
-      break;
+bool Node::is_right_edge() const {
+  for (const Node* n = this; n->parent_ != nullptr; n = n->parent_) {
+    if (n->parent_->child_index(n) + 1 < n->parent_->num_children()) {
+      return false;
     }
-
-    // Continue to split right node.
-    split_node = right;
   }
 
-  return nodes;
+  return true;
 }
 
-// TODO(gc): take care of memory leak, should the node freed in the bucket or in this destructor?
-std::pair<Node*, Node*> Node::split_two(int page_size) {
-  // Ignore the split if the page doesn't have at least enough nodes for two
-  // pages or if the nodes can fit in a single page.
-  if (inodes_.size() <= 2 * kMinKeysPerPage || is_size_less_than(page_size)) {
-    return std::make_pair(this, nullptr);
-  }
-
+std::vector<Node*> Node::split(int page_size) {
   // Determine the threshold before starting a new node.
   // Fill percent must be in the range [kMinFillPercent, kMaxFillPercent].
   f64 fill_percent = bucket_->fill_percent();
   fill_percent = std::max(fill_percent, Bucket::kMinFillPercent);
   fill_percent = std::min(fill_percent, Bucket::kMaxFillPercent);
 
+  // Appended keys never go back to the pages on the left, so fill them up.
+  bool append = bucket_->append_mode();
+
+  if (append) {
+    fill_percent = Bucket::kMaxFillPercent;
+  }
+
   int threshold = static_cast<int>(page_size * fill_percent);
+  std::vector<Node*> nodes{this};
+
+  // Most nodes fit in their page, which the running size tells without looking
+  // at the inodes.
+  if (static_cast<int>(inodes_.size()) <= 2 * kMinKeysPerPage || byte_size() < page_size) {
+    return nodes;
+  }
+
+  // Sum the element sizes once, so each page boundary is a binary search.
+  int elsz = page_element_size();
+  std::vector<int> sizes(inodes_.size() + 1);
+
+  for (std::size_t i = 0; i < inodes_.size(); i++) {
+    sizes[i + 1] = sizes[i] + elsz + inodes_[i].key.size() + inodes_[i].value.size();
+  }
+
+  // Find where each of the new nodes starts. The inodes are moved to their
+  // node once, so splitting a large node stays linear.
+  std::vector<int> offsets{0};
 
-  // Determine split position and sizes of the two pages.
-  auto [index, _] = split_index(threshold);
+  while (can_split(sizes, offsets.back(), page_size)) {
+    auto [index, _] = split_index(sizes, offsets.back(), threshold);
+    offsets.push_back(index);
+  }
 
-  // Split node into two separate nodes.
   // If there's no parent then we'll need to create one.
   if (parent_ == nullptr) {
-    parent_ = new Node(PageID{}, bucket_, nullptr);
+    parent_ = bucket_->make_node(PageID{}, nullptr);
     parent_->children_.push_back(this);
   }
 
-  // Create a new node and add it to the parent.
-  Node* next = new Node(PageID{}, bucket_, parent_);
-  next->is_leaf_ = is_leaf_;
-  parent_->children_.push_back(next);
+  for (std::size_t i = 1; i < offsets.size(); i++) {
+    // Create a new node and add it to the parent.
+    Node* next = bucket_->make_node(PageID{}, parent_);
+    next->is_leaf_ = is_leaf_;
+    parent_->children_.push_back(next);
 
-  // Split inodes across two nodes.
-  auto iter = std::next(inodes_.begin(), index);
-  int size = std::distance(iter, inodes_.end());
-  next->inodes_.resize(size);
+    auto first = std::next(inodes_.begin(), offsets[i]);
+    auto last = i + 1 < offsets.size() ? std::next(inodes_.begin(), offsets[i + 1]) : inodes_.end();
+    next->inodes_.assign(std::make_move_iterator(first), std::make_move_iterator(last));
+    next->data_size_ = sizes[std::distance(inodes_.begin(), last)] - sizes[offsets[i]] - elsz * next->inodes_.size();
+    nodes.push_back(next);
+
+    // Update the statistics.
+    bucket_->txn()->stats.split++;
+
+    if (append) {
+      bucket_->txn()->stats.append_split++;
+    }
+  }
+
+  BOLTDB_PROBE(node__split, inodes_.size(), nodes.size());
+
+  inodes_.resize(offsets[1]);
+  data_size_ = sizes[offsets[1]] - elsz * offsets[1];
+
+  return nodes;
+}
+
+bool Node::can_split(const std::vector<int>& sizes, int first, int page_size) const {
+  // Ignore the split if the page doesn't have at least enough nodes for two
+  // pages or if the nodes can fit in a single page.
+  int size = static_cast<int>(inodes_.size());
+
+  if (size - first <= 2 * kMinKeysPerPage) {
+    return false;
+  }
+
+  return kPageHeaderSize + sizes[size] - sizes[first] >= page_size;
+}
 
-  std::copy(iter, inodes_.end(), next->inodes_.begin());
-  inodes_.resize(index);
+std::pair<int, int> Node::split_index(const std::vector<int>& sizes, int first, int threshold) const {
+  // Stop before the first inode that would put the page over the threshold,
+  // keeping at least the minimum number of keys on this page and the next.
+  int size = static_cast<int>(inodes_.size());
+  int last = std::max(first, size - kMinKeysPerPage);
+  int limit = threshold - kPageHeaderSize + sizes[first];
 
-  // Update the statistics.
-  bucket_->txn()->stats.split++;
+  auto begin = std::next(sizes.begin(), std::min(first + kMinKeysPerPage, last) + 1);
+  auto end = std::next(sizes.begin(), last + 1);
+  int i = static_cast<int>(std::distance(sizes.begin(), std::upper_bound(begin, end, limit))) - 1;
 
-  return std::make_pair(this, next);
+  return std::make_pair(i, kPageHeaderSize + sizes[i] - sizes[first]);
 }
 
-std::pair<int, int> Node::split_index(int threshold) {
-  int i;
-  int sz = kPageHeaderSize;
+Status Node::spill() {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<SpilledNode> spilled;
+  Txn* txn = bucket_->txn();
 
-  // Loop until we only have the minimum number of keys
-  // required for the second page.
-  for (i = 0; i < inodes_.size() - kMinKeysPerPage; i++) {
-    auto& inode = inodes_[i];
-    int elsize = page_element_size() + inode.key.size() + inode.value.size();
+  if (Status status = spill_to(spilled); !status.ok()) {
+    return status;
+  }
+
+  write_all(spilled, txn->db()->spill_pool());
+
+  Duration elapsed = std::chrono::steady_clock::now() - start;
+  txn->stats.spill_time += elapsed;
+  txn->db()->record_latency(Latency::kSpill, elapsed);
+
+  return {};
+}
 
-    // If we have at least the minimum number of keys and adding another node
-    // would put us over the threshold then exit and return.
-    if (i >= kMinKeysPerPage && sz + elsize > threshold) {
-      break;
+void Node::write_all(const std::vector<SpilledNode>& spilled, ThreadPool* pool) {
+  int size = static_cast<int>(spilled.size());
+
+  if (pool == nullptr || size <= 1) {
+    for (auto&& [node, page] : spilled) {
+      node->write(*page);
     }
 
-    // Add the element size to the total size.
-    sz += elsize;
+    return;
   }
 
-  return std::make_pair(i, sz);
+  // Hand out a few ranges per worker so that idle workers can steal from the
+  // ones stuck with large nodes.
+  int chunks = std::min(size, pool->size() * 4);
+
+  pool->parallel_for(chunks, [&spilled, size, chunks](int chunk) {
+    int first = static_cast<int>(static_cast<i64>(size) * chunk / chunks);
+    int last = static_cast<int>(static_cast<i64>(size) * (chunk + 1) / chunks);
+
+    for (int i = first; i < last; i++) {
+      spilled[i].node->write(*spilled[i].page);
+    }
+  });
 }
 
-Status Node::spill() {
+Status Node::spill_to(std::vector<SpilledNode>& spilled) {
   auto txn = bucket_->txn();
 
   if (spilled_) {
@@ -357,14 +535,13 @@ Status Node::spill() {
   std::sort(children_.begin(), children_.end(),
             [](const Node* lhs, const Node* rhs) { return lhs->inodes_[0].key < rhs->inodes_[0].key; });
 
-  for (auto&& child : children_) {
-    if (Status status = child->spill(); !status.ok()) {
+  for (std::size_t i = 0; i < children_.size(); i++) {
+    if (Status status = children_[i]->spill_to(spilled); !status.ok()) {
       return status;
     }
   }
 
   // We no longer need the child list because it's only used for spill tracking.
-  // TODO(gc): memory leak
   children_.clear();
 
   // Split nodes into appropriate sizes. The first node will always be n.
@@ -377,7 +554,58 @@ Status Node::spill() {
       txn->free(node->pgid_);
       node->pgid_ = 0;
     }
+
+    // Allocate contiguous space for the node. The node is written to the page
+    // once the whole tree has been allocated.
+    Page* page;
+
+    // A node that exactly fills its pages doesn't need one more, which matters
+    // for nodes split full in append mode.
+    int count = (node->byte_size() + page_size - 1) / page_size;
+
+    if (Status status = txn->allocate(count, page); !status.ok()) {
+      return status;
+    }
+
+    if (page->id() >= txn->meta_page_id()) {
+      return {kStatusErr, format("pgid (%d) above high water mark (%d)", page->id(), txn->meta_page_id())};
+    }
+
+    node->pgid_ = page->id();
+    node->spilled_ = true;
+    BOLTDB_PROBE(node__spill, node->pgid_, node->byte_size(), count);
+    spilled.push_back({node, page});
+
+    // Insert into parent inodes.
+    if (node->parent_ != nullptr) {
+      ByteSlice key = node->first_key_;
+
+      if (key.is_empty()) {
+        key = node->inodes_[0].key;
+      }
+
+      node->parent_->put(key, node->inodes_[0].key, {}, node->pgid_, 0);
+      node->first_key_ = node->inodes_[0].key;
+
+      assert(!node->first_key_.is_empty());
+    }
+
+    // Update the statistics.
+    txn->stats.spill++;
+    txn->stats.spill_bytes += node->byte_size();
+    txn->stats.spill_alloc += count * page_size;
   }
+
+  // If the root node split and created a new root then we need to spill that
+  // as well. We'll clear out the children to make sure it doesn't try to
+  // respill.
+  if (parent_ != nullptr && parent_->pgid_ == 0) {
+    children_.clear();
+
+    return parent_->spill_to(spilled);
+  }
+
+  return {};
 }
 
-}  // namespace boltdb
\ No newline at end of file
+}  // namespace boltdb
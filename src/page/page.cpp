@@ -1,10 +1,10 @@
 #include "boltdb/page/page.hpp"
 
 #include <iostream>
+#include <new>
 #include <sstream>
 #include <type_traits>
 
-#include "boltdb/util/binary.hpp"
 #include "boltdb/util/util.hpp"
 
 namespace boltdb {
@@ -19,12 +19,9 @@ Byte* advance_n_bytes(const T* p, std::size_t n) {
   return advance_n_bytes(const_cast<T*>(p), n);
 }
 
-Page::Page(PageID pgid, PageFlag flag, int page_size) : page_size_(page_size) {
-  pdata_.reserve(page_size_);
-  pdata_ = binary::LittleEndian::append_variadic_uint(
-      pdata_, pgid, static_cast<u16>(flag), static_cast<u16>(0),
-      static_cast<u32>(0));
-  pheader_ = reinterpret_cast<PageHeader*>(pdata_.data());
+Page::Page(PageID pgid, PageFlag flag, int page_size)
+    : page_size_(page_size), pdata_(std::make_shared<Byte[]>(page_size)) {
+  pheader_ = new (pdata_.get()) PageHeader(pgid, flag);
 }
 
 std::string Page::type() const {
@@ -128,6 +125,8 @@ ByteSlice BranchPageElement::key() const {
   return {key, key + key_size};
 }
 
+std::span<const Byte> BranchPageElement::key_view() const { return {advance_n_bytes(this, pos), key_size}; }
+
 ByteSlice LeafPageElement::key() const {
   Byte* key = advance_n_bytes(this, pos);
 
@@ -140,4 +139,10 @@ ByteSlice LeafPageElement::value() const {
   return {value, value + value_size};
 }
 
+std::span<const Byte> LeafPageElement::key_view() const { return {advance_n_bytes(this, pos), key_size}; }
+
+std::span<const Byte> LeafPageElement::value_view() const {
+  return {advance_n_bytes(this, pos + key_size), value_size};
+}
+
 }  // namespace boltdb
\ No newline at end of file
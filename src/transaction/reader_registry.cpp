@@ -0,0 +1,73 @@
+#include "boltdb/transaction/reader_registry.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+namespace boltdb {
+
+ReaderRegistry::ReaderRegistry(int max_readers)
+    : capacity_(std::max(max_readers, 1)), slots_(std::make_unique<Slot[]>(capacity_)) {}
+
+int ReaderRegistry::acquire() {
+  // Start probing from a per-thread position so that threads opening
+  // transactions at the same time don't race for the same slots.
+  thread_local const std::size_t hint = std::hash<std::thread::id>{}(std::this_thread::get_id());
+
+  for (int i = 0; i < capacity_; i++) {
+    int slot = static_cast<int>((hint + i) % capacity_);
+    TxnID expected = kIdle;
+
+    if (slots_[slot].txn_id.compare_exchange_strong(expected, kClaimed, std::memory_order_seq_cst)) {
+      return slot;
+    }
+  }
+
+  return -1;
+}
+
+TxnID ReaderRegistry::oldest(TxnID fallback) const {
+  TxnID result = fallback;
+
+  for (int i = 0; i < capacity_; i++) {
+    TxnID txn_id = slots_[i].txn_id.load(std::memory_order_seq_cst);
+
+    if (txn_id != kIdle) {
+      result = std::min(result, txn_id);
+    }
+  }
+
+  return result;
+}
+
+PageID ReaderRegistry::highest_pgid(PageID fallback) const {
+  PageID result = fallback;
+
+  for (int i = 0; i < capacity_; i++) {
+    TxnID txn_id = slots_[i].txn_id.load(std::memory_order_seq_cst);
+
+    if (txn_id == kClaimed) {
+      return kUnknownPgid;
+    }
+
+    if (txn_id != kIdle) {
+      result = std::max(result, slots_[i].pgid.load(std::memory_order_relaxed));
+    }
+  }
+
+  return result;
+}
+
+int ReaderRegistry::count() const {
+  int n = 0;
+
+  for (int i = 0; i < capacity_; i++) {
+    if (slots_[i].txn_id.load(std::memory_order_relaxed) != kIdle) {
+      n++;
+    }
+  }
+
+  return n;
+}
+
+}  // namespace boltdb
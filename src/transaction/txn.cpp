@@ -1,16 +1,620 @@
 #include "boltdb/transaction/txn.hpp"
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <thread>
+
+#include "boltdb/db/bucket.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/db/wal.hpp"
+#include "boltdb/fs/file_system.hpp"
+#include "boltdb/page/page.hpp"
+#include "boltdb/util/crc64.hpp"
+#include "boltdb/util/exception.hpp"
+#include "boltdb/util/probe.hpp"
+#include "boltdb/util/util.hpp"
+
 namespace boltdb {
 
-Page* Txn::page(PageID pgid) {
-  if (pages_.find(pgid) != pages_.end()) {
-    return pages_[pgid];
+namespace {
+
+// Number of bytes WriteTo() copies at a time.
+constexpr std::size_t kCopyChunkSize = 1 << 20;
+
+// O_DIRECT needs buffers aligned to the logical block size of the device.
+constexpr std::size_t kDirectIOAlignment = 4096;
+
+// Write all of `size` bytes to `fd`, retrying short writes.
+Status write_fd(int fd, const Byte* data, std::size_t size) {
+  while (size > 0) {
+    ssize_t n = ::write(fd, data, size);
+
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+
+    if (n == -1) {
+      return {kStatusErr, format("write: %s", strerror(errno))};
+    }
+
+    data += n;
+    size -= n;
+  }
+
+  return {};
+}
+
+// Sleep until copying `bytes` since `start` stays within `rate` MB/s.
+void throttle(std::chrono::steady_clock::time_point start, i64 bytes, int rate) {
+  if (rate <= 0) {
+    return;
+  }
+
+  Duration elapsed(static_cast<f64>(bytes) / (rate * 1024.0 * 1024.0));
+  std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(elapsed));
+}
+
+}  // namespace
+
+Page Txn::page(PageID pgid) {
+  if (auto iter = pages_.find(pgid); iter != pages_.end()) {
+    return *iter->second;
   }
 
   // Otherwise return directly from the mmap.
   return db_->page(pgid);
 }
 
-Status Txn::allocate(int count, Page*& out_page) {}
+Status Txn::commit() {
+  if (db_ == nullptr) {
+    return {kStatusErr, "tx closed"};
+  }
+
+  if (!writable_) {
+    return {kStatusErr, "tx not writable"};
+  }
+
+  auto commit_start = std::chrono::steady_clock::now();
+  BOLTDB_PROBE(txn__commit__start, meta_.txid, pages_.size());
+
+  // Merge the nodes left underfilled by deletes, then write the changed nodes
+  // to dirty pages. The root of the tree may move.
+  if (bucket_ != nullptr) {
+    bucket_->rebalance();
+
+    if (Status status = bucket_->spill(); !status.ok()) {
+      rollback();
+      return status;
+    }
+
+    meta_.root.root = bucket_->root();
+  }
+
+  // Free the freelist and allocate new pages for it. This will overestimate
+  // the size of the freelist but not underestimate the size (which would be
+  // bad).
+  free(meta_.freelist);
+
+  // Drop the free pages at the end of the file, so that the file can be
+  // truncated once this transaction is durable.
+  i64 shrink_threshold = db_->options_.shrink_threshold();
+  bool trimmed = false;
+
+  if (shrink_threshold > 0) {
+    PageID pgid = db_->freelist.trim(meta_.pgid, static_cast<int>(shrink_threshold / page_size()));
+    trimmed = pgid < meta_.pgid;
+    meta_.pgid = pgid;
+  }
+
+  Page* page;
+  int count = (db_->freelist.byte_size() / page_size()) + 1;
+
+  if (Status status = allocate(count, page); !status.ok()) {
+    rollback();
+    return status;
+  }
+
+  if (Status status = db_->freelist.write_to(*page); !status.ok()) {
+    rollback();
+    return status;
+  }
+
+  meta_.freelist = page->id();
+
+  // If the high water mark has moved up then attempt to grow the database.
+  if (Status status = db_->grow((meta_.pgid + 1) * page_size()); !status.ok()) {
+    rollback();
+    return status;
+  }
+
+  // Write dirty pages to disk.
+  auto start = std::chrono::steady_clock::now();
+
+  // A single sync commit writes the pages and the meta and syncs them
+  // together. The meta lists the pages, which have to fit in its page.
+  single_sync_ = db_->wal_ == nullptr && db_->options_.is_single_sync_commit() &&
+                 written_runs().size() <= CommitRecord::capacity(page_size());
+
+  if (Wal* wal = db_->wal_.get(); wal != nullptr) {
+    // Append the pages and the meta to the log, which is the only sync. They
+    // go to the data file once the log is durable.
+    meta_.checksum = meta_.sum64();
+
+    std::vector<Wal::Pages> pages;
+
+    for (auto&& [pgid, page] : pages_) {
+      pages.push_back({pgid, page->overflow() + 1, page->data()});
+    }
+
+    for (auto&& [first, last] : appended_) {
+      pages.push_back({first, last - first, db_->page(first).data()});
+    }
+
+    Status status = wal->append(meta_, pages, page_size(), [this]() -> Status {
+      if (Status status = write(); !status.ok()) {
+        return status;
+      }
+
+      return write_meta();
+    });
+
+    if (!status.ok()) {
+      rollback();
+      return status;
+    }
+  } else {
+    if (Status status = write(); !status.ok()) {
+      rollback();
+      return status;
+    }
+
+    // Write meta to disk.
+    if (Status status = write_meta(); !status.ok()) {
+      rollback();
+      return status;
+    }
+  }
+
+  stats.write_time += std::chrono::steady_clock::now() - start;
+
+  // The lower high water mark is durable now. The transaction has committed,
+  // so failing to truncate only leaves the file larger than it needs to be.
+  if (trimmed || db_->shrink_pending_) {
+    db_->shrink(meta_.pgid * page_size() + shrink_threshold / 2);
+  }
+
+  auto commit_time = std::chrono::steady_clock::now() - commit_start;
+  db_->record_latency(Latency::kCommit, commit_time);
+  BOLTDB_PROBE(txn__commit__done, meta_.txid, std::chrono::nanoseconds(commit_time).count());
+
+  // Finalize the transaction.
+  close();
+
+  return {};
+}
+
+Status Txn::rollback() {
+  if (db_ == nullptr) {
+    return {kStatusErr, "tx closed"};
+  }
+
+  BOLTDB_PROBE(txn__rollback, meta_.txid, writable_);
+
+  if (writable_) {
+    db_->freelist.rollback(meta_.txid);
+
+    // Pages handed out by the freelist in this transaction have to go back.
+    Page page = db_->page(db_->meta().freelist);
+    db_->freelist.reload(page);
+  }
+
+  close();
+
+  return {};
+}
+
+Status Txn::set_root(const BucketMeta& root) {
+  if (db_ == nullptr) {
+    return {kStatusErr, "tx closed"};
+  }
+
+  if (!writable_) {
+    return {kStatusErr, "tx not writable"};
+  }
+
+  close_root_bucket();
+  free_tree(meta_.root.root);
+  meta_.root = root;
+
+  return {};
+}
+
+Bucket* Txn::root_bucket() {
+  if (bucket_ == nullptr) {
+    void* memory = arena_.allocate(sizeof(Bucket), alignof(Bucket));
+    bucket_ = new (memory) Bucket(this, meta_.root);
+  }
+
+  return bucket_;
+}
+
+i64 Txn::size() const { return static_cast<i64>(meta_.pgid) * page_size(); }
+
+Status Txn::write_to(std::ostream& out, i64& out_written) { return copy_to(-1, &out, out_written); }
+
+Status Txn::write_to(int fd, i64& out_written) { return copy_to(fd, nullptr, out_written); }
+
+Status Txn::copy_file(const std::string& path, int mode) {
+  if (db_ == nullptr) {
+    return {kStatusErr, "tx closed"};
+  }
+
+  auto file = FileSystem::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+
+  if (file == nullptr) {
+    return {kStatusErr, format("open %s: %s", path.c_str(), strerror(errno))};
+  }
+
+  i64 written;
+
+  if (Status status = write_to(file->fd(), written); !status.ok()) {
+    return status;
+  }
+
+  return file->fsync();
+}
+
+int Txn::page_size() const { return db_->page_size(); }
+
+void Txn::free(PageID pgid) { db_->free(meta_.txid, page(pgid)); }
+
+Status Txn::allocate(int count, Page*& out_page) {
+  if (Status status = db_->allocate(count, out_page); !status.ok()) {
+    return status;
+  }
+
+  // Save to our page cache.
+  pages_[out_page->id()] = out_page;
+
+  // Update statistics.
+  stats.page_count += count;
+  stats.page_alloc += count * page_size();
+
+  return {};
+}
+
+Status Txn::write() {
+  auto start = std::chrono::steady_clock::now();
+
+  // Record the pages in the page txid map and make it durable before writing
+  // them, so that the map never claims a page is older than it is.
+  if (PageTxids* txids = db_->page_txids_.get(); txids != nullptr) {
+    for (auto&& [pgid, page] : pages_) {
+      txids->record(pgid, page->overflow() + 1, meta_.txid);
+    }
+
+    for (auto&& [first, last] : appended_) {
+      txids->record(first, static_cast<int>(last - first), meta_.txid);
+    }
+
+    if (Status status = txids->sync(meta_.txid, !db_->options_.is_no_sync()); !status.ok()) {
+      return status;
+    }
+  }
+
+  // Write pages to disk in order.
+  std::vector<std::pair<PageID, Page*>> pages(pages_.begin(), pages_.end());
+  std::sort(pages.begin(), pages.end());
+
+  try {
+    for (auto&& [pgid, page] : pages) {
+      std::size_t size = (page->overflow() + 1) * page_size();
+      std::size_t offset = pgid * page_size();
+
+      if (ssize_t n = db_->file_handle_->write(page->data(), size, offset); n != static_cast<ssize_t>(size)) {
+        return {kStatusErr, format("write: expect written %zu bytes, got %zd bytes", size, n)};
+      }
+
+      // Update statistics.
+      stats.write++;
+      stats.write_bytes += static_cast<i64>(size);
+    }
+  } catch (const IOException& e) {
+    return {kStatusErr, e.what()};
+  }
+
+  // Ignore file sync if flag is set on DB. With a write-ahead log the data
+  // file is synced by checkpoints, with a single sync commit it's synced
+  // along with the meta.
+  if (!db_->options_.is_no_sync() && db_->wal_ == nullptr && !single_sync_) {
+    if (Status status = db_->sync(false); !status.ok()) {
+      return status;
+    }
+  }
+
+  db_->record_latency(Latency::kWrite, std::chrono::steady_clock::now() - start);
+
+  return {};
+}
+
+Status Txn::write_meta() {
+  auto start = std::chrono::steady_clock::now();
+
+  // The meta pages alternate between page 0 and 1, so a torn meta write never
+  // destroys the previous valid meta.
+  Page page(meta_.txid % 2, PageFlag::kMeta, page_size());
+  meta_.flags &= ~Meta::kFlagCommitRecord;
+
+  if (single_sync_) {
+    meta_.flags |= Meta::kFlagCommitRecord;
+  }
+
+  meta_.checksum = meta_.sum64();
+  *page.meta() = meta_;
+
+  if (single_sync_) {
+    write_commit_record(page);
+  }
+
+  try {
+    ssize_t n = db_->file_handle_->write(page.data(), page_size(), page.id() * page_size());
+
+    if (n != page_size()) {
+      return {kStatusErr, format("write: expect written %d bytes, got %zd bytes", page_size(), n)};
+    }
+  } catch (const IOException& e) {
+    return {kStatusErr, e.what()};
+  }
+
+  // The slot of a meta that was found incomplete on open holds a valid meta
+  // again.
+  db_->torn_meta_.store(-1, std::memory_order_release);
+
+  if (!db_->options_.is_no_sync() && db_->wal_ == nullptr) {
+    if (Status status = db_->sync(false); !status.ok()) {
+      return status;
+    }
+  }
+
+  // Update statistics.
+  stats.write++;
+  stats.write_bytes += page_size();
+  db_->record_latency(Latency::kWriteMeta, std::chrono::steady_clock::now() - start);
+
+  return {};
+}
+
+std::vector<PageRun> Txn::written_runs() const {
+  std::vector<PageRun> runs;
+
+  for (auto&& [pgid, page] : pages_) {
+    runs.push_back({pgid, page->overflow() + 1ULL});
+  }
+
+  for (auto&& [first, last] : appended_) {
+    runs.push_back({first, last - first});
+  }
+
+  std::sort(runs.begin(), runs.end(), [](const PageRun& a, const PageRun& b) { return a.pgid < b.pgid; });
+
+  // Merge the runs that touch.
+  std::size_t n = 0;
+
+  for (std::size_t i = 0; i < runs.size(); i++) {
+    if (n > 0 && runs[n - 1].pgid + runs[n - 1].count == runs[i].pgid) {
+      runs[n - 1].count += runs[i].count;
+    } else {
+      runs[n++] = runs[i];
+    }
+  }
+
+  runs.resize(n);
+
+  return runs;
+}
+
+void Txn::write_commit_record(Page& meta_page) const {
+  std::vector<PageRun> runs = written_runs();
+  CommitRecord* record = meta_page.meta()->commit_record();
+  record->count = static_cast<u32>(runs.size());
+  std::copy(runs.begin(), runs.end(), record->runs());
+
+  // Checksum the pages in the order they are laid out in the file, which is
+  // how opening the database reads them back.
+  u64 crc = crc64_be(0, reinterpret_cast<const Byte*>(record->runs()), runs.size() * sizeof(PageRun));
+
+  for (auto&& run : runs) {
+    for (PageID pgid = run.pgid; pgid < run.pgid + run.count;) {
+      if (auto iter = pages_.find(pgid); iter != pages_.end()) {
+        std::size_t count = iter->second->overflow() + 1;
+        crc = crc64_be(crc, iter->second->data(), count * page_size());
+        pgid += count;
+      } else {
+        // Pages appended by a bulk loader, already in the mmap.
+        crc = crc64_be(crc, db_->page(pgid).data(), page_size());
+        pgid++;
+      }
+    }
+  }
+
+  record->checksum = crc;
+}
+
+Status Txn::copy_to(int fd, std::ostream* out, i64& out_written) {
+  if (db_ == nullptr) {
+    return {kStatusErr, "tx closed"};
+  }
+
+  out_written = 0;
+
+  // Read the data pages through a separate handle so they can be read with
+  // `write_flag`, e.g. O_DIRECT to bypass the page cache.
+  auto file = FileSystem::open(db_->path().c_str(), O_RDONLY | write_flag, 0);
+
+  if (file == nullptr) {
+    return {kStatusErr, format("open %s: %s", db_->path().c_str(), strerror(errno))};
+  }
+
+  std::unique_ptr<Byte, decltype(&std::free)> buffer(
+      static_cast<Byte*>(std::aligned_alloc(kDirectIOAlignment, kCopyChunkSize)), &std::free);
+  auto sink = [&](const Byte* data, std::size_t size) -> Status {
+    if (out == nullptr) {
+      return write_fd(fd, data, size);
+    }
+
+    if (!out->write(data, static_cast<std::streamsize>(size))) {
+      return {kStatusErr, "write_to: stream write failed"};
+    }
+
+    return {};
+  };
+
+  // Generate both meta pages from the transaction's meta. Meta 1 gets a
+  // lower transaction id so that meta 0 is the one picked on open.
+  for (PageID pgid : {0, 1}) {
+    Page page(pgid, PageFlag::kMeta, page_size());
+    Meta* meta = page.meta();
+    *meta = meta_;
+    meta->txid -= pgid;
+    // The commit record isn't copied along with the meta.
+    meta->flags &= ~Meta::kFlagCommitRecord;
+    meta->checksum = meta->sum64();
+
+    if (Status status = sink(page.data(), page_size()); !status.ok()) {
+      return status;
+    }
+  }
+
+  out_written = 2 * page_size();
+
+  // Copy the data pages. copy_file_range() doesn't go through `write_flag`,
+  // so it is only used when no flag is set.
+  std::size_t offset = 2 * page_size();
+  std::size_t end = size();
+  bool copy_range = out == nullptr && write_flag == 0;
+  auto start = std::chrono::steady_clock::now();
+
+  // O_DIRECT reads must start and end on the logical block size, which pages
+  // smaller than it don't. Read from the start of the block that holds the
+  // first data page, and drop the bytes before it and past the end.
+  bool direct = (write_flag & O_DIRECT) != 0;
+  std::size_t skip = direct ? offset % kDirectIOAlignment : 0;
+  offset -= skip;
+
+  while (offset < end) {
+    std::size_t size = std::min(kCopyChunkSize, end - offset);
+    ssize_t n;
+
+    if (copy_range) {
+      loff_t off_in = static_cast<loff_t>(offset);
+      n = ::copy_file_range(file->fd(), &off_in, fd, nullptr, size, 0);
+
+      // Fall back to reading and writing when the kernel or the file systems
+      // can't copy between the two files.
+      if (n == -1 && (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)) {
+        copy_range = false;
+        continue;
+      }
+
+      if (n == -1) {
+        return {kStatusErr, format("copy_file_range: %s", strerror(errno))};
+      }
+    } else {
+      std::size_t read_size = direct ? (size + kDirectIOAlignment - 1) / kDirectIOAlignment * kDirectIOAlignment : size;
+
+      try {
+        n = file->read(buffer.get(), read_size, offset);
+      } catch (const IOException& e) {
+        return {kStatusErr, e.what()};
+      }
+
+      n = std::min(n, static_cast<ssize_t>(size));
+
+      if (n > static_cast<ssize_t>(skip)) {
+        if (Status status = sink(buffer.get() + skip, n - skip); !status.ok()) {
+          return status;
+        }
+      }
+    }
+
+    if (n <= static_cast<ssize_t>(skip)) {
+      return {kStatusErr, format("write_to: unexpected end of file at offset %zu", offset)};
+    }
+
+    offset += n;
+    out_written += n - static_cast<ssize_t>(skip);
+    skip = 0;
+    throttle(start, out_written - 2 * page_size(), write_rate_limit);
+  }
+
+  return {};
+}
+
+void Txn::free_tree(PageID pgid) {
+  Page p = page(pgid);
+
+  if ((p.flag() & PageFlag::kBranch) != 0) {
+    for (auto&& element : p.branch_page_elements()) {
+      free_tree(element.pgid);
+    }
+  } else if ((p.flag() & PageFlag::kLeaf) != 0) {
+    for (auto&& element : p.leaf_page_elements()) {
+      if ((element.flags & LeafFlag::kBucket) == 0) {
+        continue;
+      }
+
+      // Inline buckets have no pages of their own.
+      BucketMeta bucket;
+      std::memcpy(&bucket, element.value_view().data(), sizeof(bucket));
+
+      if (bucket.root != 0) {
+        free_tree(bucket.root);
+      }
+    }
+  }
+
+  free(pgid);
+}
+
+void Txn::close_root_bucket() {
+  // The arena only releases the memory when the transaction goes away.
+  if (bucket_ != nullptr) {
+    bucket_->~Bucket();
+    bucket_ = nullptr;
+  }
+}
+
+void Txn::close() {
+  db_->record_stats(*this);
+
+  if (writable_) {
+    // Size the page cache of the next writer after this one.
+    db_->dirty_pages_hint_ = pages_.size();
+    db_->rwtx_ = nullptr;
+    db_->rwlock_.unlock();
+  } else {
+    db_->remove_txn(this);
+  }
+
+  // Clear all references. The nodes of the buckets may point into the pages.
+  close_root_bucket();
+
+  for (auto&& [_, page] : pages_) {
+    delete page;
+  }
+
+  db_ = nullptr;
+  pages_.clear();
+  appended_.clear();
+}
 
-}  // namespace boltdb
\ No newline at end of file
+}  // namespace boltdb
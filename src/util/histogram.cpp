@@ -0,0 +1,49 @@
+#include "boltdb/util/histogram.hpp"
+
+#include <cmath>
+#include <numeric>
+
+namespace boltdb {
+
+static Duration from_nanos(i64 nanos) { return Duration(static_cast<f64>(nanos) / 1e9); }
+
+HistogramSnapshot::HistogramSnapshot(const Counts& counts, i64 sum_nanos)
+    : counts_(counts), count_(std::accumulate(counts.begin(), counts.end(), i64{})), sum_nanos_(sum_nanos) {}
+
+Duration HistogramSnapshot::mean() const {
+  if (count_ == 0) {
+    return {};
+  }
+
+  return from_nanos(sum_nanos_ / count_);
+}
+
+Duration HistogramSnapshot::percentile(f64 percentile) const {
+  if (count_ == 0) {
+    return {};
+  }
+
+  // The rank of the duration, counting from 1.
+  i64 rank = std::clamp<i64>(static_cast<i64>(std::ceil(percentile / 100 * count_)), 1, count_);
+  i64 seen = 0;
+
+  for (int i = 0; i < kBuckets; i++) {
+    seen += counts_[i];
+
+    if (seen >= rank) {
+      return from_nanos(bucket_upper_bound(i));
+    }
+  }
+
+  return from_nanos(bucket_upper_bound(kBuckets - 1));
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+  auto values = counts_.sum();
+  HistogramSnapshot::Counts counts;
+  std::copy_n(values.begin(), HistogramSnapshot::kBuckets, counts.begin());
+
+  return {counts, values[HistogramSnapshot::kBuckets]};
+}
+
+}  // namespace boltdb
@@ -0,0 +1,141 @@
+#include "boltdb/util/memory_map.hpp"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "boltdb/util/util.hpp"
+
+namespace boltdb {
+
+MemoryMap::~MemoryMap() { unmap(); }
+
+Status MemoryMap::map(int fd, std::size_t size, std::size_t reserve_size, int flags) {
+  if (Status status = unmap(); !status.ok()) {
+    return status;
+  }
+
+  reserve_size = std::max(reserve_size, size);
+  Byte* base = reserve(reserve_size);
+
+  if (base == nullptr) {
+    return {kStatusErr, format("mmap reserve %zu bytes: %s", reserve_size, strerror(errno))};
+  }
+
+  fd_ = fd;
+  flags_ = flags;
+  reserved_ = reserve_size;
+
+  if (Status status = map_range(base, 0, size); !status.ok()) {
+    ::munmap(base, reserve_size);
+    reserved_ = 0;
+
+    return status;
+  }
+
+  size_.store(size, std::memory_order_release);
+  data_.store(base, std::memory_order_release);
+
+  return {};
+}
+
+Status MemoryMap::grow(std::size_t size) {
+  Byte* base = data();
+  std::size_t old_size = this->size();
+
+  if (base == nullptr) {
+    return {kStatusErr, "mmap: grow before map"};
+  }
+
+  if (size <= old_size) {
+    return {};
+  }
+
+  // Common case: the new size still fits in the reservation. Map the tail of
+  // the file right after the current mapping, the base doesn't move.
+  if (size <= reserved_) {
+    if (Status status = map_range(base, old_size, size - old_size); !status.ok()) {
+      return status;
+    }
+
+    size_.store(size, std::memory_order_release);
+
+    return {};
+  }
+
+  // Out of reserved address space. Reserve a larger range and map the whole
+  // file there. The old range stays mapped for readers still using it.
+  std::size_t reserve_size = std::max(reserved_ * 2, size);
+  Byte* new_base = reserve(reserve_size);
+
+  if (new_base == nullptr) {
+    return {kStatusErr, format("mmap reserve %zu bytes: %s", reserve_size, strerror(errno))};
+  }
+
+  if (Status status = map_range(new_base, 0, size); !status.ok()) {
+    ::munmap(new_base, reserve_size);
+
+    return status;
+  }
+
+  retired_.push_back(Region{base, reserved_});
+  reserved_ = reserve_size;
+  size_.store(size, std::memory_order_release);
+  data_.store(new_base, std::memory_order_release);
+
+  return {};
+}
+
+Status MemoryMap::unmap() {
+  Status result;
+
+  retired_.push_back(Region{data(), reserved_});
+
+  for (auto&& region : retired_) {
+    if (region.base != nullptr && ::munmap(region.base, region.reserved) != 0) {
+      result = {kStatusErr, format("munmap: %s", strerror(errno))};
+    }
+  }
+
+  retired_.clear();
+  data_.store(nullptr, std::memory_order_release);
+  size_.store(0, std::memory_order_release);
+  reserved_ = 0;
+  fd_ = -1;
+
+  return result;
+}
+
+Byte* MemoryMap::reserve(std::size_t reserve_size) {
+  void* p = ::mmap(nullptr, reserve_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+  if (p == MAP_FAILED) {
+    return nullptr;
+  }
+
+  return static_cast<Byte*>(p);
+}
+
+Status MemoryMap::map_range(Byte* base, std::size_t offset, std::size_t length) const {
+  if (length == 0) {
+    return {};
+  }
+
+  void* p = ::mmap(base + offset, length, PROT_READ, MAP_SHARED | MAP_FIXED | flags_, fd_, static_cast<off_t>(offset));
+
+  if (p == MAP_FAILED) {
+    return {kStatusErr, format("mmap: %s", strerror(errno))};
+  }
+
+  // Advise the kernel that the mmap is accessed randomly.
+  if (::madvise(p, length, MADV_RANDOM) != 0) {
+    return {kStatusErr, format("madvise: %s", strerror(errno))};
+  }
+
+  return {};
+}
+
+}  // namespace boltdb
@@ -62,6 +62,19 @@ ByteSlice& ByteSlice::append(Byte v) {
   return *this;
 }
 
+ByteSlice& ByteSlice::append(const Byte* data, std::size_t n) {
+  if (static_cast<std::size_t>(std::distance(tail_, cap_)) < n) {
+    grow(std::max(cap() * 2, size() + n));
+  }
+
+  if (n > 0) {
+    memcpy(tail_, data, n);
+    tail_ = std::next(tail_, static_cast<DiffType>(n));
+  }
+
+  return *this;
+}
+
 void ByteSlice::reserve(std::size_t sz) {
   auto old_cap = cap();
 
@@ -0,0 +1,129 @@
+#include "boltdb/util/thread_pool.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <latch>
+
+namespace boltdb {
+
+ThreadPool::ThreadPool(int num_threads) {
+  num_threads = std::max(num_threads, 1);
+
+  for (int i = 0; i < num_threads; i++) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+
+  for (int i = 0; i < num_threads; i++) {
+    threads_.emplace_back([this, i] { worker(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+
+  cv_.notify_all();
+
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::submit(Task task) {
+  auto& queue = *queues_[next_.fetch_add(1, std::memory_order_relaxed) % queues_.size()];
+
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  cv_.notify_one();
+}
+
+void ThreadPool::parallel_for(int n, const std::function<void(int)>& fn) {
+  if (n <= 0) {
+    return;
+  }
+
+  std::latch done(n);
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  for (int i = 0; i < n; i++) {
+    submit([&, i] {
+      try {
+        fn(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+
+      done.count_down();
+    });
+  }
+
+  done.wait();
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void ThreadPool::worker(int index) {
+  while (true) {
+    Task task;
+
+    if (pop(index, task)) {
+      task();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return stop_ || pending_.load(std::memory_order_relaxed) > 0; });
+
+    if (stop_ && pending_.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+  }
+}
+
+bool ThreadPool::pop(int index, Task& task) {
+  int n = static_cast<int>(queues_.size());
+
+  // Take from the front of our own queue first, then steal from the back of
+  // the others.
+  for (int i = 0; i < n; i++) {
+    auto& queue = *queues_[(index + i) % n];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.tasks.empty()) {
+      continue;
+    }
+
+    if (i == 0) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    } else {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+
+    pending_.fetch_sub(1, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  return false;
+}
+
+}  // namespace boltdb
@@ -0,0 +1,237 @@
+#include "boltdb/db/bucket.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "boltdb/db/bulk_loader.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/page/node.hpp"
+#include "boltdb/util/options.hpp"
+#include "boltdb/util/util.hpp"
+
+using namespace boltdb;
+using namespace std;
+
+// Count the allocations made by this test.
+static thread_local int allocations = 0;
+
+void* operator new(std::size_t size) {
+  allocations++;
+
+  if (void* p = std::malloc(size)) {
+    return p;
+  }
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+static span<const Byte> bytes(const string& s) { return {s.data(), s.size()}; }
+
+static string encode(const BucketMeta& meta) { return string(reinterpret_cast<const char*>(&meta), sizeof(meta)); }
+
+// Build a tenant -> collection -> shard hierarchy with bulk loaders.
+class BucketTest : public ::testing::Test {
+ protected:
+  static constexpr int kTenants = 3;
+  static constexpr int kCollections = 500;
+
+  void SetUp() override {
+    ASSERT_TRUE(open_memory_db("bucket_test", Options{}, &db).ok());
+    ASSERT_TRUE(db->begin(true, txn).ok());
+
+    vector<pair<string, string>> root_items;
+
+    for (int t = 0; t < kTenants; t++) {
+      vector<pair<string, string>> collections;
+
+      for (int c = 0; c < kCollections; c++) {
+        BucketMeta shards = load({{"shard0", "a"}, {"shard1", "b"}}, 0);
+        collections.emplace_back(format("collection%04d", c), encode(shards));
+        shard_roots.push_back(shards.root);
+      }
+
+      root_items.emplace_back(format("tenant%d", t), encode(load(collections, LeafFlag::kBucket)));
+    }
+
+    BulkLoader loader(txn);
+
+    for (auto&& [key, value] : root_items) {
+      ASSERT_TRUE(loader.add(bytes(key), bytes(value), LeafFlag::kBucket).ok());
+    }
+
+    // An inline bucket holding an empty leaf, and a plain value.
+    string inline_value = encode(BucketMeta{});
+    inline_value.resize(inline_value.size() + kPageHeaderSize);
+    reinterpret_cast<PageHeader*>(inline_value.data() + sizeof(BucketMeta))->flag = PageFlag::kLeaf;
+    ASSERT_TRUE(loader.add(bytes("z-inline"), bytes(inline_value), LeafFlag::kBucket).ok());
+    ASSERT_TRUE(loader.add(bytes("z-plain"), bytes("value")).ok());
+
+    ASSERT_TRUE(loader.finish(root).ok());
+  }
+
+  void TearDown() override {
+    txn->rollback();
+    delete txn;
+    delete db;
+  }
+
+  // Load a tree of `items`, whose elements all have `flags`.
+  BucketMeta load(const vector<pair<string, string>>& items, u32 flags) {
+    BulkLoader loader(txn);
+    BucketMeta meta{};
+
+    for (auto&& [key, value] : items) {
+      EXPECT_TRUE(loader.add(bytes(key), bytes(value), flags).ok());
+    }
+
+    EXPECT_TRUE(loader.finish(meta).ok());
+
+    return meta;
+  }
+
+  DB* db;
+  Txn* txn;
+  BucketMeta root{};
+  vector<PageID> shard_roots;
+};
+
+TEST_F(BucketTest, NestedLookup) {
+  Bucket bucket(txn, root);
+
+  for (int t = 0; t < kTenants; t++) {
+    Bucket* tenant = bucket.bucket(bytes(format("tenant%d", t)));
+    ASSERT_NE(nullptr, tenant);
+
+    for (int c = 0; c < kCollections; c += 7) {
+      Bucket* collection = tenant->bucket(bytes(format("collection%04d", c)));
+      ASSERT_NE(nullptr, collection);
+      EXPECT_EQ(shard_roots[t * kCollections + c], collection->root());
+    }
+  }
+
+  EXPECT_EQ(nullptr, bucket.bucket(bytes("tenant9")));
+  EXPECT_EQ(nullptr, bucket.bucket(bytes("a")));
+  EXPECT_EQ(nullptr, bucket.bucket(bytes("z-plain")));
+
+  Bucket* inline_bucket = bucket.bucket(bytes("z-inline"));
+  ASSERT_NE(nullptr, inline_bucket);
+  EXPECT_EQ(0, inline_bucket->root());
+  EXPECT_EQ(nullptr, inline_bucket->bucket(bytes("x")));
+}
+
+TEST_F(BucketTest, CachedLookupDoesNotAllocate) {
+  Bucket bucket(txn, root);
+  string tenant_name = "tenant2";
+  string collection_name = "collection0123";
+
+  Bucket* tenant = bucket.bucket(bytes(tenant_name));
+  ASSERT_NE(nullptr, tenant);
+  Bucket* collection = tenant->bucket(bytes(collection_name));
+  ASSERT_NE(nullptr, collection);
+
+  int before = allocations;
+
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(collection, bucket.bucket(bytes(tenant_name))->bucket(bytes(collection_name)));
+  }
+
+  EXPECT_EQ(before, allocations);
+}
+
+TEST_F(BucketTest, LookupThroughNodes) {
+  Bucket bucket(txn, root);
+  Node* node;
+
+  // Materialize the root, later lookups go through the node.
+  bucket.node(root.root, nullptr, node);
+
+  Bucket* tenant = bucket.bucket(bytes("tenant1"));
+  ASSERT_NE(nullptr, tenant);
+
+  // And through materialized branch and leaf nodes of the tenant.
+  tenant->node(tenant->root(), nullptr, node);
+  ASSERT_FALSE(node->is_leaf());
+  node->child_at(node->num_children() - 1);
+
+  Bucket* collection = tenant->bucket(bytes(format("collection%04d", kCollections - 1)));
+  ASSERT_NE(nullptr, collection);
+  EXPECT_EQ(shard_roots[2 * kCollections - 1], collection->root());
+  EXPECT_EQ(nullptr, tenant->bucket(bytes("collection")));
+}
+
+TEST_F(BucketTest, LookupBeforeFirstBranchKey) {
+  Bucket bucket(txn, root);
+  Bucket* tenant = bucket.bucket(bytes("tenant0"));
+  ASSERT_NE(nullptr, tenant);
+
+  Node* node;
+  tenant->node(tenant->root(), nullptr, node);
+  ASSERT_FALSE(node->is_leaf());
+
+  // Keys that sort before the first key of the branch are put into its first
+  // child, and must be found there.
+  Node* leaf = node->child_at(0);
+  ASSERT_TRUE(leaf->is_leaf());
+
+  string inline_value = encode(BucketMeta{});
+  inline_value.resize(inline_value.size() + kPageHeaderSize);
+  reinterpret_cast<PageHeader*>(inline_value.data() + sizeof(BucketMeta))->flag = PageFlag::kLeaf;
+
+  leaf->put(ByteSlice("a-bucket"), ByteSlice("a-bucket"), ByteSlice(inline_value), 0, LeafFlag::kBucket);
+  leaf->put(ByteSlice("a-plain"), ByteSlice("a-plain"), ByteSlice("value"), 0, 0);
+
+  span<const Byte> value = tenant->get(bytes("a-plain"));
+  EXPECT_EQ("value", string(value.data(), value.size()));
+  EXPECT_NE(nullptr, tenant->bucket(bytes("a-bucket")));
+  EXPECT_EQ(nullptr, tenant->bucket(bytes("a-missing")));
+}
+
+TEST_F(BucketTest, CommitWritesNestedBuckets) {
+  ASSERT_TRUE(txn->set_root(root).ok());
+
+  // Change a collection and the inline bucket through their nodes.
+  Bucket* collection = txn->root_bucket()->bucket(bytes("tenant1"))->bucket(bytes("collection0042"));
+  ASSERT_NE(nullptr, collection);
+  Node* node;
+  collection->node(collection->root(), nullptr, node);
+  node->put(ByteSlice("shard2"), ByteSlice("shard2"), ByteSlice("c"), 0, 0);
+
+  Bucket* inline_bucket = txn->root_bucket()->bucket(bytes("z-inline"));
+  ASSERT_NE(nullptr, inline_bucket);
+  inline_bucket->node(0, nullptr, node);
+  node->put(ByteSlice("x"), ByteSlice("x"), ByteSlice("y"), 0, 0);
+
+  ASSERT_TRUE(txn->commit().ok());
+  delete txn;
+
+  ASSERT_TRUE(db->begin(false, txn).ok());
+  Bucket bucket(txn, txn->root());
+  auto as_string = [](span<const Byte> value) { return string(value.data(), value.size()); };
+
+  collection = bucket.bucket(bytes("tenant1"))->bucket(bytes("collection0042"));
+  ASSERT_NE(nullptr, collection);
+  EXPECT_EQ("a", as_string(collection->get(bytes("shard0"))));
+  EXPECT_EQ("c", as_string(collection->get(bytes("shard2"))));
+
+  // The other buckets kept their pages.
+  EXPECT_EQ(shard_roots[kCollections + 41], bucket.bucket(bytes("tenant1"))->bucket(bytes("collection0041"))->root());
+
+  inline_bucket = bucket.bucket(bytes("z-inline"));
+  ASSERT_NE(nullptr, inline_bucket);
+  EXPECT_NE(0, inline_bucket->root());
+  EXPECT_EQ("y", as_string(inline_bucket->get(bytes("x"))));
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
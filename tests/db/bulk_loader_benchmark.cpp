@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boltdb/db/bucket.hpp"
+#include "boltdb/db/bulk_loader.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/page/node.hpp"
+#include "boltdb/util/options.hpp"
+#include "boltdb/util/util.hpp"
+
+using namespace std;
+using namespace boltdb;
+
+static vector<pair<ByteSlice, ByteSlice>> make_items(int n) {
+  vector<pair<ByteSlice, ByteSlice>> items;
+  items.reserve(n);
+
+  for (int i = 0; i < n; i++) {
+    items.emplace_back(ByteSlice(format("key%016d", i)), ByteSlice(format("value%058d", i)));
+  }
+
+  return items;
+}
+
+// Load sorted keys with the bulk loader and commit.
+static void BM_bulk_load(benchmark::State& state) {
+  auto items = make_items(static_cast<int>(state.range(0)));
+  string path = "/tmp/bulk_load_benchmark.db";
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::remove(path.c_str());
+
+    DB* db;
+    Txn* txn;
+    open_db(path, Options{}, &db);
+    db->begin(true, txn);
+    state.ResumeTiming();
+
+    BulkLoader loader(txn);
+    BucketMeta bucket{};
+
+    for (auto&& [key, value] : items) {
+      loader.add(key.span(), value.span());
+    }
+
+    loader.finish(bucket);
+    txn->commit();
+
+    state.PauseTiming();
+    delete txn;
+    delete db;
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * state.range(0) * 96);
+  std::remove(path.c_str());
+}
+
+// Insert the same keys into a node and commit, which splits the node into
+// half full pages.
+static void BM_insert(benchmark::State& state) {
+  auto items = make_items(static_cast<int>(state.range(0)));
+  string path = "/tmp/insert_benchmark.db";
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::remove(path.c_str());
+
+    DB* db;
+    Txn* txn;
+    open_db(path, Options{}, &db);
+    db->begin(true, txn);
+    state.ResumeTiming();
+
+    {
+      Bucket bucket(txn);
+      Node root(0, &bucket, nullptr);
+      root.read(Page(0, PageFlag::kLeaf, db->page_size()));
+
+      for (auto&& [key, value] : items) {
+        root.put(key, key, value, 0, 0);
+      }
+
+      root.spill();
+      txn->commit();
+    }
+
+    state.PauseTiming();
+    delete txn;
+    delete db;
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * state.range(0) * 96);
+  std::remove(path.c_str());
+}
+
+BENCHMARK(BM_bulk_load)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_insert)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
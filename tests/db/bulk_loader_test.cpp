@@ -0,0 +1,258 @@
+#include "boltdb/db/bulk_loader.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../fs/test_util.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/util/options.hpp"
+#include "boltdb/util/util.hpp"
+
+using namespace boltdb;
+using namespace std;
+
+class BulkLoaderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::remove(path.c_str());
+
+    Status status = open_db(path, Options{}, &db);
+    ASSERT_TRUE(status.ok()) << status;
+    ASSERT_TRUE(db->begin(true, txn).ok());
+  }
+
+  void TearDown() override {
+    delete txn;
+    delete db;
+    std::remove(path.c_str());
+  }
+
+  // Collect the key/value pairs of the tree in order, along with the number
+  // of leaf pages.
+  void read_tree(PageID pgid, vector<pair<string, string>>& items, int& leaves) {
+    Page page = db->page(pgid);
+
+    if (page.flag() == PageFlag::kLeaf) {
+      leaves++;
+
+      for (auto&& element : page.leaf_page_elements()) {
+        items.emplace_back(element.key().to_string(), element.value().to_string());
+      }
+
+      return;
+    }
+
+    ASSERT_EQ(PageFlag::kBranch, page.flag());
+    ASSERT_GE(page.count(), kMinKeysPerPage);
+
+    for (auto&& element : page.branch_page_elements()) {
+      // The key of a child is its first key.
+      vector<pair<string, string>> child;
+      read_tree(element.pgid, child, leaves);
+
+      ASSERT_FALSE(child.empty());
+      EXPECT_EQ(element.key().to_string(), child.front().first);
+
+      items.insert(items.end(), child.begin(), child.end());
+    }
+  }
+
+  std::string path = "/tmp/bulk_loader.db";
+  DB* db;
+  Txn* txn;
+};
+
+TEST_F(BulkLoaderTest, Load) {
+  constexpr int kKeys = 100000;
+  BulkLoader loader(txn);
+
+  for (int i = 0; i < kKeys; i++) {
+    ASSERT_TRUE(loader.add(bytes(format("key%08d", i)), bytes(format("value%08d", i))).ok());
+  }
+
+  BucketMeta bucket{};
+  ASSERT_TRUE(loader.finish(bucket).ok());
+  EXPECT_EQ(kKeys, loader.count());
+  ASSERT_TRUE(txn->commit().ok());
+
+  // The pages are allocated right after the initial pages and the root is
+  // written last.
+  EXPECT_EQ(4 + loader.page_count() - 1, bucket.root);
+  EXPECT_GT(db->meta().pgid, bucket.root);
+
+  vector<pair<string, string>> items;
+  int leaves = 0;
+  read_tree(bucket.root, items, leaves);
+
+  ASSERT_EQ(kKeys, items.size());
+
+  for (int i = 0; i < kKeys; i++) {
+    EXPECT_EQ(format("key%08d", i), items[i].first);
+    EXPECT_EQ(format("value%08d", i), items[i].second);
+  }
+
+  // Leaves are packed full: 16 bytes of element header plus 24 bytes of data.
+  int per_leaf = (db->page_size() - kPageHeaderSize) / (kLeafPageElementSize + 24);
+  EXPECT_EQ((kKeys + per_leaf - 1) / per_leaf, leaves);
+}
+
+TEST_F(BulkLoaderTest, FillPercent) {
+  BulkLoader loader(txn, 0.5);
+
+  for (int i = 0; i < 10000; i++) {
+    ASSERT_TRUE(loader.add(bytes(format("key%08d", i)), bytes(format("value%08d", i))).ok());
+  }
+
+  BucketMeta bucket{};
+  ASSERT_TRUE(loader.finish(bucket).ok());
+  ASSERT_TRUE(txn->commit().ok());
+
+  vector<pair<string, string>> items;
+  int leaves = 0;
+  read_tree(bucket.root, items, leaves);
+
+  int per_leaf = (db->page_size() / 2 - kPageHeaderSize) / (kLeafPageElementSize + 24);
+  EXPECT_EQ(10000, items.size());
+  EXPECT_EQ((10000 + per_leaf - 1) / per_leaf, leaves);
+}
+
+TEST_F(BulkLoaderTest, Empty) {
+  BulkLoader loader(txn);
+  BucketMeta bucket{};
+
+  ASSERT_TRUE(loader.finish(bucket).ok());
+  ASSERT_TRUE(txn->commit().ok());
+
+  Page page = db->page(bucket.root);
+  EXPECT_EQ(PageFlag::kLeaf, page.flag());
+  EXPECT_EQ(0, page.count());
+}
+
+TEST_F(BulkLoaderTest, Overflow) {
+  BulkLoader loader(txn);
+  string large(3 * db->page_size(), 'x');
+
+  ASSERT_TRUE(loader.add(bytes("a"), bytes("small")).ok());
+  ASSERT_TRUE(loader.add(bytes("b"), bytes(large)).ok());
+  ASSERT_TRUE(loader.add(bytes("c"), bytes("small")).ok());
+
+  BucketMeta bucket{};
+  ASSERT_TRUE(loader.finish(bucket).ok());
+  ASSERT_TRUE(txn->commit().ok());
+
+  vector<pair<string, string>> items;
+  int leaves = 0;
+  read_tree(bucket.root, items, leaves);
+
+  ASSERT_EQ(3, items.size());
+  EXPECT_EQ(large, items[1].second);
+  EXPECT_GE(loader.page_count(), 4);
+}
+
+TEST_F(BulkLoaderTest, InterleavedAllocate) {
+  constexpr int kKeys = 20000;
+  BulkLoader loader(txn);
+  vector<PageID> pgids;
+
+  for (int i = 0; i < kKeys; i++) {
+    ASSERT_TRUE(loader.add(bytes(format("key%08d", i)), bytes(format("value%08d", i))).ok());
+
+    if (i % 1000 == 0) {
+      Page* page;
+      ASSERT_TRUE(txn->allocate(1, page).ok());
+      page->set_flag(PageFlag::kLeaf);
+      std::fill_n(page->skip_page_header(), 16, 'x');
+      pgids.push_back(page->id());
+    }
+  }
+
+  BucketMeta bucket{};
+  ASSERT_TRUE(loader.finish(bucket).ok());
+  ASSERT_TRUE(txn->commit().ok());
+
+  vector<pair<string, string>> items;
+  int leaves = 0;
+  read_tree(bucket.root, items, leaves);
+
+  ASSERT_EQ(kKeys, items.size());
+
+  for (int i = 0; i < kKeys; i++) {
+    EXPECT_EQ(format("key%08d", i), items[i].first);
+    EXPECT_EQ(format("value%08d", i), items[i].second);
+  }
+
+  // The pages allocated by the transaction are not overwritten by the tree.
+  for (PageID pgid : pgids) {
+    Page page = db->page(pgid);
+    EXPECT_EQ(PageFlag::kLeaf, page.flag());
+    EXPECT_EQ(string(16, 'x'), string(page.skip_page_header(), std::next(page.skip_page_header(), 16)));
+  }
+}
+
+TEST_F(BulkLoaderTest, TwoLoaders) {
+  constexpr int kKeys = 20000;
+  BulkLoader first(txn);
+  BulkLoader second(txn);
+
+  for (int i = 0; i < kKeys; i++) {
+    ASSERT_TRUE(first.add(bytes(format("a%08d", i)), bytes(format("first%08d", i))).ok());
+    ASSERT_TRUE(second.add(bytes(format("b%08d", i)), bytes(format("second%08d", i))).ok());
+  }
+
+  BucketMeta first_bucket{};
+  BucketMeta second_bucket{};
+  ASSERT_TRUE(first.finish(first_bucket).ok());
+  ASSERT_TRUE(second.finish(second_bucket).ok());
+  ASSERT_TRUE(txn->commit().ok());
+
+  vector<pair<string, string>> first_items;
+  vector<pair<string, string>> second_items;
+  int leaves = 0;
+  read_tree(first_bucket.root, first_items, leaves);
+  read_tree(second_bucket.root, second_items, leaves);
+
+  ASSERT_EQ(kKeys, first_items.size());
+  ASSERT_EQ(kKeys, second_items.size());
+
+  for (int i = 0; i < kKeys; i++) {
+    EXPECT_EQ(format("a%08d", i), first_items[i].first);
+    EXPECT_EQ(format("first%08d", i), first_items[i].second);
+    EXPECT_EQ(format("b%08d", i), second_items[i].first);
+    EXPECT_EQ(format("second%08d", i), second_items[i].second);
+  }
+}
+
+TEST_F(BulkLoaderTest, UnsortedKeys) {
+  BulkLoader loader(txn);
+
+  ASSERT_TRUE(loader.add(bytes("b"), bytes("1")).ok());
+  EXPECT_FALSE(loader.add(bytes("b"), bytes("2")).ok());
+  EXPECT_FALSE(loader.add(bytes("a"), bytes("3")).ok());
+  EXPECT_FALSE(loader.add(bytes(""), bytes("4")).ok());
+  EXPECT_EQ(1, loader.count());
+
+  EXPECT_TRUE(txn->rollback().ok());
+}
+
+TEST_F(BulkLoaderTest, ReadOnly) {
+  Txn* reader;
+  ASSERT_TRUE(db->begin(false, reader).ok());
+
+  BulkLoader loader(reader);
+  EXPECT_FALSE(loader.add(bytes("a"), bytes("1")).ok());
+
+  EXPECT_TRUE(reader->rollback().ok());
+  EXPECT_TRUE(txn->rollback().ok());
+  delete reader;
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,172 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boltdb/db/bucket.hpp"
+#include "boltdb/db/bulk_loader.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/db/wal.hpp"
+#include "boltdb/page/node.hpp"
+#include "boltdb/page/page.hpp"
+#include "boltdb/util/options.hpp"
+#include "boltdb/util/util.hpp"
+
+using namespace std;
+using namespace boltdb;
+
+// Commit protocols to compare. kInMemory is the cost of a commit without any
+// disk I/O.
+enum CommitMode { kTwoSyncs, kWal, kSingleSync, kInMemory };
+
+// Commit small transactions, which each replace the root with a new empty
+// leaf, with syncing enabled.
+static void BM_small_commit(benchmark::State& state) {
+  string path = "/tmp/commit_benchmark.db";
+  std::remove(path.c_str());
+  std::remove(Wal::path_of(path).c_str());
+
+  auto mode = static_cast<CommitMode>(state.range(0));
+  Options options = Options{}.set_no_sync(false).set_wal(mode == kWal).set_single_sync_commit(mode == kSingleSync);
+
+  DB* db;
+
+  if (mode == kInMemory) {
+    open_memory_db(path, options, &db);
+  } else {
+    open_db(path, options, &db);
+  }
+
+  for (auto _ : state) {
+    Txn* txn;
+    Page* page;
+    db->begin(true, txn);
+    txn->allocate(1, page);
+    page->set_flag(PageFlag::kLeaf);
+    txn->set_root({.root = page->id(), .sequence = 0});
+    txn->commit();
+    delete txn;
+  }
+
+  delete db;
+  std::remove(path.c_str());
+  std::remove(Wal::path_of(path).c_str());
+}
+
+BENCHMARK(BM_small_commit)->Arg(kTwoSyncs)->Arg(kWal)->Arg(kSingleSync)->Arg(kInMemory);
+
+static span<const Byte> bytes(const string& s) { return {s.data(), s.size()}; }
+
+// Materialize the leaf of `bucket` that holds `key`.
+static Node* leaf_of(Bucket* bucket, const string& key) {
+  Node* node;
+  bucket->node(bucket->root(), nullptr, node);
+
+  while (!node->is_leaf()) {
+    const auto& inodes = node->inodes();
+    auto iter = std::upper_bound(inodes.begin(), inodes.end(), ByteSlice(key),
+                                 [](const ByteSlice& key, const Inode& inode) { return key < inode.key; });
+    node = node->child_at(iter == inodes.begin() ? 0 : static_cast<int>(std::prev(iter) - inodes.begin()));
+  }
+
+  return node;
+}
+
+// Commit 100K dirty keys spread over 1K nested buckets, using `state.range(0)`
+// spill threads. Each bucket only has a couple of dirty leaves, the nodes of
+// all the buckets are encoded together.
+static void BM_bucket_commit(benchmark::State& state) {
+  constexpr int kBuckets = 1000;
+  constexpr int kKeysPerBucket = 100;
+  string path = "/tmp/commit_benchmark.db";
+  std::remove(path.c_str());
+
+  DB* db;
+
+  if (!open_db(path, Options{}.set_spill_threads(static_cast<int>(state.range(0))), &db).ok()) {
+    state.SkipWithError("open_db failed");
+    return;
+  }
+
+  vector<string> names;
+  vector<string> keys;
+
+  for (int b = 0; b < kBuckets; b++) {
+    names.push_back(format("bucket%04d", b));
+  }
+
+  for (int i = 0; i < kKeysPerBucket; i++) {
+    keys.push_back(format("key%08d", i));
+  }
+
+  // Bulk load the buckets, then the root bucket that holds their metas.
+  Txn* txn;
+  db->begin(true, txn);
+  vector<string> metas;
+
+  for (int b = 0; b < kBuckets; b++) {
+    BulkLoader loader(txn);
+    BucketMeta meta{};
+
+    for (auto&& key : keys) {
+      loader.add(bytes(key), bytes(format("value%024d", 0)));
+    }
+
+    loader.finish(meta);
+    metas.emplace_back(reinterpret_cast<const char*>(&meta), sizeof(meta));
+  }
+
+  BulkLoader loader(txn);
+  BucketMeta root{};
+
+  for (int b = 0; b < kBuckets; b++) {
+    loader.add(bytes(names[b]), bytes(metas[b]), LeafFlag::kBucket);
+  }
+
+  loader.finish(root);
+  txn->set_root(root);
+
+  if (!txn->commit().ok()) {
+    state.SkipWithError("load failed");
+  }
+
+  delete txn;
+  int round = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+
+    db->begin(true, txn);
+    ByteSlice value(format("value%024d", ++round));
+
+    for (auto&& name : names) {
+      Bucket* bucket = txn->root_bucket()->bucket(bytes(name));
+
+      for (auto&& key : keys) {
+        leaf_of(bucket, key)->put(ByteSlice(key), ByteSlice(key), value, 0, 0);
+      }
+    }
+
+    state.ResumeTiming();
+
+    benchmark::DoNotOptimize(txn->commit());
+
+    state.PauseTiming();
+    delete txn;
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kBuckets * kKeysPerBucket);
+
+  delete db;
+  std::remove(path.c_str());
+}
+
+BENCHMARK(BM_bucket_commit)->Arg(0)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,150 @@
+#include "boltdb/db/compact.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../fs/test_util.hpp"
+#include "boltdb/db/bulk_loader.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/util/options.hpp"
+#include "boltdb/util/util.hpp"
+
+using namespace boltdb;
+using namespace std;
+
+// Collect "bucket/key=value" strings for every key of the tree rooted at
+// `pgid`, descending into nested buckets.
+static void dump_buckets(Txn* txn, PageID pgid, const string& prefix, vector<string>& out) {
+  Page page = txn->page(pgid);
+
+  if ((page.flag() & PageFlag::kBranch) != 0) {
+    for (auto&& element : page.branch_page_elements()) {
+      dump_buckets(txn, element.pgid, prefix, out);
+    }
+
+    return;
+  }
+
+  for (auto&& element : page.leaf_page_elements()) {
+    string key = element.key().to_string();
+    BucketMeta bucket{};
+
+    if ((element.flags & LeafFlag::kBucket) != 0) {
+      std::memcpy(&bucket, element.value_view().data(), sizeof(bucket));
+    }
+
+    if (bucket.root != 0) {
+      out.push_back(prefix + key + "/seq=" + to_string(bucket.sequence));
+      dump_buckets(txn, bucket.root, prefix + key + "/", out);
+    } else {
+      out.push_back(prefix + key + "=" + element.value().to_hex());
+    }
+  }
+}
+
+static vector<string> dump_buckets(DB* db) {
+  Txn* txn;
+  vector<string> out;
+
+  EXPECT_TRUE(db->begin(false, txn).ok());
+  dump_buckets(txn, txn->root().root, "", out);
+  EXPECT_TRUE(txn->rollback().ok());
+  delete txn;
+
+  return out;
+}
+
+TEST(CompactTest, Compact) {
+  string src_path = "/tmp/compact_src.db";
+  string dst_path = "/tmp/compact_dst.db";
+  std::remove(src_path.c_str());
+
+  DB* db;
+  ASSERT_TRUE(open_db(src_path, Options{}, &db).ok());
+
+  // Build a root bucket with a half full nested bucket, an inline bucket and
+  // a plain value.
+  Txn* txn;
+  ASSERT_TRUE(db->begin(true, txn).ok());
+
+  BucketMeta nested{};
+  BulkLoader nested_loader(txn, 0.5);
+
+  for (int i = 0; i < 20000; i++) {
+    ASSERT_TRUE(nested_loader.add(bytes(format("key%08d", i)), bytes(format("value%08d", i))).ok());
+  }
+
+  ASSERT_TRUE(nested_loader.finish(nested).ok());
+  nested.sequence = 42;
+
+  string nested_value(reinterpret_cast<const char*>(&nested), sizeof(nested));
+  BucketMeta inline_bucket{.root = 0, .sequence = 7};
+  Page inline_page(0, PageFlag::kLeaf, kPageHeaderSize);
+  string inline_value = string(reinterpret_cast<const char*>(&inline_bucket), sizeof(inline_bucket)) +
+                        string(inline_page.data(), kPageHeaderSize);
+
+  BucketMeta root{};
+  BulkLoader root_loader(txn);
+  ASSERT_TRUE(root_loader.add(bytes("a"), bytes(nested_value), LeafFlag::kBucket).ok());
+  ASSERT_TRUE(root_loader.add(bytes("b"), bytes(inline_value), LeafFlag::kBucket).ok());
+  ASSERT_TRUE(root_loader.add(bytes("c"), bytes("plain")).ok());
+  ASSERT_TRUE(root_loader.finish(root).ok());
+
+  ASSERT_TRUE(txn->set_root(root).ok());
+  ASSERT_TRUE(txn->commit().ok());
+  delete txn;
+
+  vector<string> expected = dump_buckets(db);
+  ASSERT_EQ(20003, expected.size());
+
+  // Compact while a reader is open.
+  Txn* reader;
+  ASSERT_TRUE(db->begin(false, reader).ok());
+
+  CompactStats stats;
+  Status status = compact(db, dst_path, stats);
+  ASSERT_TRUE(status.ok()) << status;
+
+  EXPECT_TRUE(reader->rollback().ok());
+  delete reader;
+
+  EXPECT_EQ(20003, stats.key_count);
+  EXPECT_LT(stats.dst_size * 3, stats.src_size * 2);
+  EXPECT_EQ(stats.page_count * db->page_size(), stats.dst_size);
+  EXPECT_GT(stats.throughput(), 0);
+
+  // The compacted database has the same content.
+  DB* compacted;
+  ASSERT_TRUE(open_db(dst_path, Options{}, &compacted).ok());
+  EXPECT_EQ(db->meta().txid, compacted->meta().txid);
+  EXPECT_EQ(expected, dump_buckets(compacted));
+
+  delete compacted;
+  delete db;
+  std::remove(src_path.c_str());
+  std::remove(dst_path.c_str());
+}
+
+TEST(CompactTest, SamePath) {
+  string path = "/tmp/compact_same.db";
+  std::remove(path.c_str());
+
+  DB* db;
+  ASSERT_TRUE(open_db(path, Options{}, &db).ok());
+
+  CompactStats stats;
+  EXPECT_FALSE(compact(db, path, stats).ok());
+
+  delete db;
+  std::remove(path.c_str());
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
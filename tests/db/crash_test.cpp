@@ -0,0 +1,240 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../fs/fault_file_handle.hpp"
+#include "../fs/test_util.hpp"
+#include "boltdb/db/bucket.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/db/wal.hpp"
+#include "boltdb/fs/file_system.hpp"
+#include "boltdb/page/node.hpp"
+#include "boltdb/util/options.hpp"
+#include "boltdb/util/util.hpp"
+
+using namespace boltdb;
+using namespace std;
+
+// Materialize the leaf of the root bucket that holds `key`, the way
+// Bucket::leaf_node() does.
+static Node* leaf_of(Bucket* bucket, const string& key) {
+  Node* node;
+  bucket->node(bucket->root(), nullptr, node);
+
+  while (!node->is_leaf()) {
+    const auto& inodes = node->inodes();
+    auto iter = std::upper_bound(inodes.begin(), inodes.end(), ByteSlice(key),
+                                 [](const ByteSlice& key, const Inode& inode) { return key < inode.key; });
+    node = node->child_at(iter == inodes.begin() ? 0 : static_cast<int>(std::prev(iter) - inodes.begin()));
+  }
+
+  return node;
+}
+
+// Put and remove random keys of the root bucket through its nodes. Return the
+// status of the commit.
+static Status edit(DB* db, std::mt19937& random, const string& suffix) {
+  Txn* txn;
+
+  if (Status status = db->begin(true, txn); !status.ok()) {
+    return status;
+  }
+
+  Bucket* bucket = txn->root_bucket();
+
+  for (int i = 0; i < 200; i++) {
+    string key = format("key%08d", static_cast<int>(random() % 3000));
+
+    if (random() % 2 == 0) {
+      leaf_of(bucket, key)->put(ByteSlice(key), ByteSlice(key), ByteSlice("edit" + suffix), 0, 0);
+    } else {
+      leaf_of(bucket, key)->remove(ByteSlice(key));
+    }
+  }
+
+  Status status = txn->commit();
+  delete txn;
+
+  return status;
+}
+
+// Commit protocols the workload runs under.
+enum class Protocol { kTwoSyncs, kSingleSync, kWal };
+
+// Run randomized transactions on FaultFileHandles, crash at every sync they
+// issue, and check that the database recovered from each crash image is the
+// state after one of the commits. With the write-ahead log, the data file and
+// the log crash together.
+class CrashTest : public ::testing::TestWithParam<Protocol> {
+ protected:
+  static constexpr int kCommits = 8;
+  static constexpr int kSeedsPerCrash = 3;
+
+  void SetUp() override {
+    remove_files();
+    options = Options{}.set_no_sync(false).set_single_sync_commit(GetParam() == Protocol::kSingleSync);
+
+    // Checkpoints are taken by the workload rather than by the checkpointer
+    // thread, so every run issues the same syncs.
+    if (GetParam() == Protocol::kWal) {
+      options.set_wal(true).set_wal_checkpoint_size(0);
+    }
+
+    // Start from a database with some data in it, so the first commits
+    // already reuse freed pages.
+    DB* db;
+    ASSERT_TRUE(open_db(path, options, &db).ok());
+    ASSERT_TRUE(load(db, 500, "-init").ok());
+    delete db;
+
+    initial = read_file(path);
+    initial_log = read_file(Wal::path_of(path));
+  }
+
+  void TearDown() override { remove_files(); }
+
+  void remove_files() {
+    for (auto&& file : {path, recovered_path}) {
+      std::remove(file.c_str());
+      std::remove(Wal::path_of(file).c_str());
+    }
+  }
+
+  // Open `file_path` on `disk`, after restoring its content to `data`.
+  std::unique_ptr<FaultFileHandle> open_file(const string& file_path, const string& data,
+                                             const std::shared_ptr<FaultDisk>& disk, u32 seed) {
+    write_file(file_path, data);
+
+    auto file = FileSystem::open(file_path.c_str(), O_RDWR | O_CREAT, 0666);
+    EXPECT_NE(nullptr, file);
+
+    return std::make_unique<FaultFileHandle>(std::move(file), disk, seed);
+  }
+
+  // Run the workload from the initial database until a commit fails. Return
+  // the number of commits that succeeded and the syncs issued. With `states`,
+  // record the content after each commit.
+  int run(int crash_at, u32 seed, vector<vector<string>>* states, int& out_syncs) {
+    auto disk = std::make_shared<FaultDisk>(crash_at);
+    auto data_file = open_file(path, initial, disk, seed);
+    FaultFileHandle* data_handle = data_file.get();
+    std::unique_ptr<FaultFileHandle> log_file;
+    FaultFileHandle* log_handle = nullptr;
+
+    if (options.is_wal()) {
+      log_file = open_file(Wal::path_of(path), initial_log, disk, seed + 1);
+      log_handle = log_file.get();
+    }
+
+    DB* db;
+    EXPECT_TRUE(open_db(std::move(data_file), std::move(log_file), options, &db).ok());
+    open_syncs = disk->sync_count();
+
+    if (states != nullptr) {
+      states->push_back(dump(db));
+    }
+
+    // The workload is the same on every run, only the crash point differs.
+    // Bulk loads that replace the whole tree alternate with puts and removes
+    // through the nodes.
+    std::mt19937 random(42);
+    int commits = 0;
+
+    for (; commits < kCommits; commits++) {
+      string suffix = format("-%d", commits);
+      Status status = commits % 2 == 0 ? load(db, static_cast<int>(random() % 3000) + 1, suffix)
+                                       : edit(db, random, suffix);
+
+      if (!status.ok()) {
+        break;
+      }
+
+      if (states != nullptr) {
+        states->push_back(dump(db));
+      }
+
+      if (db->wal() != nullptr && commits % 3 == 2 && !db->wal()->checkpoint().ok()) {
+        commits++;
+        break;
+      }
+    }
+
+    disk->crash();
+    out_syncs = disk->sync_count();
+
+    // The handles are owned by the database, keep the images.
+    image = data_handle->crash_image();
+    log_image = log_handle != nullptr ? log_handle->crash_image() : "";
+    delete db;
+
+    return commits;
+  }
+
+  string path = "/tmp/crash_test.db";
+  string recovered_path = "/tmp/crash_test_recovered.db";
+  Options options;
+  string initial;
+  string initial_log;
+  string image;
+  string log_image;
+  int open_syncs{};  // Syncs issued by opening the database
+};
+
+TEST_P(CrashTest, RecoversCommittedPrefix) {
+  vector<vector<string>> states;
+  int syncs;
+
+  ASSERT_EQ(kCommits, run(0, 0, &states, syncs));
+  ASSERT_GT(syncs - open_syncs, kCommits);
+
+  // Crash at every sync of the workload and once more after the last one.
+  for (int crash_at = open_syncs + 1; crash_at <= syncs + 1; crash_at++) {
+    for (u32 seed = 0; seed < kSeedsPerCrash; seed++) {
+      SCOPED_TRACE(format("crash at sync %d, seed %u", crash_at, seed));
+
+      int crash_syncs;
+      int commits = run(crash_at, seed, nullptr, crash_syncs);
+      write_file(recovered_path, image);
+      write_file(Wal::path_of(recovered_path), log_image);
+
+      DB* db;
+      ASSERT_TRUE(open_db(recovered_path, options, &db).ok());
+
+      // The commit in flight at the crash may or may not have made it.
+      vector<string> got = dump(db);
+      bool committed = got == states[commits] || (commits < kCommits && got == states[commits + 1]);
+      EXPECT_TRUE(committed) << "recovered " << got.size() << " keys after " << commits << " commits";
+
+      // The recovered database keeps working.
+      ASSERT_TRUE(load(db, 10, "-after").ok());
+      EXPECT_EQ(10, dump(db).size());
+      delete db;
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(CommitProtocols, CrashTest,
+                         ::testing::Values(Protocol::kTwoSyncs, Protocol::kSingleSync, Protocol::kWal),
+                         [](const auto& info) -> string {
+                           switch (info.param) {
+                             case Protocol::kTwoSyncs:
+                               return "TwoSyncs";
+                             case Protocol::kSingleSync:
+                               return "SingleSync";
+                             case Protocol::kWal:
+                               return "Wal";
+                           }
+
+                           return "";
+                         });
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
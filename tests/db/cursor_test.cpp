@@ -0,0 +1,124 @@
+#include "boltdb/db/cursor.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "boltdb/db/bucket.hpp"
+#include "boltdb/db/bulk_loader.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/page/node.hpp"
+#include "boltdb/util/exception.hpp"
+#include "boltdb/util/options.hpp"
+#include "boltdb/util/util.hpp"
+
+using namespace boltdb;
+using namespace std;
+
+static span<const Byte> bytes(const string& s) { return {s.data(), s.size()}; }
+
+static string str(span<const Byte> s) { return {s.data(), s.size()}; }
+
+class CursorTest : public ::testing::Test {
+ protected:
+  static constexpr int kKeys = 10000;
+
+  // Load every other key, "key00000000", "key00000002", ...
+  void SetUp() override {
+    ASSERT_TRUE(open_memory_db("cursor_test", Options{}, &db).ok());
+
+    Txn* txn;
+    ASSERT_TRUE(db->begin(true, txn).ok());
+
+    BucketMeta root{};
+    BulkLoader loader(txn);
+
+    for (int i = 0; i < kKeys; i += 2) {
+      ASSERT_TRUE(loader.add(bytes(format("key%08d", i)), bytes(format("value%d", i))).ok());
+    }
+
+    ASSERT_TRUE(loader.finish(root).ok());
+    ASSERT_TRUE(txn->set_root(root).ok());
+    ASSERT_TRUE(txn->commit().ok());
+    delete txn;
+  }
+
+  void TearDown() override { delete db; }
+
+  DB* db;
+};
+
+TEST_F(CursorTest, ReadOnlyNeverMaterializesNodes) {
+  Txn* txn;
+  ASSERT_TRUE(db->begin(false, txn).ok());
+
+  {
+    Bucket bucket(txn, txn->root());
+    auto cursor = bucket.cursor();
+
+    // Iterate every key in order.
+    int i = 0;
+
+    for (auto [key, value] = cursor->first(); key.data() != nullptr; tie(key, value) = cursor->next()) {
+      ASSERT_EQ(format("key%08d", i), str(key));
+      ASSERT_EQ(format("value%d", i), str(value));
+      i += 2;
+    }
+
+    EXPECT_EQ(kKeys, i);
+    EXPECT_EQ(nullptr, cursor->next().first.data());
+
+    EXPECT_EQ(format("key%08d", kKeys - 2), str(cursor->last().first));
+
+    // Seek to a key, between keys, before the first one and past the end.
+    EXPECT_EQ("key00004000", str(cursor->seek(bytes("key00004000")).first));
+    EXPECT_EQ("key00004002", str(cursor->seek(bytes("key00004001")).first));
+    EXPECT_EQ("key00004004", str(cursor->next().first));
+    EXPECT_EQ("key00000000", str(cursor->seek(bytes("a")).first));
+    EXPECT_EQ(nullptr, cursor->seek(bytes("z")).first.data());
+
+    EXPECT_EQ("value1234", str(bucket.get(bytes("key00001234"))));
+    EXPECT_EQ(nullptr, bucket.get(bytes("key00001235")).data());
+
+    Node* node;
+    EXPECT_THROW(bucket.node(bucket.root(), nullptr, node), DBException);
+  }
+
+  EXPECT_EQ(0, txn->stats.node_count);
+  EXPECT_TRUE(txn->rollback().ok());
+  delete txn;
+}
+
+TEST_F(CursorTest, SeesMaterializedNodes) {
+  Txn* txn;
+  ASSERT_TRUE(db->begin(true, txn).ok());
+
+  {
+    Bucket bucket(txn, txn->root());
+    Node* root;
+    bucket.node(bucket.root(), nullptr, root);
+    ASSERT_FALSE(root->is_leaf());
+
+    // Add a key to the first leaf, only the node has it.
+    ByteSlice key("key00000001");
+    ByteSlice value("new");
+    root->child_at(0)->put(key, key, value, 0, 0);
+
+    auto cursor = bucket.cursor();
+    EXPECT_EQ("key00000000", str(cursor->first().first));
+    EXPECT_EQ("key00000001", str(cursor->next().first));
+    EXPECT_EQ("key00000002", str(cursor->next().first));
+    EXPECT_EQ("new", str(cursor->seek(bytes("key00000001")).second));
+    EXPECT_EQ("new", str(bucket.get(bytes("key00000001"))));
+    EXPECT_EQ(format("key%08d", kKeys - 2), str(cursor->last().first));
+  }
+
+  EXPECT_TRUE(txn->rollback().ok());
+  delete txn;
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -3,8 +3,14 @@
 #include <gtest/gtest.h>
 
 #include <cstdint>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "../fs/test_util.hpp"
+#include "boltdb/db/bulk_loader.hpp"
+#include "boltdb/fs/file_system.hpp"
 #include "boltdb/os/darwin.hpp"
 #include "boltdb/util/options.hpp"
 #include "boltdb/util/slice.hpp"
@@ -23,6 +29,473 @@ TEST(DBTest, OpenNonExist) {
   EXPECT_TRUE(status.status_type() == kStatusOK);
 }
 
+TEST(DBTest, BeginReadOnly) {
+  DB* db;
+  Options options;
+  std::string path = "/tmp/begin_read_only.db";
+  std::remove(path.c_str());
+
+  Status status = open_db(path, options, &db);
+  ASSERT_TRUE(status.ok()) << status;
+
+  Txn* txn1;
+  Txn* txn2;
+  ASSERT_TRUE(db->begin(false, txn1).ok());
+  ASSERT_TRUE(db->begin(false, txn2).ok());
+
+  // Both readers see the newest meta page.
+  EXPECT_EQ(1, txn1->id());
+  EXPECT_EQ(txn1->id(), txn2->id());
+  EXPECT_EQ(PageFlag::kFreeList, txn1->page(db->meta().freelist).flag());
+
+  EXPECT_TRUE(txn1->rollback().ok());
+  EXPECT_TRUE(txn2->rollback().ok());
+  EXPECT_FALSE(txn2->rollback().ok());
+
+  delete txn1;
+  delete txn2;
+  delete db;
+}
+
+TEST(DBTest, CommitGrowsFile) {
+  DB* db;
+  Options options;
+  std::string path = "/tmp/commit_grows_file.db";
+  std::remove(path.c_str());
+
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+
+  GrowStats before = db->grow_stats();
+
+  Txn* txn;
+  Page* page;
+  ASSERT_TRUE(db->begin(true, txn).ok());
+  ASSERT_TRUE(txn->allocate(8, page).ok());
+
+  PageID pgid = page->id();
+  page->set_flag(PageFlag::kLeaf);
+  std::fill_n(page->skip_page_header(), 16, 'x');
+
+  Status status = txn->commit();
+  ASSERT_TRUE(status.ok()) << status;
+  delete txn;
+
+  GrowStats after = db->grow_stats();
+  EXPECT_EQ(before.grow_count + 1, after.grow_count);
+  EXPECT_GE(after.bytes_allocated - before.bytes_allocated, 8 * db->page_size());
+  EXPECT_GE(FileSystem::file_size(*FileSystem::open(path.c_str(), O_RDONLY, 0)), (pgid + 8) * db->page_size());
+
+  delete db;
+
+  // Reopen and check the committed page.
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  EXPECT_EQ(2, db->meta().txid);
+
+  Page reopened = db->page(pgid);
+  EXPECT_EQ(PageFlag::kLeaf, reopened.flag());
+  EXPECT_EQ('x', reopened.skip_page_header()[15]);
+
+  delete db;
+}
+
+TEST(DBTest, ShrinkAfterFree) {
+  DB* db;
+  std::string path = "/tmp/shrink_after_free.db";
+  std::remove(path.c_str());
+
+  Options options;
+  options.set_shrink_threshold(64 * 1024);
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+
+  int page_size = db->page_size();
+
+  // Fill the database with a tree of a few thousand pages.
+  Txn* txn;
+  BucketMeta root{};
+  ASSERT_TRUE(db->begin(true, txn).ok());
+
+  BulkLoader loader(txn);
+
+  for (int i = 0; i < 100000; i++) {
+    std::string key = format("key%08d", i);
+    ASSERT_TRUE(loader.add({key.data(), key.size()}, {key.data(), key.size()}).ok());
+  }
+
+  ASSERT_TRUE(loader.finish(root).ok());
+  ASSERT_TRUE(txn->set_root(root).ok());
+  ASSERT_TRUE(txn->commit().ok());
+  delete txn;
+
+  PageID high_water_mark = db->meta().pgid;
+
+  // Replace the tree with an empty leaf, which frees all of its pages.
+  Page* page;
+  ASSERT_TRUE(db->begin(true, txn).ok());
+  ASSERT_TRUE(txn->allocate(1, page).ok());
+  page->set_flag(PageFlag::kLeaf);
+  ASSERT_TRUE(txn->set_root({.root = page->id(), .sequence = 0}).ok());
+  ASSERT_TRUE(txn->commit().ok());
+  delete txn;
+
+  std::uintmax_t full_size = FileSystem::file_size(*FileSystem::open(path.c_str(), O_RDONLY, 0));
+
+  // The pages are only free once no transaction can see them. The freelist
+  // written by the last commit went to the end of the file and is released
+  // one commit later, so it takes two more commits to shrink the file.
+  for (int i = 0; i < 2; i++) {
+    ASSERT_TRUE(db->begin(true, txn).ok());
+    ASSERT_TRUE(txn->commit().ok());
+    delete txn;
+  }
+
+  PageID lowered = db->meta().pgid;
+  std::uintmax_t size = FileSystem::file_size(*FileSystem::open(path.c_str(), O_RDONLY, 0));
+
+  EXPECT_LT(lowered, high_water_mark / 10);
+  EXPECT_EQ(1, db->grow_stats().shrink_count);
+  EXPECT_EQ(full_size - size, db->grow_stats().bytes_released);
+  EXPECT_EQ(lowered * page_size + options.shrink_threshold() / 2, size);
+
+  // Nothing is left to trim, the next commit keeps the file as it is.
+  ASSERT_TRUE(db->begin(true, txn).ok());
+  ASSERT_TRUE(txn->commit().ok());
+  delete txn;
+
+  EXPECT_EQ(1, db->grow_stats().shrink_count);
+  delete db;
+
+  // The shrunk database opens with the empty tree.
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  EXPECT_EQ(lowered, db->meta().pgid);
+  EXPECT_EQ(PageFlag::kLeaf, db->page(db->meta().root.root).flag());
+  EXPECT_EQ(0, db->page(db->meta().root.root).count());
+
+  delete db;
+  std::remove(path.c_str());
+}
+
+TEST(DBTest, ShrinkKeepsReaderPages) {
+  DB* db;
+  std::string path = "/tmp/shrink_keeps_reader_pages.db";
+  std::remove(path.c_str());
+
+  Options options;
+  options.set_shrink_threshold(64 * 1024);
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+
+  int page_size = db->page_size();
+  Txn* txn;
+  BucketMeta root{};
+  ASSERT_TRUE(db->begin(true, txn).ok());
+
+  BulkLoader loader(txn);
+
+  for (int i = 0; i < 100000; i++) {
+    std::string key = format("key%08d", i);
+    ASSERT_TRUE(loader.add({key.data(), key.size()}, {key.data(), key.size()}).ok());
+  }
+
+  ASSERT_TRUE(loader.finish(root).ok());
+  ASSERT_TRUE(txn->set_root(root).ok());
+  ASSERT_TRUE(txn->commit().ok());
+  delete txn;
+
+  // Free the tree, then wait one commit for the freelist page at the end of
+  // the file to become free, like in ShrinkAfterFree.
+  Page* page;
+  ASSERT_TRUE(db->begin(true, txn).ok());
+  ASSERT_TRUE(txn->allocate(1, page).ok());
+  page->set_flag(PageFlag::kLeaf);
+  ASSERT_TRUE(txn->set_root({.root = page->id(), .sequence = 0}).ok());
+  ASSERT_TRUE(txn->commit().ok());
+  delete txn;
+
+  ASSERT_TRUE(db->begin(true, txn).ok());
+  ASSERT_TRUE(txn->commit().ok());
+  delete txn;
+
+  // A reader that begins after the writer released the pages, but before it
+  // commits, still sees the high water mark from before the trim.
+  Txn* reader;
+  ASSERT_TRUE(db->begin(true, txn).ok());
+  ASSERT_TRUE(db->begin(false, reader).ok());
+  ASSERT_TRUE(txn->commit().ok());
+  delete txn;
+
+  EXPECT_LT(db->meta().pgid, reader->meta().pgid);
+  EXPECT_GE(FileSystem::file_size(*FileSystem::open(path.c_str(), O_RDONLY, 0)), reader->size());
+
+  // The backup reads up to the reader's high water mark.
+  std::ostringstream backup;
+  i64 written;
+  Status status = reader->write_to(backup, written);
+  ASSERT_TRUE(status.ok()) << status;
+  EXPECT_EQ(reader->size(), written);
+
+  ASSERT_TRUE(reader->rollback().ok());
+  delete reader;
+
+  // The shrink completes on the next commit once the reader is gone.
+  ASSERT_TRUE(db->begin(true, txn).ok());
+  ASSERT_TRUE(txn->commit().ok());
+  delete txn;
+
+  EXPECT_EQ(db->meta().pgid * page_size + options.shrink_threshold() / 2,
+            FileSystem::file_size(*FileSystem::open(path.c_str(), O_RDONLY, 0)));
+
+  delete db;
+  std::remove(path.c_str());
+}
+
+// Get the value of the first key of the tree.
+static std::string first_value(DB* db) {
+  Page page = db->page(db->meta().root.root);
+
+  while ((page.flag() & PageFlag::kBranch) != 0) {
+    page = db->page(page.branch_page_element(0)->pgid);
+  }
+
+  return page.leaf_page_element(0)->value().to_string();
+}
+
+TEST(DBTest, SingleSyncCommit) {
+  DB* db;
+  std::string path = "/tmp/single_sync_commit.db";
+  std::remove(path.c_str());
+
+  Options options;
+  options.set_single_sync_commit(true);
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+
+  ASSERT_TRUE(load(db, 1000, "a").ok());
+  Meta meta = db->meta();
+  EXPECT_NE(0, meta.flags & Meta::kFlagCommitRecord);
+  EXPECT_GT(db->page(meta.txid % 2).meta()->commit_record()->count, 0);
+  delete db;
+
+  std::string before = read_file(path);
+
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  ASSERT_TRUE(load(db, 2000, "b").ok());
+  TxnID txid = db->meta().txid;
+  int page_size = db->page_size();
+  delete db;
+
+  std::string after = read_file(path);
+
+  // The complete commit opens as it is.
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  EXPECT_EQ(txid, db->meta().txid);
+  EXPECT_EQ("value00000000b", first_value(db));
+  delete db;
+
+  // Only the meta of the last commit made it to disk, its pages didn't.
+  std::string torn = before;
+  torn.resize(after.size());
+  std::size_t slot = (txid % 2) * page_size;
+  torn.replace(slot, page_size, after.substr(slot, page_size));
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << torn;
+
+  ASSERT_TRUE(open_db(path, Options(options).set_mmap_reserve_size(1), &db).ok());
+  EXPECT_EQ(meta.txid, db->meta().txid);
+  EXPECT_EQ("value00000000a", first_value(db));
+
+  // Growing past the reservation moves the mmap. The incomplete meta is still
+  // skipped.
+  {
+    Txn* txn;
+    ASSERT_TRUE(db->begin(true, txn).ok());
+    BulkLoader loader(txn);
+
+    for (int i = 0; i < 20000; i++) {
+      std::string key = format("key%08d", i);
+      ASSERT_TRUE(loader.add({key.data(), key.size()}, {key.data(), key.size()}).ok());
+    }
+
+    BucketMeta root{};
+    ASSERT_TRUE(loader.finish(root).ok());
+    ASSERT_TRUE(txn->rollback().ok());
+    delete txn;
+  }
+
+  EXPECT_EQ(meta.txid, db->meta().txid);
+  EXPECT_EQ("value00000000a", first_value(db));
+
+  // The next commit reuses the slot of the incomplete meta.
+  ASSERT_TRUE(load(db, 10, "c").ok());
+  EXPECT_EQ(txid, db->meta().txid);
+  delete db;
+
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  EXPECT_EQ(txid, db->meta().txid);
+  EXPECT_EQ("value00000000c", first_value(db));
+  delete db;
+
+  std::remove(path.c_str());
+}
+
+TEST(DBTest, PageSizes) {
+  std::string path = "/tmp/page_sizes.db";
+
+  for (int page_size = DB::kMinPageSize; page_size <= DB::kMaxPageSize; page_size *= 2) {
+    SCOPED_TRACE(page_size);
+    std::remove(path.c_str());
+
+    DB* db;
+    ASSERT_TRUE(open_db(path, Options{}.set_page_size(page_size), &db).ok());
+    ASSERT_TRUE(load(db, 2000, "a").ok());
+    ASSERT_TRUE(load(db, 3000, "b").ok());
+    delete db;
+
+    // The page size of the file wins over the option.
+    ASSERT_TRUE(open_db(path, Options{}.set_page_size(4096 + 1), &db).ok());
+    EXPECT_EQ(page_size, db->page_size());
+    EXPECT_EQ("value00000000b", first_value(db));
+    TxnID txid = db->meta().txid;
+    delete db;
+
+    // Tear the newest meta page. Its page size is found from the other one,
+    // and the database opens at the previous commit.
+    std::string data = read_file(path);
+    std::size_t newest = (txid % 2) * page_size;
+    data.replace(newest, page_size, std::string(page_size, '\0'));
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << data;
+
+    ASSERT_TRUE(open_db(path, Options{}, &db).ok());
+    EXPECT_EQ(page_size, db->page_size());
+    EXPECT_EQ(txid - 1, db->meta().txid);
+    EXPECT_EQ("value00000000a", first_value(db));
+    delete db;
+  }
+
+  DB* db;
+  std::remove(path.c_str());
+  EXPECT_FALSE(open_db(path, Options{}.set_page_size(256), &db).ok());
+  std::remove(path.c_str());
+  EXPECT_FALSE(open_db(path, Options{}.set_page_size(3000), &db).ok());
+
+  // Neither meta page is valid.
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << std::string(64 * 1024, 'x');
+  EXPECT_EQ(kStatusCorrupt, open_db(path, Options{}, &db).status_type());
+  std::remove(path.c_str());
+}
+
+TEST(DBTest, InMemory) {
+  DB* db;
+  Options options;
+  options.set_no_sync(false).set_wal(true).set_track_page_txids(true);
+  ASSERT_TRUE(open_memory_db("in_memory", options, &db).ok());
+  EXPECT_EQ(nullptr, db->wal());
+  EXPECT_EQ(nullptr, db->page_txids());
+
+  ASSERT_TRUE(load(db, 20000, "a").ok());
+  ASSERT_TRUE(load(db, 10, "b").ok());
+  EXPECT_EQ("value00000000b", first_value(db));
+  EXPECT_GT(db->page_size() * db->meta().pgid, 20000);
+
+  // The path refers to the memory file, so hot backups still work.
+  std::string path = "/tmp/in_memory_copy.db";
+  Txn* txn;
+  ASSERT_TRUE(db->begin(false, txn).ok());
+  ASSERT_TRUE(txn->copy_file(path, 0600).ok());
+  ASSERT_TRUE(txn->rollback().ok());
+  delete txn;
+  delete db;
+
+  ASSERT_TRUE(open_db(path, Options{}, &db).ok());
+  EXPECT_EQ("value00000000b", first_value(db));
+  delete db;
+
+  std::remove(path.c_str());
+}
+
+TEST(DBTest, Stats) {
+  DB* db;
+  ASSERT_TRUE(open_memory_db("stats", Options{}, &db).ok());
+
+  DBStats stats = db->stats();
+  EXPECT_EQ(0, stats.txn_n);
+  EXPECT_EQ(0, stats.open_txn_n);
+  EXPECT_GT(stats.mmap_size, 0);
+
+  ASSERT_TRUE(load(db, 20000, "a").ok());
+  ASSERT_TRUE(load(db, 10, "b").ok());
+
+  // Readers are counted when they start, their stats when they close.
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([db] {
+      for (int j = 0; j < 1000; j++) {
+        Txn* txn;
+        ASSERT_TRUE(db->begin(false, txn).ok());
+        txn->stats.cursor_count = 1;
+        ASSERT_TRUE(txn->rollback().ok());
+        delete txn;
+      }
+    });
+  }
+
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  Txn* txn;
+  ASSERT_TRUE(db->begin(false, txn).ok());
+
+  stats = db->stats();
+  EXPECT_EQ(8001, stats.txn_n);
+  EXPECT_EQ(1, stats.open_txn_n);
+  EXPECT_EQ(8000, stats.txn_stats.cursor_count);
+  EXPECT_GT(stats.txn_stats.page_count, 0);
+  EXPECT_GT(stats.txn_stats.write_time.count(), 0);
+
+  // The second load freed the pages of the first one.
+  EXPECT_GT(stats.free_page_n + stats.pending_page_n, 10);
+  EXPECT_EQ((stats.free_page_n + stats.pending_page_n) * db->page_size(), stats.free_alloc);
+  EXPECT_GT(stats.freelist_inuse, 0);
+  EXPECT_EQ(db->grow_stats().grow_count, stats.grow.grow_count);
+
+  ASSERT_TRUE(txn->rollback().ok());
+  delete txn;
+  delete db;
+}
+
+TEST(DBTest, Latencies) {
+  DB* db;
+  std::string path = "/tmp/latencies.db";
+  std::remove(path.c_str());
+  ASSERT_TRUE(open_db(path, Options{}.set_no_sync(false), &db).ok());
+
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(load(db, 1000, "a").ok());
+  }
+
+  Txn* txn;
+  ASSERT_TRUE(db->begin(false, txn).ok());
+  ASSERT_TRUE(txn->rollback().ok());
+  delete txn;
+
+  EXPECT_EQ(10, db->latency(Latency::kCommit).count());
+  EXPECT_EQ(10, db->latency(Latency::kWrite).count());
+  EXPECT_EQ(10, db->latency(Latency::kWriteMeta).count());
+  EXPECT_GE(db->latency(Latency::kSync).count(), 20);
+  EXPECT_EQ(1, db->latency(Latency::kReadTxn).count());
+  EXPECT_GE(db->latency(Latency::kRemap).count(), 1);
+
+  // The bulk loads spilled no node, so that histogram was never allocated.
+  EXPECT_EQ(0, db->latency(Latency::kSpill).count());
+  EXPECT_EQ(Duration::zero(), db->latency(Latency::kSpill).percentile(99));
+
+  // A commit includes writing its pages and meta.
+  HistogramSnapshot commit = db->latency(Latency::kCommit);
+  EXPECT_GT(commit.percentile(99.9), db->latency(Latency::kWrite).percentile(0));
+  EXPECT_GE(commit.max(), commit.percentile(50));
+
+  delete db;
+  std::remove(path.c_str());
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
 
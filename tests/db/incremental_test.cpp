@@ -0,0 +1,218 @@
+#include "boltdb/db/incremental.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../fs/test_util.hpp"
+#include "boltdb/db/bulk_loader.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/db/page_txids.hpp"
+#include "boltdb/page/page.hpp"
+#include "boltdb/util/options.hpp"
+#include "boltdb/util/util.hpp"
+
+using namespace boltdb;
+using namespace std;
+
+static vector<string> dump(const string& path) {
+  DB* db;
+  EXPECT_TRUE(open_db(path, Options{}, &db).ok());
+  vector<string> out = dump(db);
+  delete db;
+
+  return out;
+}
+
+class IncrementalTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    remove_all();
+    ASSERT_TRUE(open_db(path, Options{}.set_track_page_txids(true), &db).ok());
+  }
+
+  void TearDown() override {
+    delete db;
+    remove_all();
+  }
+
+  void remove_all() {
+    for (const string& p : {path, base_path, PageTxids::path_of(path), PageTxids::path_of(base_path)}) {
+      std::remove(p.c_str());
+    }
+  }
+
+  // Take a full backup into `base_path` and return its txid.
+  TxnID full_backup() {
+    Txn* txn;
+    EXPECT_TRUE(db->begin(false, txn).ok());
+    EXPECT_TRUE(txn->copy_file(base_path, 0600).ok());
+    TxnID txid = txn->id();
+    EXPECT_TRUE(txn->rollback().ok());
+    delete txn;
+
+    return txid;
+  }
+
+  string incremental(TxnID base_txid, IncrementalStats& stats) {
+    Txn* txn;
+    std::ostringstream out;
+    EXPECT_TRUE(db->begin(false, txn).ok());
+
+    Status status = write_incremental(txn, base_txid, out, stats);
+    EXPECT_TRUE(status.ok()) << status;
+    EXPECT_TRUE(txn->rollback().ok());
+    delete txn;
+
+    return out.str();
+  }
+
+  string path = "/tmp/incremental_test.db";
+  string base_path = "/tmp/incremental_test_base.db";
+  DB* db{};
+};
+
+TEST_F(IncrementalTest, Apply) {
+  ASSERT_TRUE(load(db, 20000, "a").ok());
+  TxnID base_txid = full_backup();
+
+  // Only the pages of the new tree and the freelist changed.
+  ASSERT_TRUE(load(db, 100, "b").ok());
+
+  IncrementalStats stats;
+  string backup = incremental(base_txid, stats);
+  EXPECT_EQ(base_txid, stats.base_txid);
+  EXPECT_EQ(db->meta().txid, stats.txid);
+  EXPECT_GT(stats.page_count, 0);
+  EXPECT_LE(stats.page_count, 4);
+  EXPECT_EQ(static_cast<i64>(backup.size()), stats.bytes);
+
+  std::istringstream in(backup);
+  IncrementalStats applied;
+  Status status = apply_incremental(base_path, in, applied);
+  ASSERT_TRUE(status.ok()) << status;
+  EXPECT_EQ(stats.page_count, applied.page_count);
+  EXPECT_EQ(dump(db), dump(base_path));
+
+  // Chain a second backup on top of the first one.
+  ASSERT_TRUE(load(db, 5000, "c").ok());
+  backup = incremental(stats.txid, stats);
+
+  std::istringstream in2(backup);
+  ASSERT_TRUE(apply_incremental(base_path, in2, applied).ok());
+  EXPECT_EQ(dump(db), dump(base_path));
+}
+
+TEST_F(IncrementalTest, ApplyOutOfOrder) {
+  ASSERT_TRUE(load(db, 1000, "a").ok());
+  TxnID base_txid = full_backup();
+  ASSERT_TRUE(load(db, 1000, "b").ok());
+  ASSERT_TRUE(load(db, 1000, "c").ok());
+
+  // The copy is older than the base of the backup.
+  IncrementalStats stats;
+  string backup = incremental(base_txid + 1, stats);
+  std::istringstream in(backup);
+  EXPECT_FALSE(apply_incremental(base_path, in, stats).ok());
+
+  // A truncated or damaged backup is rejected and leaves the copy alone.
+  string copy_file = read_file(base_path);
+  backup = incremental(base_txid, stats);
+  std::istringstream truncated(backup.substr(0, backup.size() - 1));
+  EXPECT_FALSE(apply_incremental(base_path, truncated, stats).ok());
+
+  backup[backup.size() - 20] ^= 1;
+  std::istringstream damaged(backup);
+  EXPECT_EQ(kStatusCorrupt, apply_incremental(base_path, damaged, stats).status_type());
+  EXPECT_EQ(copy_file, read_file(base_path));
+  EXPECT_FALSE(std::filesystem::exists(base_path + ".incremental"));
+
+  DB* copy;
+  ASSERT_TRUE(open_db(base_path, Options{}, &copy).ok());
+  EXPECT_EQ(base_txid, copy->meta().txid);
+  delete copy;
+}
+
+TEST_F(IncrementalTest, StaleMap) {
+  ASSERT_TRUE(load(db, 1000, "a").ok());
+  TxnID base_txid = full_backup();
+
+  // Writes made without the map make it stale, every page counts as changed.
+  delete db;
+  ASSERT_TRUE(open_db(path, Options{}, &db).ok());
+  ASSERT_TRUE(load(db, 10, "b").ok());
+  delete db;
+  ASSERT_TRUE(open_db(path, Options{}.set_track_page_txids(true), &db).ok());
+
+  IncrementalStats stats;
+  string backup = incremental(base_txid, stats);
+  EXPECT_EQ(static_cast<i64>(db->meta().pgid) - 2, stats.page_count);
+
+  std::istringstream in(backup);
+  ASSERT_TRUE(apply_incremental(base_path, in, stats).ok());
+  EXPECT_EQ(dump(db), dump(base_path));
+
+  // Reopening with an up to date map keeps it.
+  ASSERT_TRUE(load(db, 10, "c").ok());
+  delete db;
+  ASSERT_TRUE(open_db(path, Options{}.set_track_page_txids(true), &db).ok());
+  incremental(db->meta().txid - 1, stats);
+  EXPECT_GT(stats.page_count, 0);
+  EXPECT_LE(stats.page_count, 4);
+  incremental(db->meta().txid, stats);
+  EXPECT_EQ(0, stats.page_count);
+}
+
+TEST_F(IncrementalTest, Untracked) {
+  delete db;
+  ASSERT_TRUE(open_db(path, Options{}, &db).ok());
+
+  Txn* txn;
+  std::ostringstream out;
+  IncrementalStats stats;
+  ASSERT_TRUE(db->begin(false, txn).ok());
+  EXPECT_FALSE(write_incremental(txn, 0, out, stats).ok());
+  ASSERT_TRUE(txn->rollback().ok());
+  delete txn;
+}
+
+TEST(PageTxidsTest, ChangedSince) {
+  string db_path = "/tmp/page_txids_test.db";
+  std::remove(PageTxids::path_of(db_path).c_str());
+
+  std::unique_ptr<PageTxids> txids;
+  ASSERT_TRUE(PageTxids::open(db_path, 5, 10, false, txids).ok());
+  EXPECT_EQ(5, txids->get(9));
+
+  txids->record(3, 2, 7);
+  txids->record(8, 1, 7);
+  ASSERT_TRUE(txids->sync(7, false).ok());
+
+  using Runs = vector<pair<PageID, PageID>>;
+  EXPECT_EQ((Runs{{3, 5}, {8, 9}}), txids->changed_since(5, 10));
+  EXPECT_EQ((Runs{{2, 10}}), txids->changed_since(4, 10));
+
+  // Pages past the map count as changed.
+  EXPECT_EQ((Runs{{3, 5}, {8, 9}, {10, 12}}), txids->changed_since(5, 12));
+
+  // The synced entries survive reopening.
+  ASSERT_TRUE(PageTxids::open(db_path, 7, 10, false, txids).ok());
+  EXPECT_EQ(7, txids->get(4));
+  EXPECT_EQ(5, txids->get(5));
+
+  // A map behind the database is rebuilt.
+  ASSERT_TRUE(PageTxids::open(db_path, 9, 10, false, txids).ok());
+  EXPECT_EQ(9, txids->get(4));
+
+  std::remove(PageTxids::path_of(db_path).c_str());
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
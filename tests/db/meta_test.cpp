@@ -5,6 +5,8 @@
 
 #include "boltdb/db/db.hpp"
 #include "boltdb/os/darwin.hpp"
+#include "boltdb/util/binary.hpp"
+#include "boltdb/util/crc64.hpp"
 #include "boltdb/util/slice.hpp"
 
 using namespace boltdb;
@@ -28,6 +30,32 @@ TEST(MetaTest, SerializeAndDeserialize) {
   EXPECT_TRUE(new_meta.equals(meta));
 }
 
+TEST(MetaTest, EncodeAndDecode) {
+  Meta meta{.magic = DB::kMagic,
+            .version = DB::kVersion,
+            .page_size = 4096,
+            .flags = Meta::kFlagCommitRecord,
+            .root = {.root = 0x0102030405060708, .sequence = 9},
+            .freelist = 2,
+            .pgid = 1000,
+            .txid = 42};
+  meta.checksum = meta.sum64();
+  EXPECT_TRUE(meta.validate().ok());
+
+  Byte buffer[Meta::kEncodedSize];
+  EXPECT_EQ(buffer + Meta::kEncodedSize, meta.encode(buffer));
+  EXPECT_TRUE(Meta::decode(buffer).equals(meta));
+
+  // Same bytes as the slice based encoding, and the same checksum as before.
+  ByteSlice slice;
+  slice = binary::BigEndian::append_variadic_uint(slice, meta.magic, meta.version, meta.page_size, meta.flags,
+                                                  meta.root.root, meta.root.sequence, meta.freelist, meta.pgid,
+                                                  meta.txid, meta.checksum);
+  EXPECT_EQ(slice.to_string(), std::string(buffer, Meta::kEncodedSize));
+  EXPECT_EQ(slice.to_string(), Meta::serialize(meta).to_string());
+  EXPECT_EQ(crc64_be(0, slice.data(), Meta::kEncodedSize - sizeof(u64)), meta.checksum);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
 
@@ -0,0 +1,153 @@
+#include "boltdb/db/metrics.hpp"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "boltdb/db/bulk_loader.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/util/options.hpp"
+#include "boltdb/util/util.hpp"
+
+using namespace boltdb;
+using namespace std;
+
+// Count the allocations made by this test.
+static thread_local int allocations = 0;
+
+void* operator new(std::size_t size) {
+  allocations++;
+
+  if (void* p = std::malloc(size)) {
+    return p;
+  }
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+class MetricsTest : public ::testing::Test {
+ protected:
+  // Commit three transactions and run a reader.
+  void SetUp() override {
+    ASSERT_TRUE(open_memory_db("metrics_test", Options{}, &db).ok());
+
+    for (int n = 0; n < 3; n++) {
+      Txn* txn;
+      ASSERT_TRUE(db->begin(true, txn).ok());
+
+      BucketMeta root{};
+      BulkLoader loader(txn);
+
+      for (int i = 0; i < 1000; i++) {
+        string key = format("key%08d", i);
+        ASSERT_TRUE(loader.add({key.data(), key.size()}, {key.data(), key.size()}).ok());
+      }
+
+      ASSERT_TRUE(loader.finish(root).ok());
+      ASSERT_TRUE(txn->set_root(root).ok());
+      ASSERT_TRUE(txn->commit().ok());
+      delete txn;
+    }
+
+    Txn* txn;
+    ASSERT_TRUE(db->begin(false, txn).ok());
+    ASSERT_TRUE(txn->rollback().ok());
+    delete txn;
+  }
+
+  void TearDown() override { delete db; }
+
+  DB* db;
+};
+
+TEST_F(MetricsTest, Render) {
+  string text = render_metrics(*db);
+
+  EXPECT_NE(string::npos, text.find("# TYPE boltdb_read_txns_total counter\nboltdb_read_txns_total 1\n"));
+  EXPECT_NE(string::npos, text.find("\nboltdb_open_read_txns 0\n"));
+  EXPECT_NE(string::npos, text.find("# TYPE boltdb_commit_duration_seconds histogram\n"));
+  EXPECT_NE(string::npos, text.find("\nboltdb_commit_duration_seconds_bucket{le=\"+Inf\"} 3\n"));
+  EXPECT_NE(string::npos, text.find("\nboltdb_commit_duration_seconds_count 3\n"));
+  EXPECT_NE(string::npos, text.find("\nboltdb_commit_duration_seconds_quantile{quantile=\"0.999\"} "));
+  EXPECT_NE(string::npos, text.find("\nboltdb_read_txn_duration_seconds_count 1\n"));
+  EXPECT_NE(string::npos, text.find("\nboltdb_memory_pool_outstanding_bytes "));
+  EXPECT_EQ(string::npos, text.find("boltdb_write_bytes_total 0\n"));
+
+  // Every line is a comment or a sample.
+  for (std::size_t pos = 0; pos < text.size();) {
+    std::size_t end = text.find('\n', pos);
+    ASSERT_NE(string::npos, end);
+
+    string line = text.substr(pos, end - pos);
+    EXPECT_TRUE(line.starts_with("# HELP boltdb_") || line.starts_with("# TYPE boltdb_") ||
+                (line.starts_with("boltdb_") && line.find(' ') != string::npos))
+        << line;
+
+    pos = end + 1;
+  }
+}
+
+TEST_F(MetricsTest, RenderDoesNotAllocate) {
+  vector<char> buffer(256 * 1024);
+
+  int before = allocations;
+  std::size_t size = render_metrics(*db, buffer);
+  EXPECT_EQ(before, allocations);
+
+  // A short buffer gets the start of the text and its full size.
+  vector<char> small(100);
+  EXPECT_EQ(size, render_metrics(*db, small));
+  EXPECT_EQ(string(buffer.data(), 100), string(small.data(), 100));
+}
+
+TEST_F(MetricsTest, Server) {
+  MetricsServer server(db);
+  ASSERT_TRUE(server.start(0).ok());
+  ASSERT_GT(server.port(), 0);
+
+  // Scrape twice, requests are served one after the other.
+  for (int i = 0; i < 2; i++) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(fd, 0);
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<u16>(server.port()));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(0, ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+
+    string request = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ASSERT_EQ(static_cast<ssize_t>(request.size()), ::write(fd, request.data(), request.size()));
+
+    string response;
+    char buffer[4096];
+
+    for (ssize_t n; (n = ::read(fd, buffer, sizeof(buffer))) > 0;) {
+      response.append(buffer, n);
+    }
+
+    ::close(fd);
+
+    EXPECT_TRUE(response.starts_with("HTTP/1.0 200 OK\r\n"));
+    EXPECT_NE(string::npos, response.find("\nboltdb_commit_duration_seconds_count 3\n"));
+    EXPECT_TRUE(response.ends_with("\n"));
+  }
+
+  server.stop();
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <string>
+
+#include "boltdb/db/db.hpp"
+#include "boltdb/page/page.hpp"
+#include "boltdb/util/options.hpp"
+
+using namespace std;
+using namespace boltdb;
+
+// Open and close a small database, like a process opening many of them at
+// startup.
+static void BM_open(benchmark::State& state) {
+  string path = "/tmp/open_benchmark.db";
+  std::remove(path.c_str());
+
+  Options options = Options{}.set_page_size(static_cast<int>(state.range(0)));
+
+  DB* db;
+  open_db(path, options, &db);
+
+  // A few commits so that both meta pages are in use.
+  for (int i = 0; i < 3; i++) {
+    Txn* txn;
+    Page* page;
+    db->begin(true, txn);
+    txn->allocate(1, page);
+    page->set_flag(PageFlag::kLeaf);
+    txn->set_root({.root = page->id(), .sequence = 0});
+    txn->commit();
+    delete txn;
+  }
+
+  delete db;
+
+  for (auto _ : state) {
+    if (!open_db(path, options, &db).ok()) {
+      state.SkipWithError("open failed");
+      break;
+    }
+
+    delete db;
+  }
+
+  std::remove(path.c_str());
+}
+
+BENCHMARK(BM_open)->RangeMultiplier(8)->Range(DB::kMinPageSize, DB::kMaxPageSize);
+
+BENCHMARK_MAIN();
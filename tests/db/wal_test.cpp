@@ -0,0 +1,300 @@
+#include "boltdb/db/wal.hpp"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../fs/test_util.hpp"
+#include "boltdb/db/bulk_loader.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/fs/file_system.hpp"
+#include "boltdb/page/page.hpp"
+#include "boltdb/util/options.hpp"
+#include "boltdb/util/util.hpp"
+
+using namespace boltdb;
+using namespace std;
+
+// FailSyncFileHandle forwards everything to a real file, except that its
+// syncs fail once fail_syncs() is called.
+class FailSyncFileHandle final : public FileHandle {
+ public:
+  explicit FailSyncFileHandle(std::unique_ptr<FileHandle> file) : FileHandle(file->path), file_(std::move(file)) {}
+
+  ssize_t read(void* out_buffer, std::size_t nbytes, std::size_t offset) override {
+    return file_->read(out_buffer, nbytes, offset);
+  }
+
+  ssize_t write(const void* in_buffer, std::size_t nbytes, std::size_t offset) override {
+    return file_->write(in_buffer, nbytes, offset);
+  }
+
+  void close() override { file_->close(); }
+
+  int fd() const override { return file_->fd(); }
+
+  Status fdatasync() override { return fail_ ? Status{kStatusErr, "fdatasync: injected failure"} : file_->fdatasync(); }
+
+  Status fsync() override { return fail_ ? Status{kStatusErr, "fsync: injected failure"} : file_->fsync(); }
+
+  Status allocate(std::size_t offset, std::size_t nbytes) override { return file_->allocate(offset, nbytes); }
+
+  Status truncate(std::size_t size) override { return file_->truncate(size); }
+
+  Status flock(int operation, double timeout_s) override { return file_->flock(operation, timeout_s); }
+
+  void fail_syncs() { fail_ = true; }
+
+ private:
+  std::unique_ptr<FileHandle> file_;
+  bool fail_{};
+};
+
+class WalTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::remove(path.c_str());
+    std::remove(Wal::path_of(path).c_str());
+  }
+
+  void TearDown() override {
+    std::remove(path.c_str());
+    std::remove(Wal::path_of(path).c_str());
+  }
+
+  // Run `fn` on the database in a child process that exits without closing
+  // it, so the log is not checkpointed, like after a crash.
+  void crash_after(const std::function<void(DB*)>& fn) {
+    pid_t pid = fork();
+
+    if (pid == 0) {
+      DB* db;
+
+      if (!open_db(path, options, &db).ok()) {
+        _exit(1);
+      }
+
+      fn(db);
+      _exit(::testing::Test::HasFailure() ? 1 : 0);
+    }
+
+    int status;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(0, WEXITSTATUS(status));
+  }
+
+  string path = "/tmp/wal_test.db";
+  Options options = Options{}.set_wal(true).set_wal_checkpoint_size(0);
+};
+
+TEST_F(WalTest, CommitAndReopen) {
+  DB* db;
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  ASSERT_NE(nullptr, db->wal());
+
+  ASSERT_TRUE(load(db, 1000, "a").ok());
+  ASSERT_TRUE(load(db, 2000, "b").ok());
+  EXPECT_GT(db->wal()->size(), 0);
+
+  vector<string> expected = dump(db);
+  EXPECT_EQ(2000, expected.size());
+
+  // Closing checkpoints the log.
+  delete db;
+  EXPECT_EQ(0, std::filesystem::file_size(Wal::path_of(path)));
+
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  EXPECT_EQ(0, db->wal()->replayed_count());
+  EXPECT_EQ(expected, dump(db));
+  delete db;
+}
+
+TEST_F(WalTest, Recover) {
+  DB* db;
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  ASSERT_TRUE(load(db, 1000, "a").ok());
+  delete db;
+
+  // Commit in a child that "crashes", then throw away everything it wrote to
+  // the data file, as if it never left the page cache.
+  string data_file = read_file(path);
+
+  crash_after([](DB* db) {
+    ASSERT_TRUE(load(db, 3000, "b").ok());
+    ASSERT_TRUE(load(db, 500, "c").ok());
+  });
+
+  write_file(path, data_file);
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  EXPECT_EQ(2, db->wal()->replayed_count());
+
+  vector<string> keys = dump(db);
+  ASSERT_EQ(500, keys.size());
+  EXPECT_EQ("key00000000=value00000000c", keys[0]);
+
+  // The database keeps working after the recovery.
+  ASSERT_TRUE(load(db, 10, "d").ok());
+  EXPECT_EQ(10, dump(db).size());
+  delete db;
+}
+
+TEST_F(WalTest, TornRecord) {
+  DB* db;
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  ASSERT_TRUE(load(db, 1000, "a").ok());
+  delete db;
+
+  string data_file = read_file(path);
+  string size_path = path + ".size";
+
+  crash_after([&](DB* db) {
+    ASSERT_TRUE(load(db, 2000, "b").ok());
+    ASSERT_TRUE(load(db, 3000, "c").ok());
+    write_file(size_path, to_string(db->wal()->size()));
+  });
+
+  // Cut the last record short, it was not durable when the process died.
+  i64 size = stoll(read_file(size_path));
+  std::remove(size_path.c_str());
+  std::filesystem::resize_file(Wal::path_of(path), size - 100);
+  write_file(path, data_file);
+
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  EXPECT_EQ(1, db->wal()->replayed_count());
+
+  vector<string> keys = dump(db);
+  ASSERT_EQ(2000, keys.size());
+  EXPECT_EQ("key00000000=value00000000b", keys[0]);
+  delete db;
+}
+
+TEST_F(WalTest, BackgroundCheckpoint) {
+  DB* db;
+  ASSERT_TRUE(open_db(path, options.set_wal_checkpoint_size(64 * 1024), &db).ok());
+
+  for (int i = 0; i < 20; i++) {
+    ASSERT_TRUE(load(db, 1000, to_string(i)).ok());
+  }
+
+  // The checkpointer runs on its own thread, give it some time.
+  for (int i = 0; i < 100 && db->wal()->checkpoint_count() == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  EXPECT_GT(db->wal()->checkpoint_count(), 0);
+  EXPECT_LT(db->wal()->size(), 20 * 64 * 1024);
+
+  vector<string> expected = dump(db);
+  delete db;
+
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  EXPECT_EQ(expected, dump(db));
+  delete db;
+}
+
+TEST_F(WalTest, RecoverAfterCheckpoints) {
+  options.set_wal_checkpoint_size(64 * 1024);
+
+  // The log is reused in place after each checkpoint, the records left over
+  // from before must not be replayed.
+  crash_after([](DB* db) {
+    for (int i = 0; i < 20; i++) {
+      ASSERT_TRUE(load(db, 1000 + i * 100, to_string(i)).ok());
+    }
+  });
+
+  DB* db;
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+
+  vector<string> keys = dump(db);
+  ASSERT_EQ(2900, keys.size());
+  EXPECT_EQ("key00000000=value0000000019", keys[0]);
+  delete db;
+}
+
+TEST_F(WalTest, StaleLog) {
+  DB* db;
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  ASSERT_TRUE(load(db, 1000, "a").ok());
+  ASSERT_TRUE(load(db, 2000, "b").ok());
+
+  // Keep the log as it was before closing checkpoints it.
+  string log = read_file(Wal::path_of(path));
+  vector<string> expected = dump(db);
+  delete db;
+
+  // As if the checkpoint synced the data file but didn't get to empty the
+  // log. The data file already holds every record.
+  write_file(Wal::path_of(path), log);
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  EXPECT_EQ(0, db->wal()->replayed_count());
+  EXPECT_EQ(expected, dump(db));
+  delete db;
+
+  // Commit more without the log.
+  ASSERT_TRUE(open_db(path, Options{}, &db).ok());
+  ASSERT_TRUE(load(db, 500, "c").ok());
+  ASSERT_TRUE(load(db, 300, "d").ok());
+  expected = dump(db);
+  delete db;
+
+  // The old log is back. It can't be ignored without the log option...
+  write_file(Wal::path_of(path), log);
+  EXPECT_FALSE(open_db(path, Options{}, &db).ok());
+
+  // ...and it's older than the data file, so it's discarded, not replayed.
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  EXPECT_EQ(0, db->wal()->replayed_count());
+  EXPECT_EQ(expected, dump(db));
+  delete db;
+
+  ASSERT_TRUE(open_db(path, Options{}, &db).ok());
+  EXPECT_EQ(expected, dump(db));
+  delete db;
+}
+
+TEST_F(WalTest, SyncFailure) {
+  auto data_file = FileSystem::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  auto log_file = FileSystem::open(Wal::path_of(path).c_str(), O_RDWR | O_CREAT, 0644);
+  ASSERT_NE(nullptr, data_file);
+  ASSERT_NE(nullptr, log_file);
+
+  auto fail_sync = std::make_unique<FailSyncFileHandle>(std::move(log_file));
+  FailSyncFileHandle* handle = fail_sync.get();
+  std::unique_ptr<Wal> wal;
+  ASSERT_TRUE(Wal::open(std::move(fail_sync), data_file.get(), nullptr, 0, false, wal).ok());
+
+  handle->fail_syncs();
+
+  Meta meta{};
+  meta.txid = 2;
+  bool applied = false;
+  Status status = wal->append(meta, {}, 4096, [&]() -> Status {
+    applied = true;
+    return {};
+  });
+
+  EXPECT_FALSE(status.ok());
+  EXPECT_FALSE(applied);
+  EXPECT_EQ(0, wal->size());
+
+  // The record was written in full before the sync failed, it must not be
+  // replayed as a commit that the caller was told failed.
+  EXPECT_FALSE(Wal::has_records(path));
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
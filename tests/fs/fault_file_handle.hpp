@@ -0,0 +1,260 @@
+#ifndef BOLTDB_CPP_TESTS_FS_FAULT_FILE_HANDLE_HPP_
+#define BOLTDB_CPP_TESTS_FS_FAULT_FILE_HANDLE_HPP_
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "boltdb/fs/file_system.hpp"
+#include "boltdb/util/common.hpp"
+#include "boltdb/util/exception.hpp"
+#include "boltdb/util/status.hpp"
+#include "boltdb/util/types.hpp"
+
+namespace boltdb {
+
+class FaultFileHandle;
+
+// FaultDisk holds the files that lose power together. The `crash_at`-th sync
+// issued on any of them crashes all of them, see FaultFileHandle.
+class FaultDisk {
+ public:
+  explicit FaultDisk(int crash_at) : crash_at_(crash_at) {}
+
+  DISALLOW_COPY_AND_ASSIGN(FaultDisk);
+
+  // Lose power now.
+  void crash();
+
+  // Get the number of syncs issued, including the one that crashed.
+  int sync_count() const { return sync_count_; }
+
+ private:
+  friend class FaultFileHandle;
+
+  int crash_at_;
+  int sync_count_{};
+  std::vector<FaultFileHandle*> files_;  // Not owned
+};
+
+// FaultFileHandle forwards everything to a real file, so the file can still be
+// mmapped through fd(), and keeps track of what a power failure would leave
+// on disk: a durable image, updated on every sync, plus the writes and size
+// changes issued since the last one.
+//
+// The `crash_at`-th sync (counting from 1) does not complete: the handle
+// crashes and fails every later write and sync. crash_image() is then the
+// durable image plus a random subset of the pending operations, where a write
+// can also be torn at sector boundaries. A `crash_at` of 0 never crashes on
+// its own, call crash() to crash at any other point.
+//
+// Handles on the same FaultDisk count their syncs together and crash together,
+// like the data file and the write-ahead log of a database losing power.
+class FaultFileHandle final : public FileHandle {
+ public:
+  static constexpr std::size_t kSectorSize = 512;
+
+  FaultFileHandle(std::unique_ptr<FileHandle> file, int crash_at, u32 seed)
+      : FaultFileHandle(std::move(file), std::make_shared<FaultDisk>(crash_at), seed) {}
+
+  FaultFileHandle(std::unique_ptr<FileHandle> file, std::shared_ptr<FaultDisk> disk, u32 seed)
+      : FileHandle(file->path), file_(std::move(file)), disk_(std::move(disk)), random_(seed) {
+    durable_.resize(FileSystem::file_size(*file_));
+    file_->read(durable_.data(), durable_.size(), 0);
+    disk_->files_.push_back(this);
+  }
+
+  ~FaultFileHandle() override { std::erase(disk_->files_, this); }
+
+  DISALLOW_COPY_AND_ASSIGN(FaultFileHandle);
+
+  ssize_t read(void* out_buffer, std::size_t nbytes, std::size_t offset) override {
+    return file_->read(out_buffer, nbytes, offset);
+  }
+
+  ssize_t write(const void* in_buffer, std::size_t nbytes, std::size_t offset) override {
+    if (crashed_) {
+      throw IOException("write after crash");
+    }
+
+    pending_.push_back(Write{offset, std::string(static_cast<const char*>(in_buffer), nbytes)});
+
+    return file_->write(in_buffer, nbytes, offset);
+  }
+
+  void close() override { file_->close(); }
+
+  int fd() const override { return file_->fd(); }
+
+  Status fdatasync() override { return sync(); }
+
+  Status fsync() override { return sync(); }
+
+  Status allocate(std::size_t offset, std::size_t nbytes) override {
+    if (crashed_) {
+      return {kStatusErr, "allocate after crash"};
+    }
+
+    Status status = file_->allocate(offset, nbytes);
+
+    if (status.ok()) {
+      pending_.push_back(Resize{offset + nbytes, true});
+    }
+
+    return status;
+  }
+
+  Status truncate(std::size_t size) override {
+    if (crashed_) {
+      return {kStatusErr, "truncate after crash"};
+    }
+
+    Status status = file_->truncate(size);
+
+    if (status.ok()) {
+      pending_.push_back(Resize{size, false});
+    }
+
+    return status;
+  }
+
+  Status flock(int operation, double timeout_s) override { return file_->flock(operation, timeout_s); }
+
+  // Lose power now, on every file of the disk.
+  void crash();
+
+  // Get the content of the file after the crash.
+  const std::string& crash_image() const { return image_; }
+
+  // Get the number of syncs issued on the disk, including the one that
+  // crashed.
+  int sync_count() const;
+
+  bool crashed() const { return crashed_; }
+
+ private:
+  friend class FaultDisk;
+
+  struct Write {
+    std::size_t offset;
+    std::string data;
+  };
+
+  // `grow_only` is set for allocate(), which never shrinks the file.
+  struct Resize {
+    std::size_t size;
+    bool grow_only;
+  };
+
+  using Op = std::variant<Write, Resize>;
+
+  // Every pending operation independently makes it to disk or not, and a
+  // write that makes it may only have some of its sectors written.
+  void lose_power() {
+    if (crashed_) {
+      return;
+    }
+
+    crashed_ = true;
+    image_ = durable_;
+
+    for (auto&& op : pending_) {
+      int fate = static_cast<int>(random_() % 3);
+
+      if (fate == 0) {
+        continue;
+      }
+
+      if (auto* resize = std::get_if<Resize>(&op)) {
+        apply(image_, *resize);
+        continue;
+      }
+
+      auto& write = std::get<Write>(op);
+
+      if (fate == 1) {
+        apply(image_, write);
+        continue;
+      }
+
+      // Torn write: keep a random subset of the sectors it touches.
+      std::size_t end = write.offset + write.data.size();
+
+      for (std::size_t pos = write.offset; pos < end;) {
+        std::size_t next = std::min(end, (pos / kSectorSize + 1) * kSectorSize);
+
+        if (random_() % 2 == 0) {
+          apply(image_, Write{pos, write.data.substr(pos - write.offset, next - pos)});
+        }
+
+        pos = next;
+      }
+    }
+
+    pending_.clear();
+  }
+
+  static void apply(std::string& image, const Write& write) {
+    if (image.size() < write.offset + write.data.size()) {
+      image.resize(write.offset + write.data.size());
+    }
+
+    std::memcpy(image.data() + write.offset, write.data.data(), write.data.size());
+  }
+
+  static void apply(std::string& image, const Resize& resize) {
+    if (!resize.grow_only || image.size() < resize.size) {
+      image.resize(resize.size);
+    }
+  }
+
+  // The data only has to be durable in the image, the real file is thrown
+  // away by the test, so there's no need to pay for a real sync.
+  Status sync();
+
+  std::unique_ptr<FileHandle> file_;
+  std::shared_ptr<FaultDisk> disk_;
+  std::mt19937 random_;
+  bool crashed_{};
+  std::string durable_;
+  std::string image_;
+  std::vector<Op> pending_;
+};
+
+inline void FaultFileHandle::crash() { disk_->crash(); }
+
+inline int FaultFileHandle::sync_count() const { return disk_->sync_count(); }
+
+inline Status FaultFileHandle::sync() {
+  if (crashed_) {
+    return {kStatusErr, "sync after crash"};
+  }
+
+  if (++disk_->sync_count_ == disk_->crash_at_) {
+    disk_->crash();
+    return {kStatusErr, "crash"};
+  }
+
+  for (auto&& op : pending_) {
+    std::visit([this](auto&& op) { apply(durable_, op); }, op);
+  }
+
+  pending_.clear();
+
+  return {};
+}
+
+inline void FaultDisk::crash() {
+  for (FaultFileHandle* file : files_) {
+    file->lose_power();
+  }
+}
+
+}  // namespace boltdb
+
+#endif  // BOLTDB_CPP_TESTS_FS_FAULT_FILE_HANDLE_HPP_
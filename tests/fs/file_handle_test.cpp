@@ -29,6 +29,29 @@ TEST(FileHandleTest, DoubleFlock) {
   EXPECT_EQ(boltdb::StatusType::kStatusOK, status.status_type());
 }
 
+TEST(FileHandleTest, Memory) {
+  auto handle = boltdb::FileSystem::create_memory("file_handle_test");
+
+  ASSERT_TRUE(handle != nullptr);
+  EXPECT_TRUE(handle->in_memory());
+  EXPECT_TRUE(boltdb::FileSystem::exists(*handle));
+  EXPECT_EQ(0, boltdb::FileSystem::file_size(*handle));
+
+  EXPECT_EQ(5, handle->write("hello", 5, 4096));
+  EXPECT_EQ(4101, boltdb::FileSystem::file_size(*handle));
+  EXPECT_TRUE(handle->fdatasync().ok());
+  EXPECT_TRUE(handle->flock(LOCK_EX, 0).ok());
+
+  char buffer[5];
+  EXPECT_EQ(5, handle->read(buffer, 5, 4096));
+  EXPECT_EQ("hello", std::string(buffer, 5));
+
+  EXPECT_TRUE(handle->allocate(0, 8192).ok());
+  EXPECT_EQ(8192, boltdb::FileSystem::file_size(*handle));
+  EXPECT_TRUE(handle->truncate(0).ok());
+  EXPECT_EQ(0, boltdb::FileSystem::file_size(*handle));
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
 
@@ -0,0 +1,115 @@
+#ifndef BOLTDB_CPP_TESTS_FS_TEST_UTIL_HPP_
+#define BOLTDB_CPP_TESTS_FS_TEST_UTIL_HPP_
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "boltdb/db/bulk_loader.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/page/page.hpp"
+#include "boltdb/transaction/txn.hpp"
+#include "boltdb/util/status.hpp"
+#include "boltdb/util/types.hpp"
+#include "boltdb/util/util.hpp"
+
+namespace boltdb {
+
+// Helpers shared by the tests that build, back up and recover databases.
+
+inline std::span<const Byte> bytes(const std::string& s) { return {s.data(), s.size()}; }
+
+// Collect "key=value" strings for every key of the tree rooted at `pgid`.
+inline void dump(Txn* txn, PageID pgid, std::vector<std::string>& out) {
+  Page page = txn->page(pgid);
+
+  if ((page.flag() & PageFlag::kBranch) != 0) {
+    for (auto&& element : page.branch_page_elements()) {
+      dump(txn, element.pgid, out);
+    }
+
+    return;
+  }
+
+  for (auto&& element : page.leaf_page_elements()) {
+    out.push_back(element.key().to_string() + "=" + element.value().to_string());
+  }
+}
+
+// Collect "key=value" strings for every key of the root tree, as seen by a
+// new read transaction.
+inline std::vector<std::string> dump(DB* db) {
+  Txn* txn;
+  std::vector<std::string> out;
+
+  if (!db->begin(false, txn).ok()) {
+    ADD_FAILURE() << "dump: could not begin a read transaction";
+    return out;
+  }
+
+  if (txn->root().root != 0) {
+    dump(txn, txn->root().root, out);
+  }
+
+  EXPECT_TRUE(txn->rollback().ok());
+  delete txn;
+
+  return out;
+}
+
+inline std::string read_file(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+
+  return ss.str();
+}
+
+inline void write_file(const std::string& path, const std::string& data) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << data;
+}
+
+// Replace the content of the database with `n` keys "key%08d" whose values
+// are "value%08d" followed by `suffix`. Return the status of the commit.
+inline Status load(DB* db, int n, const std::string& suffix) {
+  Txn* txn;
+
+  if (Status status = db->begin(true, txn); !status.ok()) {
+    return status;
+  }
+
+  BucketMeta root{};
+  BulkLoader loader(txn);
+  Status status;
+
+  for (int i = 0; i < n && status.ok(); i++) {
+    status = loader.add(bytes(format("key%08d", i)), bytes(format("value%08d", i) + suffix));
+  }
+
+  if (status.ok()) {
+    status = loader.finish(root);
+  }
+
+  if (status.ok()) {
+    status = txn->set_root(root);
+  }
+
+  if (status.ok()) {
+    status = txn->commit();
+  } else {
+    txn->rollback();
+  }
+
+  delete txn;
+
+  return status;
+}
+
+}  // namespace boltdb
+
+#endif  // BOLTDB_CPP_TESTS_FS_TEST_UTIL_HPP_
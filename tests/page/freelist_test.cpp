@@ -102,6 +102,25 @@ TEST(FreeListTest, AllocateContiguous) {
   }
 }
 
+TEST(FreeListTest, Trim) {
+  FreeList freelist({3, 5, 6, 7, 8});
+
+  // The run doesn't end at the high water mark.
+  EXPECT_EQ(10, freelist.trim(10, 1));
+
+  // The run is too short.
+  EXPECT_EQ(9, freelist.trim(9, 5));
+  EXPECT_EQ(5, freelist.free_count());
+
+  EXPECT_EQ(5, freelist.trim(9, 4));
+  EXPECT_EQ(1, freelist.free_count());
+
+  // Page 3 is not right below the new high water mark.
+  EXPECT_EQ(5, freelist.trim(5, 1));
+  EXPECT_EQ(3, freelist.trim(4, 1));
+  EXPECT_EQ(0, freelist.free_count());
+}
+
 TEST(FreeListTest, Read) {
   // Create a page.
   Page page = make_page(100);
@@ -0,0 +1,399 @@
+#include "boltdb/page/node.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "boltdb/db/bucket.hpp"
+#include "boltdb/db/bulk_loader.hpp"
+#include "boltdb/db/cursor.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/util/options.hpp"
+#include "boltdb/util/util.hpp"
+
+using namespace boltdb;
+using namespace std;
+
+// Spill a single leaf of `n` keys into a fresh database and return the bytes
+// of the resulting file.
+static vector<char> spill_keys(const string& path, int spill_threads, int n, TxnStats& stats) {
+  DB* db;
+  std::remove(path.c_str());
+
+  Status status = open_db(path, Options{}.set_spill_threads(spill_threads), &db);
+  EXPECT_TRUE(status.ok()) << status;
+
+  Txn* txn;
+  EXPECT_TRUE(db->begin(true, txn).ok());
+
+  Bucket bucket(txn);
+  Node root(0, &bucket, nullptr);
+  root.read(Page(0, PageFlag::kLeaf, db->page_size()));
+
+  for (int i = 0; i < n; i++) {
+    ByteSlice key(format("key%08d", i));
+    root.put(key, key, ByteSlice(format("value%08d", i)), 0, 0);
+  }
+
+  status = root.spill();
+  EXPECT_TRUE(status.ok()) << status;
+
+  stats = txn->stats;
+  EXPECT_TRUE(txn->commit().ok());
+
+  delete txn;
+  delete db;
+
+  ifstream ifs(path, ios::binary);
+
+  return {istreambuf_iterator<char>(ifs), istreambuf_iterator<char>()};
+}
+
+TEST(NodeTest, ParallelSpillMatchesSequential) {
+  TxnStats sequential_stats;
+  TxnStats parallel_stats;
+
+  vector<char> sequential = spill_keys("/tmp/spill_sequential.db", 0, 20000, sequential_stats);
+  vector<char> parallel = spill_keys("/tmp/spill_parallel.db", 4, 20000, parallel_stats);
+
+  // The tree has more than two levels, so the new roots were spilled too.
+  EXPECT_GT(sequential_stats.spill, 100);
+  EXPECT_GT(sequential_stats.split, 100);
+  EXPECT_EQ(sequential_stats.spill, parallel_stats.spill);
+  EXPECT_EQ(sequential_stats.page_count, parallel_stats.page_count);
+
+  ASSERT_FALSE(sequential.empty());
+  EXPECT_TRUE(sequential == parallel);
+}
+
+// Sum the serialized size of the inodes the slow way.
+static int inode_byte_size(const Node& node) {
+  int size = kPageHeaderSize;
+
+  for (auto&& inode : node.inodes()) {
+    size += node.page_element_size() + inode.key.size() + inode.value.size();
+  }
+
+  return size;
+}
+
+TEST(NodeTest, ByteSizeTracksChanges) {
+  DB* db;
+  ASSERT_TRUE(open_memory_db("node_test", Options{}, &db).ok());
+
+  Txn* txn;
+  ASSERT_TRUE(db->begin(true, txn).ok());
+
+  Bucket bucket(txn);
+  Node node(0, &bucket, nullptr);
+  node.read(Page(0, PageFlag::kLeaf, db->page_size()));
+  EXPECT_EQ(kPageHeaderSize, node.byte_size());
+
+  for (int i = 0; i < 400; i++) {
+    ByteSlice key(format("key%04d", i));
+    node.put(key, key, ByteSlice(format("value%d", i)), 0, 0);
+  }
+
+  EXPECT_EQ(inode_byte_size(node), node.byte_size());
+
+  // Overwrite with longer and shorter values, then remove some keys.
+  for (int i = 0; i < 400; i += 3) {
+    ByteSlice key(format("key%04d", i));
+    node.put(key, key, ByteSlice(i % 2 == 0 ? string(100, 'x') : string()), 0, 0);
+  }
+
+  for (int i = 0; i < 400; i += 7) {
+    node.remove(ByteSlice(format("key%04d", i)));
+  }
+
+  node.remove(ByteSlice("missing"));
+
+  EXPECT_EQ(inode_byte_size(node), node.byte_size());
+  EXPECT_FALSE(node.is_size_less_than(node.byte_size()));
+  EXPECT_TRUE(node.is_size_less_than(node.byte_size() + 1));
+
+  ASSERT_TRUE(txn->rollback().ok());
+  delete txn;
+  delete db;
+}
+
+// Spill `keys` inserted in order into a single leaf, and return the stats.
+static TxnStats spill_in_order(const vector<string>& keys, bool& append_mode) {
+  DB* db;
+  EXPECT_TRUE(open_memory_db("node_test", Options{}, &db).ok());
+
+  Txn* txn;
+  EXPECT_TRUE(db->begin(true, txn).ok());
+
+  Bucket bucket(txn);
+  Node root(0, &bucket, nullptr);
+  root.read(Page(0, PageFlag::kLeaf, db->page_size()));
+
+  for (auto&& k : keys) {
+    ByteSlice key(k);
+    root.put(key, key, ByteSlice(string(32, 'v')), 0, 0);
+  }
+
+  append_mode = bucket.append_mode();
+  EXPECT_TRUE(root.spill().ok());
+
+  TxnStats stats = txn->stats;
+  EXPECT_TRUE(txn->rollback().ok());
+
+  delete txn;
+  delete db;
+
+  return stats;
+}
+
+TEST(NodeTest, AppendSplitFillsPages) {
+  vector<string> keys;
+
+  for (int i = 0; i < 5000; i++) {
+    keys.push_back(format("ts%016d", i));
+  }
+
+  bool append_mode;
+  TxnStats appended = spill_in_order(keys, append_mode);
+  EXPECT_TRUE(append_mode);
+  EXPECT_GT(appended.append_split, 0);
+  EXPECT_GT(appended.spill_fill_ratio(), 0.95);
+
+  // The same keys in random order split at the default fill percent.
+  std::mt19937 random(1);
+  std::shuffle(keys.begin(), keys.end(), random);
+
+  TxnStats shuffled = spill_in_order(keys, append_mode);
+  EXPECT_FALSE(append_mode);
+  EXPECT_EQ(0, shuffled.append_split);
+  EXPECT_LT(shuffled.spill_fill_ratio(), 0.6);
+  EXPECT_LT(appended.page_count * 3 / 2, shuffled.page_count);
+}
+
+TEST(NodeTest, AppendModeNeedsARun) {
+  DB* db;
+  ASSERT_TRUE(open_memory_db("node_test", Options{}, &db).ok());
+
+  Txn* txn;
+  ASSERT_TRUE(db->begin(true, txn).ok());
+
+  Bucket bucket(txn);
+  Node root(0, &bucket, nullptr);
+  root.read(Page(0, PageFlag::kLeaf, db->page_size()));
+
+  for (int i = 1; i < Bucket::kAppendRunLength; i++) {
+    ByteSlice key(format("key%04d", i * 2));
+    root.put(key, key, ByteSlice("v"), 0, 0);
+  }
+
+  EXPECT_FALSE(bucket.append_mode());
+
+  // Overwriting a key doesn't count as an insert.
+  root.put(ByteSlice("key0002"), ByteSlice("key0002"), ByteSlice("w"), 0, 0);
+  EXPECT_FALSE(bucket.append_mode());
+
+  root.put(ByteSlice("key9999"), ByteSlice("key9999"), ByteSlice("v"), 0, 0);
+  EXPECT_TRUE(bucket.append_mode());
+
+  // A key in the middle ends the run.
+  root.put(ByteSlice("key0001"), ByteSlice("key0001"), ByteSlice("v"), 0, 0);
+  EXPECT_FALSE(bucket.append_mode());
+
+  ASSERT_TRUE(txn->rollback().ok());
+  delete txn;
+  delete db;
+}
+
+// Remove all the keys of the subtree but one in ten.
+static void purge(Node* node) {
+  if (!node->is_leaf()) {
+    for (int i = 0; i < node->num_children(); i++) {
+      purge(node->child_at(i));
+    }
+
+    return;
+  }
+
+  vector<ByteSlice> keys;
+
+  for (auto&& inode : node->inodes()) {
+    keys.push_back(inode.key);
+  }
+
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    if (keys[i].to_string().back() != '0') {
+      node->remove(keys[i]);
+    }
+  }
+}
+
+// Load 20000 keys, purge 90% of them with the given merge percent and
+// spill. Return the stats of the purge.
+static TxnStats purge_and_spill(f64 merge_percent) {
+  DB* db;
+  EXPECT_TRUE(open_memory_db("node_test", Options{}, &db).ok());
+
+  Txn* txn;
+  EXPECT_TRUE(db->begin(true, txn).ok());
+
+  BucketMeta meta{};
+  BulkLoader loader(txn);
+
+  for (int i = 0; i < 20000; i++) {
+    string key = format("key%08d", i);
+    EXPECT_TRUE(loader.add({key.data(), key.size()}, {key.data(), key.size()}).ok());
+  }
+
+  EXPECT_TRUE(loader.finish(meta).ok());
+  EXPECT_TRUE(txn->set_root(meta).ok());
+  EXPECT_TRUE(txn->commit().ok());
+  delete txn;
+
+  EXPECT_TRUE(db->begin(true, txn).ok());
+  TxnStats stats;
+
+  {
+    Bucket bucket(txn, txn->root());
+    bucket.set_merge_percent(merge_percent);
+
+    Node* root;
+    bucket.node(bucket.root(), nullptr, root);
+    purge(root);
+
+    TxnStats before = txn->stats;
+    bucket.rebalance();
+
+    // The merged nodes hold the remaining keys.
+    auto cursor = bucket.cursor();
+    int i = 0;
+
+    for (auto key = cursor->first().first; key.data() != nullptr; key = cursor->next().first, i += 10) {
+      EXPECT_EQ(format("key%08d", i), string(key.data(), key.size()));
+    }
+
+    EXPECT_EQ(20000, i);
+
+    // Write them, the root may split again.
+    EXPECT_TRUE(root->spill().ok());
+    stats = txn->stats - before;
+  }
+
+  EXPECT_TRUE(txn->rollback().ok());
+  delete txn;
+  delete db;
+
+  return stats;
+}
+
+TEST(NodeTest, RebalanceMergesAfterPurge) {
+  // Without a merge threshold, only nodes left with too few keys are merged.
+  TxnStats sparse = purge_and_spill(0);
+  TxnStats merged = purge_and_spill(Bucket::kDefaultMergePercent);
+
+  EXPECT_GT(merged.rebalance, 0);
+  EXPECT_GT(merged.rebalance_time.count(), 0);
+  EXPECT_LT(merged.spill * 3, sparse.spill);
+  EXPECT_GT(merged.spill_fill_ratio(), sparse.spill_fill_ratio() * 3);
+}
+
+// Keep the first 10 keys of the first leaf of a tree of 2000 keys and
+// rebalance with the given merge percent. Return true if the leaf was merged
+// with its sibling.
+static bool merge_first_leaf(f64 merge_percent) {
+  DB* db;
+  EXPECT_TRUE(open_memory_db("node_test", Options{}, &db).ok());
+
+  Txn* txn;
+  EXPECT_TRUE(db->begin(true, txn).ok());
+
+  BucketMeta meta{};
+  BulkLoader loader(txn);
+
+  for (int i = 0; i < 2000; i++) {
+    string key = format("key%08d", i);
+    EXPECT_TRUE(loader.add({key.data(), key.size()}, {key.data(), key.size()}).ok());
+  }
+
+  EXPECT_TRUE(loader.finish(meta).ok());
+  EXPECT_TRUE(txn->set_root(meta).ok());
+  EXPECT_TRUE(txn->commit().ok());
+  delete txn;
+
+  EXPECT_TRUE(db->begin(true, txn).ok());
+  Bucket* bucket = txn->root_bucket();
+  bucket->set_merge_percent(merge_percent);
+
+  Node* root;
+  bucket->node(bucket->root(), nullptr, root);
+  int children = root->num_children();
+  Node* leaf = root->child_at(0);
+  Node* sibling = root->child_at(1);
+  PageID sibling_pgid = sibling->pgid();
+
+  vector<ByteSlice> keys;
+
+  for (auto&& inode : leaf->inodes()) {
+    keys.push_back(inode.key);
+  }
+
+  for (std::size_t i = 10; i < keys.size(); i++) {
+    leaf->remove(keys[i]);
+  }
+
+  // The leaf is well below the merge threshold, but has more than enough keys.
+  EXPECT_GT(static_cast<int>(leaf->inodes().size()), leaf->min_keys());
+  EXPECT_LT(leaf->byte_size(), db->page_size() * Bucket::kDefaultMergePercent);
+
+  bucket->rebalance();
+  bool merged = root->num_children() < children;
+
+  if (merged) {
+    // The sibling went into the leaf, and is gone from the node cache.
+    EXPECT_EQ(children - 1, root->num_children());
+    EXPECT_EQ(leaf, root->child_at(0));
+    EXPECT_EQ(nullptr, bucket->page_node(sibling_pgid).second);
+    EXPECT_EQ(0, sibling->pgid());
+  }
+
+  // The keys that are left are committed.
+  std::size_t removed = keys.size() - 10;
+  EXPECT_TRUE(txn->commit().ok());
+  delete txn;
+
+  EXPECT_TRUE(db->begin(false, txn).ok());
+  {
+    Bucket check(txn, txn->root());
+    auto cursor = check.cursor();
+    std::size_t n = 0;
+
+    for (auto key = cursor->first().first; key.data() != nullptr; key = cursor->next().first) {
+      n++;
+    }
+
+    EXPECT_EQ(2000 - removed, n);
+    EXPECT_EQ(nullptr, check.get(keys[10].span()).data());
+  }
+
+  EXPECT_TRUE(txn->rollback().ok());
+  delete txn;
+  delete db;
+
+  return merged;
+}
+
+TEST(NodeTest, RebalanceMergesBelowMergePercent) {
+  EXPECT_TRUE(merge_first_leaf(Bucket::kDefaultMergePercent));
+  EXPECT_FALSE(merge_first_leaf(0));
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,84 @@
+#include "boltdb/transaction/reader_registry.hpp"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace boltdb;
+
+TEST(ReaderRegistryTest, OldestWithoutReaders) {
+  ReaderRegistry registry(4);
+
+  EXPECT_EQ(0, registry.count());
+  EXPECT_EQ(42, registry.oldest(42));
+}
+
+TEST(ReaderRegistryTest, AcquirePublishRelease) {
+  ReaderRegistry registry(4);
+
+  int slot1 = registry.acquire();
+  int slot2 = registry.acquire();
+
+  EXPECT_NE(slot1, slot2);
+  EXPECT_EQ(2, registry.count());
+
+  // A claimed slot holds back every pending page until it's published.
+  EXPECT_EQ(ReaderRegistry::kClaimed, registry.oldest(42));
+  EXPECT_EQ(ReaderRegistry::kUnknownPgid, registry.highest_pgid(0));
+
+  registry.publish(slot1, 10, 100);
+  registry.publish(slot2, 7, 50);
+  EXPECT_EQ(7, registry.oldest(42));
+  EXPECT_EQ(100, registry.highest_pgid(0));
+
+  registry.release(slot1);
+  EXPECT_EQ(7, registry.oldest(42));
+  EXPECT_EQ(50, registry.highest_pgid(0));
+
+  registry.release(slot2);
+  EXPECT_EQ(0, registry.count());
+  EXPECT_EQ(42, registry.oldest(42));
+  EXPECT_EQ(0, registry.highest_pgid(0));
+}
+
+TEST(ReaderRegistryTest, Full) {
+  ReaderRegistry registry(2);
+
+  EXPECT_GE(registry.acquire(), 0);
+  EXPECT_GE(registry.acquire(), 0);
+  EXPECT_EQ(-1, registry.acquire());
+}
+
+TEST(ReaderRegistryTest, ConcurrentReaders) {
+  constexpr int kThreads = 8;
+  constexpr int kIterations = 10000;
+  ReaderRegistry registry(kThreads);
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&registry, i] {
+      for (int j = 0; j < kIterations; j++) {
+        int slot = registry.acquire();
+
+        ASSERT_GE(slot, 0);
+
+        registry.publish(slot, 100 + i, 10);
+        registry.release(slot);
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(0, registry.count());
+  EXPECT_EQ(1, registry.oldest(1));
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,185 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "boltdb/db/bucket.hpp"
+#include "boltdb/db/bulk_loader.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/page/node.hpp"
+#include "boltdb/page/page.hpp"
+#include "boltdb/util/options.hpp"
+#include "boltdb/util/util.hpp"
+
+using namespace std;
+using namespace boltdb;
+
+// Allocate `state.range(0)` pages in a write transaction and look each of
+// them up a few times, like a transaction rewriting that many pages.
+static void BM_dirty_pages(benchmark::State& state) {
+  auto count = static_cast<int>(state.range(0));
+  DB* db;
+  open_memory_db("txn_benchmark", Options{}, &db);
+
+  for (auto _ : state) {
+    Txn* txn;
+    db->begin(true, txn);
+
+    vector<PageID> pgids;
+    pgids.reserve(count);
+
+    for (int i = 0; i < count; i++) {
+      Page* page;
+      txn->allocate(1, page);
+      pgids.push_back(page->id());
+    }
+
+    for (int round = 0; round < 4; round++) {
+      for (PageID pgid : pgids) {
+        benchmark::DoNotOptimize(txn->page(pgid).data());
+      }
+    }
+
+    state.PauseTiming();
+    txn->rollback();
+    delete txn;
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+  delete db;
+}
+
+BENCHMARK(BM_dirty_pages)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Look up `state.range(0)` cached nodes of a bucket, like descending into
+// children that were already materialized.
+static void BM_node_cache(benchmark::State& state) {
+  auto count = static_cast<int>(state.range(0));
+  DB* db;
+  open_memory_db("txn_benchmark", Options{}, &db);
+
+  Txn* txn;
+  db->begin(true, txn);
+
+  vector<PageID> pgids;
+
+  for (int i = 0; i < count; i++) {
+    Page* page;
+    txn->allocate(1, page);
+    page->set_flag(PageFlag::kLeaf);
+    pgids.push_back(page->id());
+  }
+
+  Bucket bucket(txn);
+  Node* root = bucket.make_node(0, nullptr);
+  Node* node;
+
+  for (PageID pgid : pgids) {
+    bucket.node(pgid, root, node);
+  }
+
+  for (auto _ : state) {
+    for (PageID pgid : pgids) {
+      bucket.node(pgid, root, node);
+      benchmark::DoNotOptimize(node);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * count);
+  txn->rollback();
+  delete txn;
+  delete db;
+}
+
+BENCHMARK(BM_node_cache)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Look up random keys among 1M in a read-only transaction, straight from the
+// pages.
+static void BM_point_read(benchmark::State& state) {
+  constexpr int kKeys = 1000000;
+  DB* db;
+  open_memory_db("txn_benchmark", Options{}, &db);
+
+  Txn* txn;
+  db->begin(true, txn);
+
+  BucketMeta root{};
+  BulkLoader loader(txn);
+
+  for (int i = 0; i < kKeys; i++) {
+    string key = format("key%08d", i);
+    loader.add({key.data(), key.size()}, {key.data(), key.size()});
+  }
+
+  loader.finish(root);
+  txn->set_root(root);
+  txn->commit();
+  delete txn;
+
+  vector<string> keys;
+  std::mt19937 random(1);
+
+  for (int i = 0; i < 4096; i++) {
+    keys.push_back(format("key%08d", random() % kKeys));
+  }
+
+  db->begin(false, txn);
+
+  {
+    Bucket bucket(txn, txn->root());
+    std::size_t i = 0;
+
+    for (auto _ : state) {
+      const string& key = keys[i++ % keys.size()];
+      benchmark::DoNotOptimize(bucket.get({key.data(), key.size()}).data());
+    }
+  }
+
+  txn->rollback();
+  delete txn;
+  delete db;
+}
+
+BENCHMARK(BM_point_read);
+
+static DB* stats_db;
+
+// Begin and close read transactions on several threads. Each close adds its
+// stats to the database counters.
+static void BM_read_txn(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    open_memory_db("txn_benchmark", Options{}, &stats_db);
+  }
+
+  for (auto _ : state) {
+    Txn* txn;
+    stats_db->begin(false, txn);
+    txn->rollback();
+    delete txn;
+  }
+
+  if (state.thread_index() == 0) {
+    benchmark::DoNotOptimize(stats_db->stats());
+    delete stats_db;
+  }
+}
+
+BENCHMARK(BM_read_txn)->ThreadRange(1, 8)->UseRealTime();
+
+// Collect the database stats.
+static void BM_stats(benchmark::State& state) {
+  DB* db;
+  open_memory_db("txn_benchmark", Options{}, &db);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(db->stats());
+  }
+
+  delete db;
+}
+
+BENCHMARK(BM_stats);
+
+BENCHMARK_MAIN();
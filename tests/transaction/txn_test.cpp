@@ -0,0 +1,238 @@
+#include "boltdb/transaction/txn.hpp"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../fs/test_util.hpp"
+#include "boltdb/db/bucket.hpp"
+#include "boltdb/db/bulk_loader.hpp"
+#include "boltdb/db/db.hpp"
+#include "boltdb/fs/file_system.hpp"
+#include "boltdb/page/node.hpp"
+#include "boltdb/page/page.hpp"
+#include "boltdb/util/options.hpp"
+#include "boltdb/util/util.hpp"
+
+using namespace boltdb;
+using namespace std;
+
+class TxnTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::remove(path.c_str());
+    std::remove(backup_path.c_str());
+    ASSERT_TRUE(open_db(path, Options{}, &db).ok());
+  }
+
+  void TearDown() override {
+    delete db;
+    std::remove(path.c_str());
+    std::remove(backup_path.c_str());
+  }
+
+  string path = "/tmp/txn_test.db";
+  string backup_path = "/tmp/txn_test_backup.db";
+  DB* db{};
+};
+
+TEST_F(TxnTest, CommitWritesRootBucket) {
+  ASSERT_TRUE(load(db, 1000, "").ok());
+
+  Txn* txn;
+  ASSERT_TRUE(db->begin(true, txn).ok());
+
+  // Insert enough keys into the first leaf to split it, and remove one.
+  Bucket* bucket = txn->root_bucket();
+  Node* root;
+  bucket->node(bucket->root(), nullptr, root);
+  ASSERT_FALSE(root->is_leaf());
+  Node* leaf = root->child_at(0);
+
+  for (int i = 0; i < 500; i++) {
+    ByteSlice key(format("key00000000-%04d", i));
+    leaf->put(key, key, ByteSlice(string("new")), 0, 0);
+  }
+
+  leaf->remove(ByteSlice(string("key00000002")));
+
+  PageID old_root = txn->root().root;
+  ASSERT_TRUE(txn->commit().ok());
+  delete txn;
+
+  vector<string> got = dump(db);
+  ASSERT_EQ(1499, got.size());
+  EXPECT_EQ("key00000000=value00000000", got[0]);
+  EXPECT_EQ("key00000000-0000=new", got[1]);
+  EXPECT_EQ("key00000001=value00000001", got[501]);
+  EXPECT_EQ("key00000003=value00000003", got[502]);
+  EXPECT_EQ("key00000000-0499=new", got[500]);
+
+  ASSERT_TRUE(db->begin(false, txn).ok());
+  EXPECT_NE(old_root, txn->root().root);
+  ASSERT_TRUE(txn->rollback().ok());
+  delete txn;
+}
+
+TEST_F(TxnTest, CopyFile) {
+  ASSERT_TRUE(load(db, 50000, "a").ok());
+  vector<string> expected = dump(db);
+
+  // Back up from a reader while a writer replaces every value.
+  Txn* reader;
+  ASSERT_TRUE(db->begin(false, reader).ok());
+  TxnID txid = reader->id();
+
+  ASSERT_TRUE(load(db, 50000, "b").ok());
+
+  Status status = reader->copy_file(backup_path, 0600);
+  ASSERT_TRUE(status.ok()) << status;
+
+  // Streaming the snapshot gives the same bytes.
+  std::ostringstream out;
+  i64 written;
+  ASSERT_TRUE(reader->write_to(out, written).ok());
+  EXPECT_EQ(reader->size(), written);
+  EXPECT_EQ(read_file(backup_path), out.str());
+
+  ASSERT_TRUE(reader->rollback().ok());
+  delete reader;
+
+  DB* backup;
+  ASSERT_TRUE(open_db(backup_path, Options{}, &backup).ok());
+  EXPECT_EQ(txid, backup->meta().txid);
+  EXPECT_EQ(expected, dump(backup));
+  EXPECT_NE(expected, dump(db));
+
+  // The backup is a regular database that accepts writes.
+  std::swap(db, backup);
+  ASSERT_TRUE(load(db, 10, "c").ok());
+  EXPECT_EQ(10, dump(db).size());
+
+  delete backup;
+}
+
+TEST_F(TxnTest, CopyFileSingleSync) {
+  delete db;
+  Options options;
+  options.set_single_sync_commit(true);
+  ASSERT_TRUE(open_db(path, options, &db).ok());
+  ASSERT_TRUE(load(db, 1000, "a").ok());
+  ASSERT_NE(0, db->meta().flags & Meta::kFlagCommitRecord);
+
+  Txn* reader;
+  ASSERT_TRUE(db->begin(false, reader).ok());
+  TxnID txid = reader->id();
+  ASSERT_TRUE(reader->copy_file(backup_path, 0600).ok());
+  ASSERT_TRUE(reader->rollback().ok());
+  delete reader;
+
+  // The commit record of the source isn't copied, so the backup's metas don't
+  // claim one.
+  DB* backup;
+  ASSERT_TRUE(open_db(backup_path, options, &backup).ok());
+  EXPECT_EQ(txid, backup->meta().txid);
+  EXPECT_EQ(0, backup->page(0).meta()->flags & Meta::kFlagCommitRecord);
+  EXPECT_EQ(0, backup->page(1).meta()->flags & Meta::kFlagCommitRecord);
+  EXPECT_EQ(dump(db), dump(backup));
+  delete backup;
+}
+
+TEST_F(TxnTest, WriteToDirect) {
+  ASSERT_TRUE(load(db, 10000, "a").ok());
+
+  // Not every file system supports O_DIRECT.
+  auto probe = FileSystem::open(path.c_str(), O_RDONLY | O_DIRECT, 0);
+
+  if (probe == nullptr) {
+    GTEST_SKIP() << "O_DIRECT not supported";
+  }
+
+  Txn* reader;
+  ASSERT_TRUE(db->begin(false, reader).ok());
+  reader->write_flag = O_DIRECT;
+
+  Status status = reader->copy_file(backup_path, 0600);
+  ASSERT_TRUE(status.ok()) << status;
+  ASSERT_TRUE(reader->rollback().ok());
+  delete reader;
+
+  DB* backup;
+  ASSERT_TRUE(open_db(backup_path, Options{}, &backup).ok());
+  EXPECT_EQ(dump(db), dump(backup));
+
+  delete backup;
+}
+
+TEST_F(TxnTest, WriteToDirectSmallPages) {
+  // The data pages start at 1KB, which isn't aligned for O_DIRECT.
+  delete db;
+  std::remove(path.c_str());
+  ASSERT_TRUE(open_db(path, Options{}.set_page_size(512), &db).ok());
+  ASSERT_TRUE(load(db, 10000, "a").ok());
+
+  auto probe = FileSystem::open(path.c_str(), O_RDONLY | O_DIRECT, 0);
+
+  if (probe == nullptr) {
+    GTEST_SKIP() << "O_DIRECT not supported";
+  }
+
+  Txn* reader;
+  ASSERT_TRUE(db->begin(false, reader).ok());
+  reader->write_flag = O_DIRECT;
+
+  std::ostringstream out;
+  i64 written;
+  Status status = reader->write_to(out, written);
+  ASSERT_TRUE(status.ok()) << status;
+  EXPECT_EQ(reader->size(), written);
+  EXPECT_EQ(read_file(path).substr(2 * 512, reader->size() - 2 * 512), out.str().substr(2 * 512));
+  ASSERT_TRUE(reader->rollback().ok());
+  delete reader;
+}
+
+TEST_F(TxnTest, WriteToRateLimit) {
+  ASSERT_TRUE(load(db, 50000, "a").ok());
+
+  Txn* reader;
+  ASSERT_TRUE(db->begin(false, reader).ok());
+  reader->write_rate_limit = 10;
+
+  auto start = std::chrono::steady_clock::now();
+  std::ostringstream out;
+  i64 written;
+  ASSERT_TRUE(reader->write_to(out, written).ok());
+  Duration elapsed = std::chrono::steady_clock::now() - start;
+
+  ASSERT_TRUE(reader->rollback().ok());
+  delete reader;
+
+  // Everything past the meta pages is throttled.
+  f64 expected = static_cast<f64>(written - 2 * db->page_size()) / (10 * 1024 * 1024);
+  EXPECT_GT(written, 1024 * 1024);
+  EXPECT_GE(elapsed.count(), expected * 0.9);
+}
+
+TEST_F(TxnTest, WriteToClosed) {
+  Txn* reader;
+  ASSERT_TRUE(db->begin(false, reader).ok());
+  ASSERT_TRUE(reader->rollback().ok());
+
+  std::ostringstream out;
+  i64 written;
+  EXPECT_FALSE(reader->write_to(out, written).ok());
+  EXPECT_FALSE(reader->copy_file(backup_path, 0600).ok());
+
+  delete reader;
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
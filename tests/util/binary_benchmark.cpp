@@ -0,0 +1,106 @@
+#include <benchmark/benchmark.h>
+
+#include "boltdb/db/db.hpp"
+#include "boltdb/util/binary.hpp"
+#include "boltdb/util/slice.hpp"
+
+using namespace boltdb;
+
+static Meta make_meta() {
+  Meta meta{.magic = DB::kMagic,
+            .version = DB::kVersion,
+            .page_size = 4096,
+            .flags = 0,
+            .root = {.root = 3, .sequence = 0},
+            .freelist = 2,
+            .pgid = 1000,
+            .txid = 42};
+  meta.checksum = meta.sum64();
+
+  return meta;
+}
+
+// Encode a meta by appending to a growing slice, one byte at a time.
+static void BM_meta_append_variadic_uint(benchmark::State& state) {
+  Meta meta = make_meta();
+
+  for (auto _ : state) {
+    ByteSlice slice;
+    slice = binary::BigEndian::append_variadic_uint(slice, meta.magic, meta.version, meta.page_size, meta.flags,
+                                                    meta.root.root, meta.root.sequence, meta.freelist, meta.pgid,
+                                                    meta.txid, meta.checksum);
+    benchmark::DoNotOptimize(slice.data());
+  }
+}
+
+BENCHMARK(BM_meta_append_variadic_uint);
+
+// Encode a meta into a buffer on the stack.
+static void BM_meta_encode(benchmark::State& state) {
+  Meta meta = make_meta();
+  Byte buffer[Meta::kEncodedSize];
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(meta.encode(buffer));
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(BM_meta_encode);
+
+// Decode a meta field by field from copies of a slice.
+static void BM_meta_uint(benchmark::State& state) {
+  ByteSlice encoded = Meta::serialize(make_meta());
+
+  for (auto _ : state) {
+    ByteSlice slice = encoded;
+    Meta meta;
+    meta.magic = binary::BigEndian::uint<u32>(slice);
+    slice.remove_prefix(sizeof(u32));
+    meta.version = binary::BigEndian::uint<u32>(slice);
+    slice.remove_prefix(sizeof(u32));
+    meta.page_size = binary::BigEndian::uint<u32>(slice);
+    slice.remove_prefix(sizeof(u32));
+    meta.flags = binary::BigEndian::uint<u32>(slice);
+    slice.remove_prefix(sizeof(u32));
+    meta.root.root = binary::BigEndian::uint<u64>(slice);
+    slice.remove_prefix(sizeof(u64));
+    meta.root.sequence = binary::BigEndian::uint<u64>(slice);
+    slice.remove_prefix(sizeof(u64));
+    meta.freelist = binary::BigEndian::uint<u64>(slice);
+    slice.remove_prefix(sizeof(u64));
+    meta.pgid = binary::BigEndian::uint<u64>(slice);
+    slice.remove_prefix(sizeof(u64));
+    meta.txid = binary::BigEndian::uint<u64>(slice);
+    slice.remove_prefix(sizeof(u64));
+    meta.checksum = binary::BigEndian::uint<u64>(slice);
+    benchmark::DoNotOptimize(meta);
+  }
+}
+
+BENCHMARK(BM_meta_uint);
+
+// Decode a meta from a raw buffer.
+static void BM_meta_decode(benchmark::State& state) {
+  Byte buffer[Meta::kEncodedSize];
+  make_meta().encode(buffer);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Meta::decode(buffer));
+  }
+}
+
+BENCHMARK(BM_meta_decode);
+
+// Validate a meta, which every transaction does for both meta pages.
+static void BM_meta_validate(benchmark::State& state) {
+  Meta meta = make_meta();
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(meta.validate());
+  }
+}
+
+BENCHMARK(BM_meta_validate);
+
+BENCHMARK_MAIN();
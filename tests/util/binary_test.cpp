@@ -98,6 +98,45 @@ TEST(LittleEndianTest, AppendVariadicUint) {
   }
 }
 
+TEST(BigEndianTest, StoreAndLoadUint) {
+  Byte b = 0x0f;
+  short s = 0x0d0e;
+  int i = 0x12345678;
+  long long ll = 0x0102030405060708;
+  Byte buffer[16] = {};
+
+  // Start off by one to check unaligned access.
+  Byte* end = binary::BigEndian::store_variadic_uint(buffer + 1, b, s, i, ll);
+  EXPECT_EQ(buffer + 16, end);
+
+  ByteSlice slice;
+  slice = binary::BigEndian::append_variadic_uint(slice, b, s, i, ll);
+  EXPECT_EQ(slice.to_string(), std::string(buffer + 1, end));
+
+  EXPECT_EQ(0x0d0e, binary::BigEndian::load_uint<u16>(buffer + 2));
+  EXPECT_EQ(0x12345678, binary::BigEndian::load_uint<u32>(buffer + 4));
+  EXPECT_EQ(0x0102030405060708, binary::BigEndian::load_uint<u64>(buffer + 8));
+}
+
+TEST(LittleEndianTest, StoreAndLoadUint) {
+  Byte b = 0x0f;
+  short s = 0x0d0e;
+  int i = 0x12345678;
+  long long ll = 0x0102030405060708;
+  Byte buffer[16] = {};
+
+  Byte* end = binary::LittleEndian::store_variadic_uint(buffer + 1, b, s, i, ll);
+  EXPECT_EQ(buffer + 16, end);
+
+  ByteSlice slice;
+  slice = binary::LittleEndian::append_variadic_uint(slice, b, s, i, ll);
+  EXPECT_EQ(slice.to_string(), std::string(buffer + 1, end));
+
+  EXPECT_EQ(0x0d0e, binary::LittleEndian::load_uint<u16>(buffer + 2));
+  EXPECT_EQ(0x12345678, binary::LittleEndian::load_uint<u32>(buffer + 4));
+  EXPECT_EQ(0x0102030405060708, binary::LittleEndian::load_uint<u64>(buffer + 8));
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
 
@@ -0,0 +1,80 @@
+#include "boltdb/util/histogram.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace boltdb;
+
+static Duration nanos(i64 n) { return Duration(static_cast<f64>(n) / 1e9); }
+
+TEST(HistogramTest, Buckets) {
+  // Small durations have a bucket each.
+  for (i64 v = 0; v < 2 * HistogramSnapshot::kSubBuckets; v++) {
+    EXPECT_EQ(v, HistogramSnapshot::bucket_of(v));
+    EXPECT_EQ(v, HistogramSnapshot::bucket_upper_bound(static_cast<int>(v)));
+  }
+
+  // Larger ones share buckets at most 1/16 of their values wide.
+  for (i64 v = 32; v < (i64{1} << 36); v = v * 5 / 4 + 7) {
+    int bucket = HistogramSnapshot::bucket_of(v);
+    i64 upper = HistogramSnapshot::bucket_upper_bound(bucket);
+
+    EXPECT_LE(v, upper);
+    EXPECT_GT(v, HistogramSnapshot::bucket_upper_bound(bucket - 1));
+    EXPECT_LE(upper - v, v / HistogramSnapshot::kSubBuckets);
+  }
+
+  // Out of range durations go to the first and last buckets.
+  EXPECT_EQ(0, HistogramSnapshot::bucket_of(-5));
+  EXPECT_EQ(HistogramSnapshot::kBuckets - 1, HistogramSnapshot::bucket_of(i64{1} << 40));
+}
+
+TEST(HistogramTest, Percentiles) {
+  Histogram histogram;
+  EXPECT_EQ(0, histogram.snapshot().percentile(99).count());
+
+  // 1..1000us, then a single 1s outlier.
+  for (int i = 1; i <= 1000; i++) {
+    histogram.record(nanos(i * 1000));
+  }
+
+  histogram.record(Duration(1));
+
+  HistogramSnapshot snapshot = histogram.snapshot();
+  EXPECT_EQ(1001, snapshot.count());
+  EXPECT_NEAR(500e-6, snapshot.percentile(50).count(), 500e-6 / 16);
+  EXPECT_NEAR(990e-6, snapshot.percentile(99).count(), 990e-6 / 16);
+  EXPECT_NEAR(1.0, snapshot.percentile(100).count(), 1.0 / 16);
+  EXPECT_NEAR(1.0, snapshot.max().count(), 1.0 / 16);
+  EXPECT_NEAR((0.5005 + 1) / 1001, snapshot.mean().count(), 1e-9);
+}
+
+TEST(HistogramTest, Threads) {
+  Histogram histogram;
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&histogram] {
+      for (int j = 0; j < 10000; j++) {
+        histogram.record(nanos(100));
+      }
+    });
+  }
+
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  HistogramSnapshot snapshot = histogram.snapshot();
+  EXPECT_EQ(80000, snapshot.count());
+  EXPECT_NEAR(100e-9, snapshot.percentile(99.9).count(), 100e-9 / 16);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,84 @@
+#include "boltdb/util/memory_map.hpp"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "boltdb/fs/file_system.hpp"
+#include "boltdb/os/darwin.hpp"
+
+using namespace boltdb;
+
+class MemoryMapTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    handle = FileSystem::create(path);
+    ASSERT_TRUE(handle != nullptr);
+  }
+
+  void TearDown() override { FileSystem::remove(*handle); }
+
+  // Write a page filled with `v` at the given page index.
+  void write_page(int index, char v) {
+    std::string data(page_size, v);
+    handle->write(data.data(), data.size(), index * page_size);
+  }
+
+  const char* path = "/tmp/boltdb_mmap.db";
+  std::size_t page_size = OS::getpagesize();
+  std::unique_ptr<FileHandle> handle;
+};
+
+TEST_F(MemoryMapTest, GrowInPlace) {
+  write_page(0, 'a');
+
+  MemoryMap mmap;
+  Status status = mmap.map(handle->fd(), page_size, 64 * page_size, 0);
+  ASSERT_TRUE(status.ok()) << status;
+
+  Byte* base = mmap.data();
+  EXPECT_EQ('a', base[0]);
+
+  // Grow the file and the mapping, the base address doesn't change.
+  write_page(1, 'b');
+  write_page(2, 'c');
+  status = mmap.grow(3 * page_size);
+  ASSERT_TRUE(status.ok()) << status;
+
+  EXPECT_EQ(base, mmap.data());
+  EXPECT_EQ(3 * page_size, mmap.size());
+  EXPECT_EQ('a', base[0]);
+  EXPECT_EQ('b', base[page_size]);
+  EXPECT_EQ('c', base[2 * page_size]);
+  EXPECT_EQ(0, mmap.relocations());
+}
+
+TEST_F(MemoryMapTest, GrowBeyondReservation) {
+  write_page(0, 'a');
+
+  MemoryMap mmap;
+  Status status = mmap.map(handle->fd(), page_size, 2 * page_size, 0);
+  ASSERT_TRUE(status.ok()) << status;
+
+  Byte* old_base = mmap.data();
+
+  for (int i = 1; i < 4; i++) {
+    write_page(i, 'a' + i);
+  }
+
+  status = mmap.grow(4 * page_size);
+  ASSERT_TRUE(status.ok()) << status;
+
+  EXPECT_EQ(1, mmap.relocations());
+  EXPECT_EQ('d', mmap.data()[3 * page_size]);
+
+  // The retired mapping stays readable for the readers still using it.
+  EXPECT_EQ('a', old_base[0]);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -17,6 +17,7 @@ TEST(OptionsTest, DefaultConstructor) {
   EXPECT_EQ(boltdb::Options::kDefaultMaxBatchSize, options.max_batch_size());
   EXPECT_EQ(boltdb::Options::kDefaultMaxBatchDelay, options.max_batch_delay());
   EXPECT_EQ(boltdb::Options::kDefaultAllocSize, options.alloc_size());
+  EXPECT_EQ(boltdb::Options::kDefaultMaxReaders, options.max_readers());
 }
 
 TEST(OptionsTest, Modifier) {
@@ -0,0 +1,114 @@
+#include "boltdb/util/page_map.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace boltdb;
+
+TEST(PageMapTest, InsertAndFind) {
+  PageMap<int> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.end(), map.find(0));
+
+  map[0] = 10;
+  map[3] = 13;
+  map[3] += 100;
+
+  EXPECT_EQ(2, map.size());
+  ASSERT_NE(map.end(), map.find(0));
+  EXPECT_EQ(10, map.find(0)->second);
+  EXPECT_EQ(113, map.find(3)->second);
+  EXPECT_EQ(map.end(), map.find(4));
+}
+
+TEST(PageMapTest, MatchesStdMap) {
+  PageMap<u64> map;
+  std::map<PageID, u64> expected;
+  std::mt19937_64 random(7);
+
+  // Mostly sequential ids with some far away ones, across several rehashes.
+  for (int i = 0; i < 100000; i++) {
+    PageID pgid = i % 4 == 0 ? random() % (1ULL << 40) : static_cast<PageID>(i);
+    map[pgid] = i;
+    expected[pgid] = i;
+  }
+
+  EXPECT_EQ(expected.size(), map.size());
+
+  for (auto&& [pgid, value] : expected) {
+    auto iter = map.find(pgid);
+    ASSERT_NE(map.end(), iter);
+    EXPECT_EQ(value, iter->second);
+  }
+
+  // Iteration visits every entry once.
+  std::vector<std::pair<PageID, u64>> entries(map.begin(), map.end());
+  std::sort(entries.begin(), entries.end());
+  std::vector<std::pair<PageID, u64>> expected_entries(expected.begin(), expected.end());
+  EXPECT_EQ(expected_entries, entries);
+}
+
+TEST(PageMapTest, ReserveAndClear) {
+  PageMap<int> map;
+  map.reserve(1000);
+
+  for (int i = 0; i < 1000; i++) {
+    map[i * 7] = i;
+  }
+
+  EXPECT_EQ(1000, map.size());
+  map.clear();
+  EXPECT_EQ(0, map.size());
+  EXPECT_EQ(map.begin(), map.end());
+  EXPECT_EQ(map.end(), map.find(7));
+
+  map[7] = 1;
+  EXPECT_EQ(1, map.find(7)->second);
+}
+
+TEST(PageMapTest, Erase) {
+  PageMap<u64> map;
+  std::map<PageID, u64> expected;
+  std::mt19937_64 random(11);
+
+  // Small tables collide often, so erasing shifts entries around the end.
+  for (int i = 0; i < 20000; i++) {
+    PageID pgid = random() % 64;
+
+    if (random() % 2 == 0) {
+      map[pgid] = i;
+      expected[pgid] = i;
+    } else {
+      EXPECT_EQ(expected.erase(pgid), map.erase(pgid));
+    }
+
+    ASSERT_EQ(expected.size(), map.size());
+  }
+
+  for (PageID pgid = 0; pgid < 64; pgid++) {
+    auto iter = expected.find(pgid);
+
+    if (iter == expected.end()) {
+      EXPECT_EQ(map.end(), map.find(pgid));
+    } else {
+      ASSERT_NE(map.end(), map.find(pgid));
+      EXPECT_EQ(iter->second, map.find(pgid)->second);
+    }
+  }
+
+  std::vector<std::pair<PageID, u64>> entries(map.begin(), map.end());
+  std::sort(entries.begin(), entries.end());
+  std::vector<std::pair<PageID, u64>> expected_entries(expected.begin(), expected.end());
+  EXPECT_EQ(expected_entries, entries);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
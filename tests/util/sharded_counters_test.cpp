@@ -0,0 +1,37 @@
+#include "boltdb/util/sharded_counters.hpp"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace boltdb;
+
+TEST(ShardedCountersTest, SumsAllThreads) {
+  ShardedCounters<3> counters;
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < 32; i++) {
+    threads.emplace_back([&counters, i] {
+      for (int j = 0; j < 1000; j++) {
+        counters.add({1, i, 0});
+        counters.add(2, 2);
+      }
+    });
+  }
+
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  auto values = counters.sum();
+  EXPECT_EQ(32000, values[0]);
+  EXPECT_EQ(1000 * (31 * 32 / 2), values[1]);
+  EXPECT_EQ(64000, values[2]);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
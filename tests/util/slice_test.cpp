@@ -107,6 +107,16 @@ TEST(ByteSliceTest, Append) {
   EXPECT_EQ(kAsciiLowercase, slice.to_string());
 }
 
+TEST(ByteSliceTest, AppendBytes) {
+  ByteSlice slice;
+  slice.append(kAsciiLowercase.data(), 3);
+  slice.append("\x00\x01", 2);
+  slice.append(kAsciiLowercase.data(), 0);
+  slice.append(kAsciiLowercase.data() + 3, kAsciiLowercase.size() - 3);
+
+  EXPECT_EQ(std::string("abc\x00\x01", 5) + kAsciiLowercase.substr(3), slice.to_string());
+}
+
 TEST(ByteSliceTest, Span) {
   ByteSlice slice("\x61\x62");
 